@@ -44,6 +44,167 @@
 #include "src/AlertManager/AlertManager.h"
 #include "src/LightManager/LightManager.h"
 #include "src/RGBManager/RGBManager.h"
+#include "src/StateStore/StateStore.h"
+#include "src/TimeService/TimeService.h"
+#include "src/LoopScheduler/LoopScheduler.h"
+#include "src/WiFiScan/WiFiScan.h"
+
+// Loop task periods (ms). LVGL and the clock schedule themselves.
+#define TASK_WEB_MS         20
+#define TASK_RGB_MS         20
+#define TASK_ALERT_MS       100
+#define TASK_LIGHT_MS       250
+#define TASK_NET_MS         250
+#define TASK_SCAN_MS        100
+#define TASK_STATUS_MS      2000
+#define TASK_UI_MAX_IDLE_MS 50      // LVGL may ask for longer; blinking needs this
+#define BOOT_SCREEN_AT_MS   5000
+#define BOOT_SCREEN_FOR_MS  10000
+
+static int8_t uiTask = LOOP_TASK_NONE;
+static int8_t timeTask = LOOP_TASK_NONE;
+static int8_t bootTask = LOOP_TASK_NONE;
+static bool bootScreenShown = false;
+
+// Clock label, once per second from the time service
+static void onSecondTick(const struct tm& now)
+{
+  AlertLight_UI_Update_Clock();
+}
+
+static void taskWeb()
+{
+  webConfig.handleClient();
+}
+
+static void taskWiFiCheck()
+{
+  webConfig.checkWiFiStatus();
+}
+
+static void taskScan()
+{
+  wifiScan.update();
+}
+
+// Detect WiFi connection event (transition from disconnected to connected)
+static void taskNet()
+{
+  static bool wasConnected = false;
+  bool isConnected = webConfig.isConnected();
+  if (isConnected && !wasConnected) {
+    printf("\n========== WiFi Just Connected! ==========\n");
+    printf("Triggering immediate API updates...\n");
+
+    // Force immediate updates by resetting last update times in managers
+    alertManager.forceUpdate();
+    lightManager.forceUpdate();
+
+    printf("==========================================\n\n");
+  }
+  wasConnected = isConnected;
+}
+
+static void taskAlert()
+{
+  alertManager.update();
+}
+
+static void taskLight()
+{
+  lightManager.update();
+}
+
+static void taskRGB()
+{
+  rgbManager.update();
+}
+
+// Clock display every second, outage highlighting at minute boundaries
+static void taskTime()
+{
+  timeService.update();
+  loopScheduler.runIn(timeTask, timeService.getMillisToNextSecond() + 2);
+}
+
+static void taskUI()
+{
+  uint32_t next = Timer_Loop();
+  AlertLight_UI_Tick(); // Update UI (handles blinking)
+  loopScheduler.runIn(uiTask, constrain(next, (uint32_t)LOOP_TICK_MS, (uint32_t)TASK_UI_MAX_IDLE_MS));
+}
+
+// Update WiFi status on display periodically (only after boot screen is hidden)
+static void taskStatus()
+{
+  // Update WiFi status and IP
+  String port = String(configManager.getConfig().web_port);
+  if (webConfig.isConnected()) {
+    // Connected - show IP:port
+    String ip = webConfig.getIPAddress();
+    AlertLight_UI_Update_IP(ip.c_str(), port.c_str());
+    AlertLight_UI_Update_WiFi(UI_WIFI_CONNECTED);
+    AlertLight_UI_Update_WiFi_Blink(false);  // Stop blinking when connected
+  } else if (WiFi.getMode() == WIFI_AP || WiFi.getMode() == WIFI_AP_STA) {
+    // AP mode - show AP IP with port (AP mode is stable, not connecting)
+    AlertLight_UI_Update_IP("192.168.4.1", port.c_str());
+    AlertLight_UI_Update_WiFi(UI_WIFI_AP_MODE);
+    AlertLight_UI_Update_WiFi_Blink(false);  // Stop blinking in AP mode
+  } else if (AlertLight_UI_IsWiFiBlinking()) {
+    // Currently trying to connect - show "Connecting" without port
+    AlertLight_UI_Update_IP("Connecting", "");
+    AlertLight_UI_Update_WiFi(UI_WIFI_DISCONNECTED);
+  } else {
+    // Disconnected - show status without port
+    AlertLight_UI_Update_IP("Disconnected", "");
+    AlertLight_UI_Update_WiFi(UI_WIFI_DISCONNECTED);
+  }
+}
+
+// Show boot screen at 5 seconds, hide it 10 seconds later
+static void taskBootScreen()
+{
+  if (!bootScreenShown) {
+    printf("Transitioning to boot screen from loop\n");
+    AlertLight_UI_ShowBootScreen();
+    AlertLight_UI_Update_IP("Connecting...", "...");
+    bootScreenShown = true;
+    loopScheduler.runIn(bootTask, BOOT_SCREEN_FOR_MS);
+    return;
+  }
+
+  if (!AlertLight_UI_IsBootScreenActive()) {
+    return;
+  }
+
+  AlertLight_UI_AddBootLog("Boot complete!");
+  delay(500);  // Show final message briefly
+
+  AlertLight_UI_HideBootScreen();
+  AlertLight_UI_Update_WiFi_Blink(false);  // Stop blinking
+
+  // Initialize normal UI with current status
+  String port = String(configManager.getConfig().web_port);
+  if (webConfig.isConnected()) {
+    String ip = webConfig.getIPAddress();
+    AlertLight_UI_Update_IP(ip.c_str(), port.c_str());
+    AlertLight_UI_Update_WiFi(UI_WIFI_CONNECTED);
+  } else {
+    if (WiFi.getMode() == WIFI_AP || WiFi.getMode() == WIFI_AP_STA) {
+      AlertLight_UI_Update_IP("192.168.4.1", port.c_str());
+      AlertLight_UI_Update_WiFi(UI_WIFI_AP_MODE);
+    } else {
+      AlertLight_UI_Update_IP("Disconnected", "");
+      AlertLight_UI_Update_WiFi(UI_WIFI_DISCONNECTED);
+    }
+  }
+
+  // Show current (fresh, cached or placeholder) alert and light state
+  alertManager.refreshUI();
+  lightManager.refreshUI();
+
+  loopScheduler.every("status", TASK_STATUS_MS, taskStatus, TASK_STATUS_MS);
+}
 
 void setup()
 {
@@ -67,6 +228,9 @@ void setup()
   configManager.begin();
   printf("Config initialized\n");
 
+  // Timezone before anything reads the clock (restored state, UI)
+  timeService.begin();
+
   // Initialize display and UI
   printf("Initializing display...\n");
   LCD_Init();
@@ -90,6 +254,16 @@ void setup()
   AlertLight_UI_AddBootLog("System initialized");
   AlertLight_UI_AddBootLog("Display OK");
 
+  // Restore last known alert/schedule state so screen and LED are right before WiFi is up
+  stateStore.begin();
+  alertManager.restoreState();
+  lightManager.restoreState();
+  if (alertManager.isStateStale() || lightManager.isStateStale()) {
+    AlertLight_UI_AddBootLog("Cached state restored");
+    rgbManager.update();  // LED from cached state now - WiFi takes a moment to come up
+    lv_timer_handler();
+  }
+
   // Initialize WiFi and web server
   AlertLight_UI_AddBootLog("Starting WiFi...");
   AlertLight_UI_Update_WiFi_Blink(true);  // Start blinking
@@ -109,6 +283,23 @@ void setup()
   rgbManager.begin();
   printf("RGB Manager initialized\n");
 
+  timeService.subscribe(TIME_EVENT_SECOND, onSecondTick);
+
+  // Everything loop() runs, by deadline
+  loopScheduler.every("web", TASK_WEB_MS, taskWeb);
+  loopScheduler.every("wifi", WIFI_SUPERVISE_MS, taskWiFiCheck);
+  loopScheduler.every("scan", TASK_SCAN_MS, taskScan);
+  loopScheduler.every("net", TASK_NET_MS, taskNet);
+  loopScheduler.every("alert", TASK_ALERT_MS, taskAlert);
+  loopScheduler.every("light", TASK_LIGHT_MS, taskLight);
+  loopScheduler.every("rgb", TASK_RGB_MS, taskRGB);
+  timeTask = loopScheduler.after("time", 0, taskTime);
+  uiTask = loopScheduler.after("ui", 0, taskUI);
+  unsigned long sinceBoot = millis();
+  bootTask = loopScheduler.after("boot", sinceBoot < BOOT_SCREEN_AT_MS ? BOOT_SCREEN_AT_MS - sinceBoot : 0,
+                                 taskBootScreen);
+  loopScheduler.begin();
+
   // Boot screen will be shown for 10 seconds, hiding in loop
   printf("\n========== Setup Complete ==========\n");
   printf("Entering main loop...\n");
@@ -116,139 +307,6 @@ void setup()
 
 void loop()
 {
-  static unsigned long bootScreenStartTime = 0;
-  static bool bootScreenShown = false;
-  static bool bootScreenHidden = false;
-  static bool wasConnected = false;  // Track WiFi state changes
-
-  // Show boot screen after 5 seconds
-  if (!bootScreenShown && millis() >= 5000) {
-    printf("Transitioning to boot screen from loop\n");
-    AlertLight_UI_ShowBootScreen();
-    AlertLight_UI_Update_IP("Connecting...", "...");
-    bootScreenShown = true;
-    bootScreenStartTime = millis();
-  }
-
-  // Handle web server requests
-  webConfig.handleClient();
-
-  // Detect WiFi connection event (transition from disconnected to connected)
-  bool isConnected = webConfig.isConnected();
-  if (isConnected && !wasConnected) {
-    printf("\n========== WiFi Just Connected! ==========\n");
-    printf("Triggering immediate API updates...\n");
-
-    // Force immediate updates by resetting last update times in managers
-    alertManager.forceUpdate();
-    lightManager.forceUpdate();
-
-    printf("==========================================\n\n");
-  }
-  wasConnected = isConnected;
-
-  // Hide boot screen after 10 seconds
-  if (bootScreenShown && !bootScreenHidden && AlertLight_UI_IsBootScreenActive()) {
-    unsigned long now = millis();
-    if (now - bootScreenStartTime >= 10000) {  // 10 seconds
-      AlertLight_UI_AddBootLog("Boot complete!");
-      delay(500);  // Show final message briefly
-
-      AlertLight_UI_HideBootScreen();
-      AlertLight_UI_Update_WiFi_Blink(false);  // Stop blinking
-      bootScreenHidden = true;
-
-      // Initialize normal UI with current status
-      String port = String(configManager.getConfig().web_port);
-      if (webConfig.isConnected()) {
-        String ip = webConfig.getIPAddress();
-        AlertLight_UI_Update_IP(ip.c_str(), port.c_str());
-        AlertLight_UI_Update_WiFi(UI_WIFI_CONNECTED);
-      } else {
-        if (WiFi.getMode() == WIFI_AP || WiFi.getMode() == WIFI_AP_STA) {
-          AlertLight_UI_Update_IP("192.168.4.1", port.c_str());
-          AlertLight_UI_Update_WiFi(UI_WIFI_AP_MODE);
-        } else {
-          AlertLight_UI_Update_IP("Disconnected", "");
-          AlertLight_UI_Update_WiFi(UI_WIFI_DISCONNECTED);
-        }
-      }
-
-      AlertLight_UI_Update_Alert("Not configured", "Not checked yet", false);
-
-      // Update light section with current data (or placeholder if no data yet)
-      const std::vector<OutageRange>& ranges = lightManager.getOutageRanges();
-      if (ranges.size() > 0) {
-        // Use existing data from lightManager
-        printf("Refreshing light display with existing data (%d slots)\n", ranges.size());
-        outage_time_slot_t slots[ranges.size()];
-        for (size_t i = 0; i < ranges.size(); i++) {
-          slots[i].time_range = ranges[i].time_range.c_str();
-          slots[i].is_active = ranges[i].is_active;
-        }
-        AlertLight_UI_Update_Light(configManager.getConfig().light_queue, slots, ranges.size());
-      } else {
-        // No data yet, use placeholder
-        printf("No light data yet, using placeholder\n");
-        outage_time_slot_t init_slot;
-        init_slot.time_range = "--:--";
-        init_slot.is_active = false;
-        AlertLight_UI_Update_Light(configManager.getConfig().light_queue, &init_slot, 1);
-      }
-    }
-  }
-
-  // Update WiFi status on display periodically (only after boot screen is hidden)
-  if (bootScreenHidden) {
-    static unsigned long lastUIUpdate = 0;
-    unsigned long now = millis();
-    if (now - lastUIUpdate >= 2000) {  // Update every 2 seconds
-      lastUIUpdate = now;
-
-      // Update WiFi status and IP
-      String port = String(configManager.getConfig().web_port);
-      if (webConfig.isConnected()) {
-        // Connected - show IP:port
-        String ip = webConfig.getIPAddress();
-        AlertLight_UI_Update_IP(ip.c_str(), port.c_str());
-        AlertLight_UI_Update_WiFi(UI_WIFI_CONNECTED);
-        AlertLight_UI_Update_WiFi_Blink(false);  // Stop blinking when connected
-      } else if (WiFi.getMode() == WIFI_AP || WiFi.getMode() == WIFI_AP_STA) {
-        // AP mode - show AP IP with port (AP mode is stable, not connecting)
-        AlertLight_UI_Update_IP("192.168.4.1", port.c_str());
-        AlertLight_UI_Update_WiFi(UI_WIFI_AP_MODE);
-        AlertLight_UI_Update_WiFi_Blink(false);  // Stop blinking in AP mode
-      } else if (AlertLight_UI_IsWiFiBlinking()) {
-        // Currently trying to connect - show "Connecting" without port
-        AlertLight_UI_Update_IP("Connecting", "");
-        AlertLight_UI_Update_WiFi(UI_WIFI_DISCONNECTED);
-      } else {
-        // Disconnected - show status without port
-        AlertLight_UI_Update_IP("Disconnected", "");
-        AlertLight_UI_Update_WiFi(UI_WIFI_DISCONNECTED);
-      }
-    }
-  }
-
-  // Update Alert Manager (handles periodic API checks)
-  alertManager.update();
-
-  // Update Light Outage Manager (handles periodic schedule checks)
-  lightManager.update();
-
-  // Update RGB Manager (handles ambient colors and blink notifications)
-  rgbManager.update();
-
-  // Update clock display and outage highlighting every second
-  static unsigned long lastClockUpdate = 0;
-  if (millis() - lastClockUpdate >= 1000) {
-    AlertLight_UI_Update_Clock();
-    lightManager.updateActiveStates();  // Recalculate which outage is active
-    lastClockUpdate = millis();
-  }
-
-  Timer_Loop();
-  AlertLight_UI_Tick(); // Update UI (handles blinking)
-  // RGB_Lamp_Loop(2);  // Replaced by RGBManager
-  delay(5);
+  // Runs what is due, then sleeps until the next deadline
+  loopScheduler.run();
 }
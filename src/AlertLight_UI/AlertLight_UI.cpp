@@ -2,6 +2,7 @@
 #include <Arduino.h>
 #include <time.h>
 #include "../Fonts/lv_font_montserrat_10_cyrillic.h"
+#include "../TimeService/TimeService.h"
 // Diagnostics disabled to save flash space
 // #include "../LVGL_Driver/LVGL_Diagnostics.h"
 
@@ -37,10 +38,18 @@ static String boot_log_text = "";
 // Clock display
 static lv_obj_t *clock_label = NULL;
 
+// Watched neighbour regions currently on alert (below alert status)
+static lv_obj_t *neighbours_label = NULL;
+
 // Dynamic outage time labels (created based on number of outages)
-#define MAX_OUTAGE_SLOTS 6
+// Last text/highlight per row and for the queue, to skip unchanged rows
+#define OUTAGE_LABEL_TEXT_LEN 48
 static lv_obj_t *outage_time_labels[MAX_OUTAGE_SLOTS] = {NULL};
+static char outage_label_text[MAX_OUTAGE_SLOTS][OUTAGE_LABEL_TEXT_LEN] = {{0}};
+static bool outage_label_active[MAX_OUTAGE_SLOTS] = {false};
 static int num_outage_labels = 0;
+static String last_queue_text = "";
+static int last_queue_active = -1;
 
 // Helper function to count UTF-8 characters (not bytes)
 static int utf8_char_count(const char* str) {
@@ -383,40 +392,68 @@ void AlertLight_UI_Update_Alert(const char* region, const char* status, bool is_
     }
 }
 
-// Update light outage schedule with dynamic slots
-void AlertLight_UI_Update_Light(const char* queue, const outage_time_slot_t* slots, int num_slots) {
-    printf(">>> UI_Update_Light called: queue=%s, num_slots=%d\n", queue ? queue : "NULL", num_slots);
-    for (int i = 0; i < num_slots; i++) {
-        printf("    Received slot %d: '%s' (active=%d)\n", i,
-               slots[i].time_range ? slots[i].time_range : "NULL",
-               slots[i].is_active);
+// Update the neighbour regions line in the alert section
+void AlertLight_UI_Update_AlertNeighbours(const char* text) {
+    // SAFETY: Don't access objects if not initialized
+    if (objects.alert_section == NULL) {
+        return;
+    }
+
+    // Create label lazily - most installs watch only the home region
+    if (neighbours_label == NULL) {
+        neighbours_label = lv_label_create(objects.alert_section);
+        lv_obj_set_pos(neighbours_label, 10, 56);
+        lv_obj_set_size(neighbours_label, 158, LV_SIZE_CONTENT);
+        lv_label_set_long_mode(neighbours_label, LV_LABEL_LONG_DOT);
+        lv_obj_set_style_text_font(neighbours_label, &lv_font_montserrat_bold_10_cyrillic, 0);
+        lv_obj_set_style_text_color(neighbours_label, lv_color_hex(0xff3333), 0); // Red, same as alert text
+    }
+
+    if (text == NULL || text[0] == '\0') {
+        lv_obj_add_flag(neighbours_label, LV_OBJ_FLAG_HIDDEN);
+        return;
     }
 
+    lv_label_set_text(neighbours_label, text);
+    lv_obj_clear_flag(neighbours_label, LV_OBJ_FLAG_HIDDEN);
+}
+
+// Update light outage schedule with dynamic slots.
+// Rows are cached, so only labels whose text or highlight changed are touched.
+void AlertLight_UI_Update_Light(const char* queue, const outage_time_slot_t* slots, int num_slots) {
     // SAFETY: Don't access objects if not initialized
     if (objects.queue_value == NULL || objects.light_section == NULL) {
         printf("ERROR: queue_value or light_section is NULL!\n");
         return;
     }
 
-    // Update queue name
-    if (queue != NULL) {
-        lv_label_set_text(objects.queue_value, queue);
+    if (num_slots > MAX_OUTAGE_SLOTS) {
+        num_slots = MAX_OUTAGE_SLOTS;
+    }
+    if (num_slots < 0) {
+        num_slots = 0;
+    }
 
-        // Highlight queue in yellow if any outage is active
-        bool has_active = false;
-        for (int i = 0; i < num_slots; i++) {
-            if (slots[i].is_active) {
-                has_active = true;
-                break;
-            }
+    // Highlight queue in yellow if any outage is active
+    bool has_active = false;
+    for (int i = 0; i < num_slots; i++) {
+        if (slots[i].is_active) {
+            has_active = true;
+            break;
         }
+    }
 
+    // Update queue name
+    if (queue != NULL && (last_queue_text != queue || last_queue_active != (int)has_active)) {
+        lv_label_set_text(objects.queue_value, queue);
         if (has_active) {
             lv_obj_set_style_text_color(objects.queue_value, lv_color_hex(0xffff00), 0); // Yellow
         } else {
             lv_obj_set_style_text_color(objects.queue_value, lv_color_hex(0xffffff), 0); // White
         }
         lv_obj_set_style_text_opa(objects.queue_value, LV_OPA_COVER, 0);
+        last_queue_text = queue;
+        last_queue_active = has_active;
     }
 
     // Hide old static labels from EEZ (we'll use dynamic ones)
@@ -427,49 +464,59 @@ void AlertLight_UI_Update_Light(const char* queue, const outage_time_slot_t* slo
         lv_obj_add_flag(objects.outage_time_2, LV_OBJ_FLAG_HIDDEN);
     }
 
-    // Delete old dynamic labels if the number changed
-    if (num_slots != num_outage_labels) {
-        for (int i = 0; i < num_outage_labels; i++) {
-            if (outage_time_labels[i]) {
-                lv_obj_del(outage_time_labels[i]);
-                outage_time_labels[i] = NULL;
-            }
+    // Delete only the rows that are no longer needed
+    for (int i = num_slots; i < num_outage_labels; i++) {
+        if (outage_time_labels[i]) {
+            lv_obj_del(outage_time_labels[i]);
+            outage_time_labels[i] = NULL;
         }
-        num_outage_labels = 0;
+        outage_label_text[i][0] = '\0';
     }
 
     // Create/update dynamic outage labels
-    int y_pos = 80;  // Starting Y position for outage times (below queue)
+    const int y_start = 80;      // Starting Y position for outage times (below queue)
     const int line_height = 20;  // Height per line
+    int touched = 0;
 
-    for (int i = 0; i < num_slots && i < MAX_OUTAGE_SLOTS; i++) {
+    for (int i = 0; i < num_slots; i++) {
         // Create label if it doesn't exist
         if (outage_time_labels[i] == NULL) {
             outage_time_labels[i] = lv_label_create(objects.light_section);
-            lv_obj_set_pos(outage_time_labels[i], 12, y_pos);
+            lv_obj_set_pos(outage_time_labels[i], 12, y_start + i * line_height);
             lv_obj_set_size(outage_time_labels[i], 148, LV_SIZE_CONTENT);
             lv_obj_set_style_text_font(outage_time_labels[i], &lv_font_montserrat_bold_14_cyrillic, 0);
+            lv_obj_set_style_text_opa(outage_time_labels[i], LV_OPA_COVER, 0);
+            outage_label_text[i][0] = '\0';
+        }
+
+        // Marker for the active slot
+        char text[OUTAGE_LABEL_TEXT_LEN];
+        snprintf(text, sizeof(text), "%s%s",
+                 slots[i].time_range ? slots[i].time_range : "", slots[i].is_active ? " <" : "");
+
+        // Unchanged row - leave it alone (no LVGL invalidation)
+        if (outage_label_text[i][0] != '\0' && strcmp(outage_label_text[i], text) == 0 &&
+            outage_label_active[i] == slots[i].is_active) {
+            continue;
         }
 
-        // Update label text and color
-        String text = String(slots[i].time_range);
         if (slots[i].is_active) {
-            text += " <";  // Add marker for active slot
             lv_obj_set_style_text_color(outage_time_labels[i], lv_color_hex(0xffff00), 0); // Yellow
         } else {
             lv_obj_set_style_text_color(outage_time_labels[i], lv_color_hex(0xffffff), 0); // White
         }
-
-        lv_label_set_text(outage_time_labels[i], text.c_str());
-        printf("    Label %d set to: '%s'\n", i, text.c_str());
-        lv_obj_set_style_text_opa(outage_time_labels[i], LV_OPA_COVER, 0);
+        lv_label_set_text(outage_time_labels[i], text);
         lv_obj_clear_flag(outage_time_labels[i], LV_OBJ_FLAG_HIDDEN);  // Make sure it's visible
 
-        y_pos += line_height;
+        strncpy(outage_label_text[i], text, OUTAGE_LABEL_TEXT_LEN - 1);
+        outage_label_text[i][OUTAGE_LABEL_TEXT_LEN - 1] = '\0';
+        outage_label_active[i] = slots[i].is_active;
+        touched++;
     }
 
     num_outage_labels = num_slots;
-    printf("<<< UI_Update_Light finished: %d labels created/updated\n\n", num_outage_labels);
+    printf("UI_Update_Light: queue=%s, %d slot(s), %d row(s) updated\n",
+           queue ? queue : "NULL", num_slots, touched);
 }
 
 // Update light outage indicator (pass true for outage, false for no outage)
@@ -651,17 +698,14 @@ void AlertLight_UI_Update_Clock(void) {
         return;  // Clock not initialized
     }
 
-    time_t now = time(nullptr);
-    struct tm timeinfo;
-    localtime_r(&now, &timeinfo);
-
     // Check if time is valid (not epoch 0)
-    if (now < 1000000000) {
+    if (!timeService.isValid()) {
         lv_label_set_text(clock_label, "--:--:--");
         return;
     }
 
-    // Format time as HH:MM:SS
+    // Format time as HH:MM:SS (converted once per second by the time service)
+    const struct tm& timeinfo = timeService.getLocalTime();
     char time_str[9];
     snprintf(time_str, sizeof(time_str), "%02d:%02d:%02d",
              timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec);
@@ -30,12 +30,16 @@ void AlertLight_UI_Update_WiFi(ui_wifi_mode_t mode);
 void AlertLight_UI_Update_WiFi_Blink(bool blink);  // Enable/disable blinking
 bool AlertLight_UI_IsWiFiBlinking(void);  // Get current WiFi blinking state
 void AlertLight_UI_Update_Alert(const char* region, const char* status, bool is_alert);
+void AlertLight_UI_Update_AlertNeighbours(const char* text);  // Empty text hides the line
 // Structure for outage time range
 typedef struct {
     const char* time_range;  // e.g., "08:30-12:30"
     bool is_active;          // true if this is the currently active outage
 } outage_time_slot_t;
 
+// Rows shown in the light section; extra slots are not displayed
+#define MAX_OUTAGE_SLOTS 6
+
 void AlertLight_UI_Update_Light(const char* queue, const outage_time_slot_t* slots, int num_slots);
 void AlertLight_UI_Update_LightIndicator(bool is_outage);
 void AlertLight_UI_Update_LightIndicator_Emergency(bool is_emergency);
@@ -43,7 +47,7 @@ void AlertLight_UI_Update_LightIndicator_Emergency(bool is_emergency);
 // Tick function - call this in loop()
 void AlertLight_UI_Tick(void);
 
-// Clock update function - call periodically to update time display
+// Clock update function - call every second (time service tick) to update time display
 void AlertLight_UI_Update_Clock(void);
 
 #ifdef __cplusplus
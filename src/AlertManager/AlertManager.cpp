@@ -1,59 +1,253 @@
 #include "AlertManager.h"
 #include "../AlertLight_UI/AlertLight_UI.h"
 #include "../RGBManager/RGBManager.h"
+#include "../TimeService/TimeService.h"
 #include <WiFi.h>
 #include <time.h>
 
 AlertManager alertManager;
 
-AlertManager::AlertManager() {
-    lastCheckTime = 0;
+// Sources, regions or interval saved - check with them now instead of at the old deadline
+static void onConfigChanged(uint64_t changed) {
+    alertManager.forceUpdate();
+}
+
+AlertManager::AlertManager() : scheduler("Alert") {
     lastSuccessTime = 0;
+    lastDismissTime = 0;
     lastHTTPCode = 0;
     alertActive = false;
-    previousAlertActive = false;
+    watchedCount = 0;
+    alertMask = 0;
+    previousAlertMask = 0;
     regionName = "Unknown";
     alertStatus = "Not checked yet";
     lastCallTimeStr = "Never";
     lastError = "";
     lastResponseData = "";
+    lastSourceName = "";
+    sources[0] = &ajaxSource;
+    sources[1] = &ubillingSource;
+    fetchQueue = NULL;
+    fetchRound = 0;
+    fetchesInFlight = 0;
+    roundActive = false;
+    hedgeEnabled = false;
+    hedgeStarted = false;
+    roundPending = 0;
+    roundStartedAt = 0;
+    roundFailed = NULL;
+    homeAlarmType[0] = '\0';
+    memset(&persistedState, 0, sizeof(persistedState));
+    stateStale = false;
+    stateSavedAt = 0;
 }
 
 void AlertManager::begin() {
-    printf("AlertManager initialized\n");
+    fetchQueue = xQueueCreate(ALERT_FETCH_MAX_IN_FLIGHT, sizeof(AlertFetch*));
+    loadWatchedRegions();
+    publishState();
+    configManager.subscribe(CFG_BIT(CFG_ALERT_API_URL) | CFG_BIT(CFG_ALERT_FALLBACK_URL) | CFG_BIT(CFG_ALERT_PUSH_URL) |
+                            CFG_BIT(CFG_ALERT_REGION_ID) | CFG_BIT(CFG_ALERT_EXTRA_COUNT) |
+                            CFG_BIT(CFG_ALERT_EXTRA_REGIONS) | CFG_BIT(CFG_ALERT_CHECK_INTERVAL),
+                            onConfigChanged);
+    printf("AlertManager initialized (%d watched regions)\n", watchedCount);
 }
 
-void AlertManager::update() {
+void AlertManager::restoreState() {
+    loadWatchedRegions();
+
+    AlertStateBlob blob;
+    uint32_t savedAt = 0;
+    if (!stateStore.load("alert", &blob, sizeof(blob), savedAt) || blob.version != ALERT_STATE_VERSION) {
+        printf("No saved alert state\n");
+        return;
+    }
+
+    // Only valid for the same set of watched regions
+    if (blob.count != watchedCount || memcmp(blob.ids, watchedIds, watchedCount * sizeof(uint16_t)) != 0) {
+        printf("Saved alert state is for other regions, ignored\n");
+        return;
+    }
+
+    persistedState = blob;
+    stateSavedAt = savedAt;
+    stateStale = true;
+
+    // Restored as the baseline - no blink now, the first fresh answer blinks if it differs
+    alertMask = blob.mask & ((1 << watchedCount) - 1);
+    previousAlertMask = alertMask;
+    alertActive = (alertMask & 0x01) != 0;
+    strncpy(homeAlarmType, blob.homeAlarmType, sizeof(homeAlarmType) - 1);
+    homeAlarmType[sizeof(homeAlarmType) - 1] = '\0';
+    regionName = RegionMapper::getRegionName(watchedIds[0]);
+    updateStatusText();
+
+    printf("Restored alert state: mask 0x%02X, saved at %lu\n", alertMask, (unsigned long)savedAt);
+    publishState();
+    refreshUI();
+    updateNeighbourUI();
+}
+
+void AlertManager::refreshUI() {
+    if (lastSuccessTime == 0 && !stateStale) {
+        AlertLight_UI_Update_Alert("Not configured", "Not checked yet", false);
+        return;
+    }
+    AlertLight_UI_Update_Alert(regionName.c_str(), alertStatus.c_str(), alertActive);
+}
+
+void AlertManager::publishState() {
+    AlertStateView view;
+    memset(&view, 0, sizeof(view));
+    view.known = isStatusKnown();
+    view.stale = stateStale;
+    view.active = alertActive;
+    view.mask = alertMask;
+    view.watchedCount = watchedCount;
+    memcpy(view.watchedIds, watchedIds, sizeof(view.watchedIds));
+    view.httpCode = lastHTTPCode;
+    DeviceState::copyText(view.region, sizeof(view.region), regionName);
+    DeviceState::copyText(view.source, sizeof(view.source), lastSourceName);
+    DeviceState::copyText(view.lastCall, sizeof(view.lastCall), lastCallTimeStr);
+    DeviceState::copyText(view.lastError, sizeof(view.lastError), lastError);
+    deviceState.publishAlert(view);
+}
+
+void AlertManager::persistState() {
+    AlertStateBlob blob;
+    memset(&blob, 0, sizeof(blob));
+    blob.version = ALERT_STATE_VERSION;
+    blob.count = watchedCount;
+    memcpy(blob.ids, watchedIds, watchedCount * sizeof(uint16_t));
+    blob.mask = alertMask;
+    strncpy(blob.homeAlarmType, homeAlarmType, sizeof(blob.homeAlarmType) - 1);
+
+    // Flash writes only when the state actually changed
+    if (memcmp(&blob, &persistedState, sizeof(blob)) == 0) {
+        return;
+    }
+    if (stateStore.save("alert", &blob, sizeof(blob))) {
+        persistedState = blob;
+    }
+}
+
+void AlertManager::loadWatchedRegions() {
     AlertLightConfig& cfg = configManager.getConfig();
 
+    watchedIds[0] = cfg.alert_region_id;
+    watchedCount = 1;
+    for (uint8_t i = 0; i < cfg.alert_extra_count && watchedCount < ALERT_MAX_REGIONS; i++) {
+        uint16_t id = cfg.alert_extra_regions[i];
+
+        // Skip duplicates (e.g. neighbour set to the home region)
+        bool duplicate = false;
+        for (uint8_t j = 0; j < watchedCount; j++) {
+            if (watchedIds[j] == id) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (!duplicate) {
+            watchedIds[watchedCount++] = id;
+        }
+    }
+
+    // Drop state bits of slots that no longer exist
+    uint8_t validMask = (1 << watchedCount) - 1;
+    alertMask &= validMask;
+    previousAlertMask &= validMask;
+}
+
+void AlertManager::update() {
+    // Legs in flight answer (or fail) on their own, WiFi or not
+    if (roundActive) {
+        pollRound();
+    }
+
     // Check if WiFi is connected
     if (WiFi.status() != WL_CONNECTED) {
+        push.stop();
         return;
     }
 
+    if (isPushEnabled()) {
+        updatePush();
+    } else {
+        push.stop();
+    }
+
     // Check if it's time for a periodic check
-    unsigned long now = millis();
-    if (now - lastCheckTime >= cfg.alert_check_interval * 1000) {
+    if (!roundActive && scheduler.isDue()) {
         checkAlert();
     }
 }
 
 void AlertManager::forceCheck() {
-    checkAlert();
+    if (!roundActive) {
+        checkAlert();
+    }
 }
 
 void AlertManager::forceUpdate() {
+    // Alerts go first after a WiFi connect; small jitter avoids fleet lockstep
+    scheduler.triggerSoon(0, 1000);
+}
+
+unsigned long AlertManager::getPollInterval() {
     AlertLightConfig& cfg = configManager.getConfig();
-    unsigned long checkInterval = cfg.alert_check_interval * 1000;
-    lastCheckTime = millis() - checkInterval - 1;
+    unsigned long interval = cfg.alert_check_interval * 1000UL;
+
+    // Push delivers changes as they happen - no need for fast polling
+    if (push.isHealthy()) {
+        return interval > ALERT_PUSH_SAFETY_POLL_MS ? interval : ALERT_PUSH_SAFETY_POLL_MS;
+    }
+
+    bool recentlyDismissed = lastDismissTime != 0 && millis() - lastDismissTime < ALERT_FAST_POLL_HOLD_MS;
+    if ((alertMask != 0 || recentlyDismissed) && interval > ALERT_FAST_POLL_MS) {
+        interval = ALERT_FAST_POLL_MS;
+    }
+    return interval;
 }
 
-void AlertManager::checkAlert() {
+void AlertManager::updatePush() {
     AlertLightConfig& cfg = configManager.getConfig();
-    lastCheckTime = millis();
+    bool wasHealthy = push.isHealthy();
+
+    String url = ajaxSource.buildUrl(cfg.alert_push_url, watchedIds, watchedCount);
+    String data;
+    if (push.poll(url, data)) {
+        AlertSnapshot snapshot;
+        if (ajaxSource.parse(data, watchedIds, watchedCount, snapshot)) {
+            printf("Alert state pushed by relay\n");
+            lastResponseData = data;
+            lastError = "";
+            lastSuccessTime = millis();
+            lastSourceName = "Push";
+            applySnapshot(snapshot);
+            refreshUI();
+        } else {
+            printf("Push event parse error\n");
+        }
+    }
+
+    bool healthy = push.isHealthy();
+    if (wasHealthy && !healthy) {
+        // Close the gap left by the lost stream right away
+        printf("Push channel lost, resuming polling\n");
+        scheduler.triggerSoon(0, 2000);
+    } else if (!wasHealthy && healthy) {
+        // Stretch the pending poll to the safety-net interval
+        scheduler.reportSuccess(getPollInterval());
+    }
+}
+
+void AlertManager::checkAlert() {
+    // Pick up region changes saved from the web interface
+    loadWatchedRegions();
 
-    printf("\n=== Checking Alert API for region %d ===\n", cfg.alert_region_id);
-    printf("Current state - alertActive: %d, previousAlertActive: %d\n", alertActive, previousAlertActive);
+    printf("\n=== Checking Alert API for %d region(s), home %d ===\n", watchedCount, watchedIds[0]);
+    printf("Current state - alertMask: 0x%02X, previousAlertMask: 0x%02X\n", alertMask, previousAlertMask);
 
     unsigned long uptime = millis() / 1000;
     unsigned long hours = uptime / 3600;
@@ -63,106 +257,274 @@ void AlertManager::checkAlert() {
     snprintf(timeStr, sizeof(timeStr), "%02lu:%02lu:%02lu", hours, minutes, seconds);
     lastCallTimeStr = String(timeStr);
 
-    String url = "https://air-save.ops.ajax.systems/api/mobile/status/regions/v2?regions=" + String(cfg.alert_region_id);
+    AlertLightConfig& cfg = configManager.getConfig();
+    drainStaleFetches();
+    fetchRound++;
+    hedgeEnabled = strlen(cfg.alert_fallback_url) > 0;
+    hedgeStarted = false;
+    roundPending = 0;
+    roundFailed = NULL;
+    roundStartedAt = millis();
+
+    if (startFetch(0)) {
+        roundPending++;
+    } else if (hedgeEnabled) {
+        startHedge();
+    }
+    if (roundPending == 0) {
+        finishRound(NULL);
+        return;
+    }
+    roundActive = true;
+}
 
-    HTTPClient http;
-    http.begin(url);
-    http.setTimeout(10000);
+void AlertManager::pollRound() {
+    AlertLightConfig& cfg = configManager.getConfig();
 
-    int httpCode = http.GET();
-    lastHTTPCode = httpCode;
-    printf("HTTP Response: %d\n", httpCode);
+    AlertFetch* fetch = NULL;
+    while (xQueueReceive(fetchQueue, &fetch, 0) == pdTRUE) {
+        fetchesInFlight--;
+        if (fetch->round != fetchRound) {
+            // Late loser from an earlier round
+            delete fetch;
+            continue;
+        }
+        roundPending--;
 
-    if (httpCode == HTTP_CODE_OK) {
-        String payload = http.getString();
-        lastResponseData = payload;
+        if (fetch->result.ok()) {
+            if (fetch->source != 0) {
+                printf("Hedge won: %s answered first\n", sources[fetch->source]->getName());
+            }
+            delete roundFailed;
+            finishRound(fetch);
+            return;
+        }
 
-        if (parseResponse(payload)) {
+        if (roundFailed == NULL) {
+            roundFailed = fetch;
+        } else {
+            delete fetch;
+        }
+
+        // Primary failed outright - no point waiting out the hedge delay
+        if (hedgeEnabled && !hedgeStarted) {
+            startHedge();
+        }
+    }
+
+    unsigned long elapsed = millis() - roundStartedAt;
+    if (roundPending > 0 && hedgeEnabled && !hedgeStarted && elapsed >= cfg.alert_hedge_ms) {
+        printf("Primary source slower than %u ms, hedging to %s\n", cfg.alert_hedge_ms, sources[1]->getName());
+        startHedge();
+    }
+
+    // Legs still running past the budget are dropped as late losers
+    if (roundPending == 0 || elapsed >= ALERT_FETCH_TIMEOUT_MS) {
+        finishRound(roundFailed);
+    }
+}
+
+void AlertManager::startHedge() {
+    hedgeStarted = true;
+    if (startFetch(1)) {
+        roundPending++;
+    }
+}
+
+void AlertManager::finishRound(AlertFetch* fetch) {
+    roundActive = false;
+    roundFailed = NULL;  // Owned by the caller now, if it was passed in
+
+    if (fetch == NULL) {
+        lastHTTPCode = 0;
+        lastError = "No alert source answered in time";
+        lastResponseData = "";
+        printf("Alert API error: %s\n", lastError.c_str());
+        scheduler.reportFailure();
+        publishState();
+        return;
+    }
+
+    AlertSource* source = sources[fetch->source];
+    lastHTTPCode = fetch->result.httpCode;
+    printf("HTTP Response from %s: %d (%s)\n", source->getName(), fetch->result.httpCode,
+           UpstreamClient::errorToString(fetch->result.error));
+
+    if (fetch->result.ok()) {
+        timeService.seedFromHttpDate(fetch->result.date);
+        lastResponseData = fetch->result.body;
+
+        AlertSnapshot snapshot;
+        if (source->parse(lastResponseData, watchedIds, watchedCount, snapshot)) {
             lastError = "";
             lastSuccessTime = millis();
-            AlertLight_UI_Update_Alert(regionName.c_str(), alertStatus.c_str(), alertActive);
+            lastSourceName = source->getName();
+            applySnapshot(snapshot);
+            refreshUI();
+            scheduler.reportSuccess(getPollInterval());
         } else {
-            lastError = "Failed to parse JSON response";
+            lastError = String("Failed to parse JSON response from ") + source->getName();
             printf("Alert parse error\n");
+            scheduler.reportFailure();
         }
-    } else if (httpCode > 0) {
-        lastError = "HTTP error " + String(httpCode) + ": " + http.errorToString(httpCode);
-        lastResponseData = "";
-        printf("Alert API error: %d\n", httpCode);
     } else {
-        lastError = "Connection failed: " + http.errorToString(httpCode);
+        lastError = String(source->getName()) + ": " + upstreamClient.describe(fetch->result);
         lastResponseData = "";
-        printf("Alert connection error\n");
+        printf("Alert API error: %s\n", lastError.c_str());
+        scheduler.reportFailure();
     }
 
-    http.end();
+    delete fetch;
+    publishState();
 }
 
-bool AlertManager::parseResponse(const String& json) {
-    StaticJsonDocument<2048> doc;
-    DeserializationError error = deserializeJson(doc, json);
+bool AlertManager::startFetch(uint8_t source) {
+    AlertLightConfig& cfg = configManager.getConfig();
 
-    if (error) {
-        printf("JSON parse error\n");
+    if (fetchQueue == NULL || fetchesInFlight >= ALERT_FETCH_MAX_IN_FLIGHT) {
+        printf("Alert fetch skipped: %d request(s) still in flight\n", fetchesInFlight);
         return false;
     }
 
-    if (!doc.containsKey("alarms") || !doc["alarms"].is<JsonArray>()) {
-        printf("No 'alarms' array in response\n");
+    const char* baseUrl = (source == 0) ? cfg.alert_api_url : cfg.alert_fallback_url;
+
+    AlertFetch* fetch = new AlertFetch();
+    fetch->round = fetchRound;
+    fetch->source = source;
+    fetch->url = sources[source]->buildUrl(baseUrl, watchedIds, watchedCount);
+
+    // Network core - TLS handshakes stay off the core running LVGL and loop()
+    if (xTaskCreatePinnedToCore(fetchTask, "alert_fetch", ALERT_FETCH_STACK_SIZE, fetch, 1, NULL,
+                                ALERT_FETCH_CORE) != pdPASS) {
+        printf("Alert fetch task creation failed\n");
+        delete fetch;
         return false;
     }
+    fetchesInFlight++;
+    return true;
+}
 
-    JsonArray alarms = doc["alarms"].as<JsonArray>();
-    AlertLightConfig& cfg = configManager.getConfig();
+void AlertManager::drainStaleFetches() {
+    AlertFetch* fetch = NULL;
+    while (xQueueReceive(fetchQueue, &fetch, 0) == pdTRUE) {
+        fetchesInFlight--;
+        delete fetch;
+    }
+}
 
-    regionName = RegionMapper::getRegionName(cfg.alert_region_id);
+void AlertManager::fetchTask(void* param) {
+    AlertFetch* fetch = (AlertFetch*)param;
+    fetch->result = upstreamClient.get(fetch->url);
 
-    // Determine alert status based on response
-    if (alarms.size() == 0) {
-        printf("No alarms in response - setting alertActive=false\n");
-        alertActive = false;
-        alertStatus = "No Alert";
+    // Ownership passes to AlertManager; queue has a slot per in-flight leg
+    xQueueSend(alertManager.fetchQueue, &fetch, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+void AlertManager::applySnapshot(const AlertSnapshot& snapshot) {
+    regionName = RegionMapper::getRegionName(watchedIds[0]);
+
+    alertMask = snapshot.mask & ((1 << watchedCount) - 1);
+    alertActive = (alertMask & 0x01) != 0;
+    strncpy(homeAlarmType, snapshot.homeAlarmType, sizeof(homeAlarmType) - 1);
+    homeAlarmType[sizeof(homeAlarmType) - 1] = '\0';
+    stateStale = false;
+
+    if (alertActive) {
+        printf("FOUND home region %d in alarms - setting alertActive=true\n", watchedIds[0]);
     } else {
-        printf("Searching %d alarms for region %d\n", alarms.size(), cfg.alert_region_id);
-        bool foundOurRegion = false;
-        for (JsonVariant v : alarms) {
-            JsonObject alarm = v.as<JsonObject>();
-            int alarmRegionId = alarm["regionId"].as<int>();
-
-            if (alarm.containsKey("regionId") && alarmRegionId == cfg.alert_region_id) {
-                foundOurRegion = true;
-                alertActive = true;
-                printf("FOUND region %d in alarms - setting alertActive=true\n", cfg.alert_region_id);
-
-                if (alarm.containsKey("alarmType")) {
-                    alertStatus = alarm["alarmType"].as<String>() + " Alert";
-                } else {
-                    alertStatus = "Active Alert";
-                }
-                break;
-            }
+        printf("Home region %d NOT found in alarms - setting alertActive=false\n", watchedIds[0]);
+    }
+    updateStatusText();
+
+    // Detect per-region state changes and notify RGB manager / UI
+    uint8_t changedMask = alertMask ^ previousAlertMask;
+    if (changedMask != 0) {
+        handleAlertChanges(changedMask);
+        previousAlertMask = alertMask;
+    }
+
+    persistState();
+    publishState();
+}
+
+void AlertManager::updateStatusText() {
+    if (alertActive) {
+        alertStatus = homeAlarmType[0] != '\0' ? String(homeAlarmType) + " Alert" : "Active Alert";
+    } else {
+        alertStatus = "No Alert";
+    }
+    if (stateStale) {
+        alertStatus += " (cached)";
+    }
+}
+
+void AlertManager::handleAlertChanges(uint8_t changedMask) {
+    for (uint8_t i = 0; i < watchedCount; i++) {
+        if (!(changedMask & (1 << i))) {
+            continue;
         }
 
-        if (!foundOurRegion) {
-            printf("Region %d NOT found in alarms - setting alertActive=false\n", cfg.alert_region_id);
-            alertActive = false;
-            alertStatus = "No Alert";
+        bool active = (alertMask & (1 << i)) != 0;
+        String name = RegionMapper::getRegionName(watchedIds[i]);
+        printf("Alert state changed for %s (slot %d): %s\n", name.c_str(), i,
+               active ? "NO ALERT -> ALERT" : "ALERT -> NO ALERT");
+        if (!active) {
+            lastDismissTime = millis();
+        }
+
+        // The LED blinks for the home region only; neighbours show on the neighbour line
+        if (i == 0) {
+            if (active) {
+                rgbManager.notifyAlertStarted();
+            } else {
+                rgbManager.notifyAlertDismissed();
+            }
         }
     }
 
-    // Detect state changes and notify RGB manager
-    if (alertActive != previousAlertActive) {
-        if (alertActive) {
-            printf("Alert state changed: NO ALERT -> ALERT (triggering red blink)\n");
-            rgbManager.notifyAlertStarted();
-        } else {
-            printf("Alert state changed: ALERT -> NO ALERT (triggering green blink)\n");
-            rgbManager.notifyAlertDismissed();
+    // Neighbour line only needs a refresh when a non-home slot changed
+    if (changedMask & ~0x01) {
+        updateNeighbourUI();
+    }
+}
+
+void AlertManager::updateNeighbourUI() {
+    String text = "";
+    for (uint8_t i = 1; i < watchedCount; i++) {
+        if (alertMask & (1 << i)) {
+            text += (text.length() > 0) ? ", " : "+ ";
+            text += RegionMapper::getRegionName(watchedIds[i]);
         }
-        previousAlertActive = alertActive;
     }
+    AlertLight_UI_Update_AlertNeighbours(text.c_str());
+}
 
-    return true;
+bool AlertManager::isPushEnabled() {
+    return strlen(configManager.getConfig().alert_push_url) > 0;
+}
+
+bool AlertManager::isPushHealthy() {
+    return push.isHealthy();
+}
+
+String AlertManager::getPushStatus() {
+    if (!isPushEnabled()) {
+        return "Disabled";
+    }
+    return push.getStatus();
+}
+
+bool AlertManager::isStatusKnown() {
+    return lastHTTPCode == 200 || stateStale;
+}
+
+bool AlertManager::isStateStale() {
+    return stateStale;
+}
+
+uint32_t AlertManager::getStateSavedAt() {
+    return stateSavedAt;
 }
 
 String AlertManager::getLastCallTime() {
@@ -188,3 +550,35 @@ bool AlertManager::isAlertActive() {
 String AlertManager::getRegionName() {
     return regionName;
 }
+
+String AlertManager::getLastSourceName() {
+    return lastSourceName;
+}
+
+unsigned long AlertManager::getNextCheckIn() {
+    return scheduler.getMillisUntilDue();
+}
+
+uint8_t AlertManager::getFailureCount() {
+    return scheduler.getFailureCount();
+}
+
+uint8_t AlertManager::getWatchedCount() {
+    return watchedCount;
+}
+
+uint16_t AlertManager::getWatchedRegionId(uint8_t slot) {
+    return slot < watchedCount ? watchedIds[slot] : 0;
+}
+
+bool AlertManager::isRegionAlertActive(uint8_t slot) {
+    return slot < watchedCount && (alertMask & (1 << slot)) != 0;
+}
+
+bool AlertManager::isAnyNeighbourAlertActive() {
+    return (alertMask & ~0x01) != 0;
+}
+
+uint8_t AlertManager::getAlertMask() {
+    return alertMask;
+}
@@ -2,10 +2,50 @@
 #define ALERTMANAGER_H
 
 #include <Arduino.h>
-#include <HTTPClient.h>
 #include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
 #include "../Config/Config.h"
 #include "../RegionMapper/RegionMapper.h"
+#include "../PollScheduler/PollScheduler.h"
+#include "../Upstream/UpstreamClient.h"
+#include "../AlertSource/AlertSource.h"
+#include "../AlertPush/AlertPush.h"
+#include "../StateStore/StateStore.h"
+#include "../DeviceState/DeviceState.h"
+
+// Poll faster while an alert is active and for a while after it is dismissed
+#define ALERT_FAST_POLL_MS          10000UL
+#define ALERT_FAST_POLL_HOLD_MS     600000UL  // 10 minutes after dismissal
+
+// While the push relay is streaming, polling is only a safety net
+#define ALERT_PUSH_SAFETY_POLL_MS   600000UL
+
+// Hedged fetch across alert sources (0 = primary, 1 = fallback)
+#define ALERT_SOURCE_COUNT          2
+#define ALERT_FETCH_TIMEOUT_MS      (UPSTREAM_CONNECT_TIMEOUT_MS + UPSTREAM_READ_TIMEOUT_MS + 2000)
+#define ALERT_FETCH_MAX_IN_FLIGHT   3
+#define ALERT_FETCH_STACK_SIZE      10240
+#define ALERT_FETCH_CORE            0       // WiFi/lwIP core; loop() and LVGL run on core 1
+
+// One request leg; owned by its fetch task until posted to the result queue
+struct AlertFetch {
+    uint32_t round;
+    uint8_t source;
+    String url;
+    UpstreamResult result;
+};
+
+// Warm start snapshot in StateStore; bump the version when the layout changes
+#define ALERT_STATE_VERSION         1
+
+struct AlertStateBlob {
+    uint8_t version;
+    uint8_t count;
+    uint16_t ids[ALERT_MAX_REGIONS];
+    uint8_t mask;
+    char homeAlarmType[24];
+};
 
 class AlertManager {
 public:
@@ -17,6 +57,12 @@ public:
     // Call this in loop to handle periodic checks
     void update();
 
+    // Restore the last saved state (call before WiFi starts); shown as cached until refreshed
+    void restoreState();
+
+    // Push the current state to the alert section of the UI
+    void refreshUI();
+
     // Force an immediate check (for testing)
     void forceCheck();
 
@@ -30,10 +76,27 @@ public:
     String getLastResponse();
     bool isAlertActive();
     String getRegionName();
+    String getLastSourceName();
+    unsigned long getNextCheckIn();  // milliseconds
+    uint8_t getFailureCount();
+    bool isStatusKnown();            // fresh API answer or restored snapshot
+    bool isStateStale();             // restored snapshot, not confirmed by the API yet
+    uint32_t getStateSavedAt();      // epoch of the restored snapshot, 0 if unknown
+    bool isPushEnabled();
+    bool isPushHealthy();
+    String getPushStatus();
+
+    // Watched regions (slot 0 is the home region)
+    uint8_t getWatchedCount();
+    uint16_t getWatchedRegionId(uint8_t slot);
+    bool isRegionAlertActive(uint8_t slot);
+    bool isAnyNeighbourAlertActive();
+    uint8_t getAlertMask();
 
 private:
-    unsigned long lastCheckTime;
+    PollScheduler scheduler;
     unsigned long lastSuccessTime;
+    unsigned long lastDismissTime;  // millis() of the last alert dismissal (0 = never)
 
     // Debug info
     String lastCallTimeStr;
@@ -43,15 +106,69 @@ private:
 
     // Alert state
     bool alertActive;
-    bool previousAlertActive;  // Track previous state for RGB notifications
     String regionName;
     String alertStatus;
+    char homeAlarmType[24];
+
+    // Warm start
+    AlertStateBlob persistedState;  // Last blob written to / read from NVS
+    bool stateStale;
+    uint32_t stateSavedAt;
+    void persistState();
+
+    // Copy the reader-facing state into deviceState
+    void publishState();
+
+    // Watched regions and their alert state (one bit per slot)
+    uint16_t watchedIds[ALERT_MAX_REGIONS];
+    uint8_t watchedCount;
+    uint8_t alertMask;
+    uint8_t previousAlertMask;
+
+    // Rebuild watched region list from config
+    void loadWatchedRegions();
 
-    // Perform the API check
+    // Notify RGB and UI about per-region changes
+    void handleAlertChanges(uint8_t changedMask);
+    void updateNeighbourUI();
+
+    // Alert sources and hedged fetch state
+    AjaxAlertSource ajaxSource;
+    UbillingAlertSource ubillingSource;
+    AlertSource* sources[ALERT_SOURCE_COUNT];
+    QueueHandle_t fetchQueue;
+    uint32_t fetchRound;
+    uint8_t fetchesInFlight;
+    String lastSourceName;
+
+    // Optional push channel (SSE relay), polling takes over when it goes silent
+    AlertPushClient push;
+    void updatePush();
+
+    // Current poll interval based on alert state
+    unsigned long getPollInterval();
+
+    // Start the API check; the answer is picked up by pollRound()
     void checkAlert();
 
-    // Parse JSON response
-    bool parseResponse(const String& json);
+    // Hedged round: the primary source first, the fallback too when the
+    // primary is slow or fails. Stepped from update(), never waits on a leg.
+    bool roundActive;
+    bool hedgeEnabled;
+    bool hedgeStarted;
+    uint8_t roundPending;
+    unsigned long roundStartedAt;
+    AlertFetch* roundFailed;  // First failed leg, kept for diagnostics
+    void pollRound();
+    void startHedge();
+    void finishRound(AlertFetch* fetch);  // fetch: winning leg, a failed one or NULL
+    bool startFetch(uint8_t source);
+    void drainStaleFetches();
+    static void fetchTask(void* param);
+
+    // Apply a normalized snapshot and detect state changes
+    void applySnapshot(const AlertSnapshot& snapshot);
+    void updateStatusText();
 };
 
 extern AlertManager alertManager;
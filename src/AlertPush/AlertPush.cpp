@@ -0,0 +1,326 @@
+#include "AlertPush.h"
+
+AlertPushClient::AlertPushClient() : reconnect("Push") {
+    client = NULL;
+    connectQueue = NULL;
+    connecting = false;
+    connectAbandoned = false;
+    candidate = NULL;
+    connectPort = 0;
+    connectedUrl = "";
+    openedAt = 0;
+    statusRead = false;
+    headersDone = false;
+    lastActivity = 0;
+    streamReceived = false;
+    eventCount = 0;
+    lineLength = 0;
+    lineOverflow = false;
+    eventData = "";
+}
+
+bool AlertPushClient::poll(const String& url, String& data) {
+    // Region list changed - the relay needs a new subscription
+    if (client != NULL && url != connectedUrl) {
+        disconnect("subscription changed");
+        reconnect.triggerSoon(0, 0);
+    }
+
+    if (client == NULL) {
+        if (connecting) {
+            if (!pollConnect()) {
+                return false;
+            }
+        } else {
+            if (!reconnect.isDue()) {
+                return false;
+            }
+            if (!connect(url)) {
+                reconnect.reportFailure();
+            }
+            return false;
+        }
+    }
+
+    if (!client->connected() && client->available() == 0) {
+        disconnect("closed by relay");
+        return false;
+    }
+
+    if (!headersDone && millis() - openedAt > ALERT_PUSH_CONNECT_TIMEOUT_MS) {
+        disconnect("no response from relay");
+        return false;
+    }
+    if (headersDone && millis() - (streamReceived ? lastActivity : openedAt) > ALERT_PUSH_SILENCE_MS) {
+        disconnect("relay silent");
+        return false;
+    }
+
+    // Drain whatever has arrived, stop at the first complete event
+    while (client->available() > 0) {
+        int c = client->read();
+        if (c < 0) {
+            break;
+        }
+        if (headersDone) {
+            lastActivity = millis();
+            streamReceived = true;
+        }
+
+        if (c == '\n') {
+            line[lineLength] = '\0';
+            if (!headersDone) {
+                bool accepted = processHeaderLine();
+                lineLength = 0;
+                lineOverflow = false;
+                if (!accepted) {
+                    return false;
+                }
+                continue;
+            }
+            bool eventReady = processLine();
+            lineLength = 0;
+            lineOverflow = false;
+            if (eventReady) {
+                data = eventData;
+                eventData = "";
+                eventCount++;
+                return true;
+            }
+        } else if (c != '\r') {
+            if (lineLength < ALERT_PUSH_LINE_MAX - 1) {
+                line[lineLength++] = (char)c;
+            } else {
+                lineOverflow = true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool AlertPushClient::processHeaderLine() {
+    if (!statusRead) {
+        if (lineOverflow || strstr(line, " 200") == NULL) {
+            printf("[Push] Relay refused stream: %s\n", line);
+            disconnect("refused");
+            return false;
+        }
+        statusRead = true;
+        return true;
+    }
+
+    // Headers are skipped; the empty line starts the stream
+    if (lineLength == 0) {
+        headersDone = true;
+        openedAt = millis();
+        printf("[Push] Stream open\n");
+    }
+    return true;
+}
+
+bool AlertPushClient::processLine() {
+    if (lineOverflow) {
+        printf("[Push] Line longer than %d bytes, event dropped\n", ALERT_PUSH_LINE_MAX);
+        eventData = "";
+        return false;
+    }
+
+    // Empty line dispatches the buffered event
+    if (lineLength == 0) {
+        return eventData.length() > 0;
+    }
+
+    // Heartbeat / comment
+    if (line[0] == ':') {
+        return false;
+    }
+
+    if (strncmp(line, "data:", 5) == 0) {
+        const char* value = line + 5;
+        if (*value == ' ') {
+            value++;
+        }
+        if (eventData.length() + strlen(value) > ALERT_PUSH_EVENT_MAX) {
+            printf("[Push] Event larger than %d bytes, dropped\n", ALERT_PUSH_EVENT_MAX);
+            eventData = "";
+            return false;
+        }
+        if (eventData.length() > 0) {
+            eventData += "\n";
+        }
+        eventData += value;
+    }
+
+    // "event:", "id:", "retry:" are not used by the relay
+    return false;
+}
+
+bool AlertPushClient::connect(const String& url) {
+    bool secure = url.startsWith("https://");
+    int hostStart = url.indexOf("://");
+    if (hostStart < 0) {
+        printf("[Push] Invalid URL: %s\n", url.c_str());
+        return false;
+    }
+    hostStart += 3;
+
+    int pathStart = url.indexOf('/', hostStart);
+    String hostPort = (pathStart < 0) ? url.substring(hostStart) : url.substring(hostStart, pathStart);
+    String path = (pathStart < 0) ? "/" : url.substring(pathStart);
+
+    String host = hostPort;
+    uint16_t port = secure ? 443 : 80;
+    int colon = hostPort.indexOf(':');
+    if (colon >= 0) {
+        host = hostPort.substring(0, colon);
+        port = hostPort.substring(colon + 1).toInt();
+    }
+
+    if (connectQueue == NULL) {
+        connectQueue = xQueueCreate(1, sizeof(bool));
+        if (connectQueue == NULL) {
+            return false;
+        }
+    }
+
+    printf("[Push] Connecting to %s:%d%s\n", host.c_str(), port, path.c_str());
+
+    candidate = &plainClient;
+    if (secure) {
+        // Same trust model as HTTPClient elsewhere in the firmware (no CA bundle)
+        secureClient.setInsecure();
+        secureClient.setHandshakeTimeout((ALERT_PUSH_CONNECT_TIMEOUT_MS + 999) / 1000);
+        candidate = &secureClient;
+    }
+
+    // HTTP/1.0 keeps the relay from switching to chunked transfer encoding
+    connectUrl = url;
+    connectHost = host;
+    connectPort = port;
+    connectRequest = "GET " + path + " HTTP/1.0\r\n" +
+                     "Host: " + host + "\r\n" +
+                     "Accept: text/event-stream\r\n" +
+                     "Cache-Control: no-cache\r\n\r\n";
+
+    // Network core - the TLS handshake stays off the core running LVGL and loop()
+    if (xTaskCreatePinnedToCore(connectTask, "push_connect", ALERT_PUSH_CONNECT_STACK_SIZE, this, 1, NULL,
+                                ALERT_PUSH_CONNECT_CORE) != pdPASS) {
+        printf("[Push] Connect task creation failed\n");
+        candidate = NULL;
+        return false;
+    }
+    connecting = true;
+    connectAbandoned = false;
+    return true;
+}
+
+void AlertPushClient::connectTask(void* param) {
+    AlertPushClient* self = (AlertPushClient*)param;
+    bool ok = self->candidate->connect(self->connectHost.c_str(), self->connectPort, ALERT_PUSH_CONNECT_TIMEOUT_MS);
+    if (ok) {
+        ok = self->candidate->print(self->connectRequest) == self->connectRequest.length();
+    }
+
+    // Hands candidate back to the loop task
+    xQueueSend(self->connectQueue, &ok, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+bool AlertPushClient::pollConnect() {
+    bool ok = false;
+    if (xQueueReceive(connectQueue, &ok, 0) != pdTRUE) {
+        return false;
+    }
+    connecting = false;
+
+    if (connectAbandoned) {
+        candidate->stop();
+        candidate = NULL;
+        reconnect.triggerSoon(0, 0);
+        return false;
+    }
+    if (!ok) {
+        printf("[Push] Connect failed\n");
+        candidate->stop();
+        candidate = NULL;
+        reconnect.reportFailure();
+        return false;
+    }
+
+    // Status line and headers are read by poll() as they arrive
+    client = candidate;
+    candidate = NULL;
+    connectedUrl = connectUrl;
+    openedAt = millis();
+    statusRead = false;
+    headersDone = false;
+    lastActivity = 0;
+    streamReceived = false;
+    lineLength = 0;
+    lineOverflow = false;
+    eventData = "";
+    return true;
+}
+
+void AlertPushClient::disconnect(const char* reason) {
+    if (client == NULL) {
+        return;
+    }
+    printf("[Push] Stream closed: %s\n", reason);
+    client->stop();
+    client = NULL;
+    connectedUrl = "";
+
+    // A stream that never delivered anything counts as a failed attempt
+    if (streamReceived) {
+        reconnect.reportSuccess(ALERT_PUSH_RECONNECT_MS);
+    } else {
+        reconnect.reportFailure();
+    }
+}
+
+void AlertPushClient::stop() {
+    // The connect task still owns the socket; pollConnect() closes it when done
+    if (connecting) {
+        connectAbandoned = true;
+        return;
+    }
+    if (client == NULL) {
+        return;
+    }
+    disconnect("stopped");
+
+    // Not the relay's fault - reconnect as soon as push is wanted again
+    reconnect.triggerSoon(0, 0);
+}
+
+bool AlertPushClient::isHealthy() {
+    // An open stream that has sent nothing yet does not relax polling
+    return client != NULL && streamReceived && millis() - lastActivity <= ALERT_PUSH_SILENCE_MS;
+}
+
+String AlertPushClient::getStatus() {
+    if (connecting) {
+        return "Connecting";
+    }
+    if (client == NULL) {
+        if (reconnect.getFailureCount() > 0) {
+            return "Disconnected, retry in " + String(reconnect.getMillisUntilDue() / 1000) + "s (" +
+                   String(reconnect.getFailureCount()) + " failures)";
+        }
+        return "Disconnected";
+    }
+    if (!headersDone) {
+        return "Connecting";
+    }
+    if (!streamReceived) {
+        return "Stream open, no data yet";
+    }
+    return "Streaming, last data " + String((millis() - lastActivity) / 1000) + "s ago, " +
+           String(eventCount) + " events";
+}
+
+unsigned long AlertPushClient::getEventCount() {
+    return eventCount;
+}
@@ -0,0 +1,91 @@
+#ifndef ALERTPUSH_H
+#define ALERTPUSH_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "../PollScheduler/PollScheduler.h"
+
+// Relay must send something (event or ":" heartbeat) at least this often
+#define ALERT_PUSH_SILENCE_MS       90000UL
+#define ALERT_PUSH_CONNECT_TIMEOUT_MS 5000
+#define ALERT_PUSH_CONNECT_STACK_SIZE 8192
+#define ALERT_PUSH_CONNECT_CORE     0       // WiFi/lwIP core; loop() and LVGL run on core 1
+#define ALERT_PUSH_RECONNECT_MS     2000UL   // After a clean drop of a working stream
+#define ALERT_PUSH_LINE_MAX         512
+#define ALERT_PUSH_EVENT_MAX        2048
+
+// Server-Sent Events client for a self-hosted alert relay.
+// The relay keeps the connection open and pushes the Ajax-format
+// {"alarms":[...]} state for the requested regions whenever it changes:
+//
+//   data: {"alarms":[{"regionId":16,"alarmType":"AIR"}]}
+//   <empty line>
+//
+// Lines starting with ':' are heartbeats. Nothing here blocks the caller:
+// the TCP/TLS connect and the request run in a short-lived task on the
+// network core, and poll() reads the response as it arrives.
+class AlertPushClient {
+public:
+    AlertPushClient();
+
+    // Keep the stream to url open; returns true when a complete event is in data
+    bool poll(const String& url, String& data);
+
+    // Close the stream (push disabled or WiFi lost)
+    void stop();
+
+    // Stream open and heard from the relay (event or heartbeat) recently
+    bool isHealthy();
+
+    // Debug info
+    String getStatus();
+    unsigned long getEventCount();
+
+private:
+    WiFiClient plainClient;
+    WiFiClientSecure secureClient;
+    WiFiClient* client;           // Points at one of the above while connected
+
+    // Connect in progress: the task owns candidate until it posts the outcome
+    QueueHandle_t connectQueue;
+    bool connecting;
+    bool connectAbandoned;        // stop() during the connect - close it once done
+    WiFiClient* candidate;
+    String connectUrl;
+    String connectHost;
+    uint16_t connectPort;
+    String connectRequest;
+
+    PollScheduler reconnect;
+    String connectedUrl;
+    unsigned long openedAt;       // millis() of the request, then of the end of the headers
+    bool statusRead;              // "HTTP/1.x 200" line accepted
+    bool headersDone;             // Status line and headers read
+    unsigned long lastActivity;   // millis() of the last stream byte, 0 = none yet
+    bool streamReceived;          // Anything received past the headers
+    unsigned long eventCount;
+
+    char line[ALERT_PUSH_LINE_MAX];
+    size_t lineLength;
+    bool lineOverflow;
+    String eventData;
+
+    // Start the connect task; false if it could not even be started
+    bool connect(const String& url);
+    static void connectTask(void* param);
+
+    // Pick up the connect outcome; true once the stream can be read
+    bool pollConnect();
+    void disconnect(const char* reason);
+
+    // Handle one complete line; returns true when it ends an event
+    bool processLine();
+
+    // Status line or header; false when the relay refused the stream
+    bool processHeaderLine();
+};
+
+#endif // ALERTPUSH_H
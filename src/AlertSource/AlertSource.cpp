@@ -0,0 +1,94 @@
+#include "AlertSource.h"
+
+// ---- Ajax ----
+
+String AjaxAlertSource::buildUrl(const char* baseUrl, const uint16_t* regionIds, uint8_t count) const {
+    // Base URL ends with "regions=", all watched regions go in one list
+    String url = baseUrl;
+    for (uint8_t i = 0; i < count; i++) {
+        if (i > 0) url += ",";
+        url += String(regionIds[i]);
+    }
+    return url;
+}
+
+bool AjaxAlertSource::parse(const String& json, const uint16_t* regionIds, uint8_t count, AlertSnapshot& out) const {
+    StaticJsonDocument<2048> doc;
+    DeserializationError error = deserializeJson(doc, json);
+
+    if (error) {
+        printf("[Ajax] JSON parse error\n");
+        return false;
+    }
+
+    if (!doc.containsKey("alarms") || !doc["alarms"].is<JsonArray>()) {
+        printf("[Ajax] No 'alarms' array in response\n");
+        return false;
+    }
+
+    JsonArray alarms = doc["alarms"].as<JsonArray>();
+    out.mask = 0;
+    out.homeAlarmType[0] = '\0';
+
+    // Single pass over the alarms: set one bit per watched region on alert
+    for (JsonVariant v : alarms) {
+        JsonObject alarm = v.as<JsonObject>();
+        if (!alarm.containsKey("regionId")) {
+            continue;
+        }
+        int alarmRegionId = alarm["regionId"].as<int>();
+
+        for (uint8_t i = 0; i < count; i++) {
+            if (regionIds[i] == alarmRegionId) {
+                out.mask |= (1 << i);
+                if (i == 0 && alarm.containsKey("alarmType")) {
+                    strncpy(out.homeAlarmType, alarm["alarmType"].as<const char*>(), sizeof(out.homeAlarmType) - 1);
+                    out.homeAlarmType[sizeof(out.homeAlarmType) - 1] = '\0';
+                }
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+// ---- Ubilling ----
+
+String UbillingAlertSource::buildUrl(const char* baseUrl, const uint16_t* regionIds, uint8_t count) const {
+    // Returns every region - no filtering on the server side
+    return String(baseUrl);
+}
+
+bool UbillingAlertSource::parse(const String& json, const uint16_t* regionIds, uint8_t count, AlertSnapshot& out) const {
+    // Full state list for all regions, too big for the stack
+    DynamicJsonDocument doc(6144);
+    DeserializationError error = deserializeJson(doc, json);
+
+    if (error) {
+        printf("[Ubilling] JSON parse error\n");
+        return false;
+    }
+
+    if (!doc.containsKey("states")) {
+        printf("[Ubilling] No 'states' object in response\n");
+        return false;
+    }
+
+    JsonObject states = doc["states"].as<JsonObject>();
+    out.mask = 0;
+    out.homeAlarmType[0] = '\0';
+
+    // Only look up the watched regions by name
+    for (uint8_t i = 0; i < count; i++) {
+        const char* name = RegionMapper::getFullRegionName(regionIds[i]);
+        if (name == NULL || !states.containsKey(name)) {
+            continue;
+        }
+        if (states[name]["alertnow"].as<bool>()) {
+            out.mask |= (1 << i);
+        }
+    }
+
+    return true;
+}
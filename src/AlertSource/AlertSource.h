@@ -0,0 +1,46 @@
+#ifndef ALERTSOURCE_H
+#define ALERTSOURCE_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "../RegionMapper/RegionMapper.h"
+
+// Common region/alarm model every alert source is normalized to.
+// Bit N of mask is set when watched region N is on alert.
+struct AlertSnapshot {
+    uint8_t mask;
+    char homeAlarmType[24];   // e.g. "AIR" for the home region, empty if unknown
+};
+
+// Pluggable upstream alert data source
+class AlertSource {
+public:
+    virtual ~AlertSource() {}
+
+    virtual const char* getName() const = 0;
+
+    // Build request URL for the watched regions (one request for all of them)
+    virtual String buildUrl(const char* baseUrl, const uint16_t* regionIds, uint8_t count) const = 0;
+
+    // Parse response body into the normalized snapshot
+    virtual bool parse(const String& json, const uint16_t* regionIds, uint8_t count, AlertSnapshot& out) const = 0;
+};
+
+// Ajax Systems air-save API: {"alarms":[{"regionId":16,"alarmType":"AIR"}, ...]}
+class AjaxAlertSource : public AlertSource {
+public:
+    const char* getName() const override { return "Ajax"; }
+    String buildUrl(const char* baseUrl, const uint16_t* regionIds, uint8_t count) const override;
+    bool parse(const String& json, const uint16_t* regionIds, uint8_t count, AlertSnapshot& out) const override;
+};
+
+// Ubilling aerial alerts mirror: {"states":{"Київська область":{"alertnow":true}, ...}}
+// Regions are keyed by their full Ukrainian name (same as RegionMapper)
+class UbillingAlertSource : public AlertSource {
+public:
+    const char* getName() const override { return "Ubilling"; }
+    String buildUrl(const char* baseUrl, const uint16_t* regionIds, uint8_t count) const override;
+    bool parse(const String& json, const uint16_t* regionIds, uint8_t count, AlertSnapshot& out) const override;
+};
+
+#endif // ALERTSOURCE_H
@@ -1,212 +1,734 @@
 #include "Config.h"
+#include <ArduinoJson.h>
+#include <nvs.h>
+#include <stddef.h>
+#include <type_traits>
+
+#define CONFIG_NAMESPACE    "alertlight"
+#define CONFIG_BLOB_KEY     "cfg"
+#define CONFIG_BLOB_MAGIC   0x46434C41      // "ALCF"
+#define CONFIG_BLOB_VERSION 1
+#define CONFIG_JSON_SIZE    4096
+#define NVS_ENTRY_BYTES     32
 
 ConfigManager configManager;
 
+struct ConfigFieldInfo {
+    const char* name;               // JSON member
+    const char* key;                // Per-key layout before the blob
+    uint8_t type;
+    uint8_t flags;
+    uint16_t offset;
+    uint16_t size;
+    uint16_t elementSize;           // Lists: one entry
+};
+
+#define CFG_INFO_ENTRY(id, member, key, kind, def, flags) \
+    {#member, key, CFG_TYPE_##kind, flags, offsetof(AlertLightConfig, member), sizeof(AlertLightConfig::member), \
+     sizeof(std::remove_extent<decltype(AlertLightConfig::member)>::type)},
+
+// Indexed by ConfigField
+static const ConfigFieldInfo FIELD_INFO[CFG_FIELD_COUNT] = {
+    CONFIG_FIELDS(CFG_INFO_ENTRY)
+};
+
+static_assert(CFG_FIELD_COUNT <= 64, "dirty mask is 64 bits");
+static_assert(CFG_FIELD_COUNT <= 255, "blob field id is one byte");
+
+// Blob: header, then one record per field - id (1 byte), length (1 byte),
+// value. Text is stored up to its terminator. Unknown ids are skipped and
+// missing fields keep their defaults, so adding a field needs no version
+// bump; the version is for changes to this encoding.
+struct ConfigBlobHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;                // Of the records
+    uint32_t crc;                   // CRC-32 of the records
+};
+
+#define CONFIG_BLOB_MAX (sizeof(ConfigBlobHeader) + sizeof(AlertLightConfig) + 2 * CFG_FIELD_COUNT)
+
+#define CFG_SIZE_CHECK(id, member, key, kind, def, flags) \
+    static_assert(sizeof(AlertLightConfig::member) <= 255, #member " does not fit a blob record");
+CONFIG_FIELDS(CFG_SIZE_CHECK)
+#undef CFG_SIZE_CHECK
+
+static uint8_t blobBuffer[CONFIG_BLOB_MAX];
+
+static uint32_t crc32(const uint8_t* data, size_t length) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+// Flash programmed for a blob: a header entry plus its data entries
+static uint32_t blobEntryBytes(size_t length) {
+    return NVS_ENTRY_BYTES * (1 + (length + NVS_ENTRY_BYTES - 1) / NVS_ENTRY_BYTES);
+}
+
+static uint8_t countBits(uint64_t mask) {
+    uint8_t count = 0;
+    for (; mask != 0; mask &= mask - 1) {
+        count++;
+    }
+    return count;
+}
+
 ConfigManager::ConfigManager() {
+    dirty = 0;
+    memset(&stats, 0, sizeof(stats));
+    loadSource = CONFIG_SOURCE_DEFAULTS;
+    legacyKeys = false;
+    subscriberCount = 0;
 }
 
 void ConfigManager::begin() {
-    preferences.begin("alertlight", false);  // false = read/write mode
+    preferences.begin(CONFIG_NAMESPACE, false);  // false = read/write mode
+    stats.totalBytes = preferences.getUInt("wear_bytes", 0);
 
     // Try to load existing config
     if (!load()) {
-        // No saved config, use defaults
+        // No saved config, use defaults (all fields dirty)
         resetToDefaults();
         save();
+    } else if (hasChanges()) {
+        // Migrated or repaired - store the blob now
+        save();
     }
+    printf("Config: %s\n", loadSourceToString(loadSource));
 }
 
 void ConfigManager::setDefaults() {
-    // WiFi defaults
-    strcpy(config.wifi_ssid, "");
-    strcpy(config.wifi_password, "");
-    config.use_static_ip = false;
-    strcpy(config.static_ip, "192.168.1.100");
-    strcpy(config.static_gateway, "192.168.1.1");
-    strcpy(config.static_subnet, "255.255.255.0");
-
-    // Web server defaults
-    config.web_port = 8080;
-
-    // Alert API defaults
-    strcpy(config.alert_api_url, "https://air-save.ops.ajax.systems/api/mobile/status/regions/v2?regions=");
-    config.alert_region_id = 16;  // Kyiv
-    config.alert_check_interval = 30;  // 5 minutes
-
-    // Light outage API defaults
-    strcpy(config.light_api_url, "https://app.yasno.ua/api/blackout-service/public/shutdowns/regions/25/dsos/902/planned-outages");
-    strcpy(config.light_queue, "6.2");
-    config.light_check_interval = 900;  // 15 minutes
-
-    // Yasno address selection defaults
-    config.yasno_street_id = 0;
-    strcpy(config.yasno_street_name, "");
-    config.yasno_house_id = 0;
-    strcpy(config.yasno_house_name, "");
-
-    // RGB LED defaults
-    config.ambient_brightness = 10;  // 10%
-    config.color_no_alert = 0x00FF00;  // Green
-    config.color_alert = 0xFF0000;     // Red
-    config.color_outage = 0x0000FF;    // Dark blue
-    config.color_no_status = 0x808080; // Grey
-    config.blink_on_duration = 500;
-    config.blink_off_duration = 500;
-    config.blink_total_duration = 30;
-    config.color_blink_alert = 0xFF0000;    // Red
-    config.color_blink_alert_dismiss = 0x00FF00;  // Green
-    config.color_blink_outage = 0x00008B;   // Dark blue
-    config.color_blink_restore = 0xFFFF00;  // Yellow
-
-    // Display defaults
-    config.display_brightness = 90;  // 90%
+    memset(&config, 0, sizeof(config));
+#define CFG_DEFAULT_ENTRY(id, member, key, kind, def, flags) applyDefault(id, def);
+    CONFIG_FIELDS(CFG_DEFAULT_ENTRY)
+#undef CFG_DEFAULT_ENTRY
+}
+
+void ConfigManager::applyDefault(ConfigField field, const char* text) {
+    const ConfigFieldInfo& info = FIELD_INFO[field];
+    char* dest = (char*)fieldPtr(field);
+    strncpy(dest, text, info.size - 1);
+    dest[info.size - 1] = '\0';
+}
+
+void ConfigManager::applyDefault(ConfigField field, int value) {
+    void* dest = fieldPtr(field);
+    switch (FIELD_INFO[field].type) {
+        case CFG_TYPE_BOOL:
+        case CFG_TYPE_U8:
+            *(uint8_t*)dest = (uint8_t)value;
+            break;
+        case CFG_TYPE_U16:
+            *(uint16_t*)dest = (uint16_t)value;
+            break;
+        case CFG_TYPE_U32:
+            *(uint32_t*)dest = (uint32_t)value;
+            break;
+        default:
+            break;  // Lists start empty (zeroed)
+    }
 }
 
 bool ConfigManager::load() {
-    // Check if config exists
+    if (loadBlob()) {
+        loadSource = CONFIG_SOURCE_BLOB;
+        return true;
+    }
+    bool corrupt = preferences.isKey(CONFIG_BLOB_KEY);
+
+    if (loadLegacy()) {
+        loadSource = corrupt ? CONFIG_SOURCE_CORRUPT : CONFIG_SOURCE_MIGRATED;
+        return true;
+    }
+
+    if (corrupt) {
+        // Nothing to fall back to; begin() stores fresh defaults
+        loadSource = CONFIG_SOURCE_CORRUPT;
+    }
+    return false;
+}
+
+bool ConfigManager::loadBlob() {
+    if (!preferences.isKey(CONFIG_BLOB_KEY)) {
+        return false;
+    }
+    size_t length = preferences.getBytesLength(CONFIG_BLOB_KEY);
+    if (length < sizeof(ConfigBlobHeader) || length > sizeof(blobBuffer)) {
+        if (length > 0) {
+            printf("Config: blob has a bad size (%u)\n", (unsigned)length);
+        }
+        return false;
+    }
+    if (preferences.getBytes(CONFIG_BLOB_KEY, blobBuffer, length) != length) {
+        return false;
+    }
+
+    setDefaults();
+    if (!decodeBlob(blobBuffer, length)) {
+        setDefaults();
+        return false;
+    }
+    validate();
+    dirty = 0;
+    return true;
+}
+
+bool ConfigManager::loadLegacy() {
     if (!preferences.isKey("initialized")) {
         return false;
     }
 
-    // Load WiFi settings
-    preferences.getString("wifi_ssid", config.wifi_ssid, sizeof(config.wifi_ssid));
-    preferences.getString("wifi_pass", config.wifi_password, sizeof(config.wifi_password));
-    config.use_static_ip = preferences.getBool("use_static_ip", false);
-    preferences.getString("static_ip", config.static_ip, sizeof(config.static_ip));
-    preferences.getString("static_gw", config.static_gateway, sizeof(config.static_gateway));
-    preferences.getString("static_sn", config.static_subnet, sizeof(config.static_subnet));
-
-    // Load web server settings
-    config.web_port = preferences.getUShort("web_port", 8080);
-
-    // Load Alert API settings
-    preferences.getString("alert_url", config.alert_api_url, sizeof(config.alert_api_url));
-    config.alert_region_id = preferences.getUShort("alert_region", 16);
-    config.alert_check_interval = preferences.getUInt("alert_interval", 300);
-
-    // Load Light outage API settings
-    preferences.getString("light_url", config.light_api_url, sizeof(config.light_api_url));
-    preferences.getString("light_queue", config.light_queue, sizeof(config.light_queue));
-    config.light_check_interval = preferences.getUInt("light_interval", 900);
-
-    // Load Yasno address selection
-    config.yasno_street_id = preferences.getUInt("yasno_str_id", 0);
-    preferences.getString("yasno_str_nm", config.yasno_street_name, sizeof(config.yasno_street_name));
-    config.yasno_house_id = preferences.getUInt("yasno_hse_id", 0);
-    preferences.getString("yasno_hse_nm", config.yasno_house_name, sizeof(config.yasno_house_name));
-
-    // Load RGB LED settings
-    config.ambient_brightness = preferences.getUChar("rgb_ambient", 10);
-    config.color_no_alert = preferences.getUInt("rgb_no_alert", 0x00FF00);
-    config.color_alert = preferences.getUInt("rgb_alert", 0xFF0000);
-    config.color_outage = preferences.getUInt("rgb_outage", 0x0000FF);
-    config.color_no_status = preferences.getUInt("rgb_no_status", 0x808080);
-    config.blink_on_duration = preferences.getUShort("blink_on", 500);
-    config.blink_off_duration = preferences.getUShort("blink_off", 500);
-    config.blink_total_duration = preferences.getUShort("blink_total", 30);
-    config.color_blink_alert = preferences.getUInt("blink_alert", 0xFF0000);
-    config.color_blink_alert_dismiss = preferences.getUInt("blink_dismiss", 0x00FF00);
-    config.color_blink_outage = preferences.getUInt("blink_outage", 0x00008B);
-    config.color_blink_restore = preferences.getUInt("blink_restore", 0xFFFF00);
-
-    // Load display settings
-    config.display_brightness = preferences.getUChar("disp_bright", 90);
+    // Defaults first: keys added after the device was set up may be missing
+    setDefaults();
+    for (uint8_t i = 0; i < CFG_FIELD_COUNT; i++) {
+        const ConfigFieldInfo& info = FIELD_INFO[i];
+        if (info.key[0] == '\0' || !preferences.isKey(info.key)) {
+            continue;
+        }
+        void* dest = fieldPtr((ConfigField)i);
+        switch (info.type) {
+            case CFG_TYPE_BOOL:
+                *(bool*)dest = preferences.getBool(info.key, false);
+                break;
+            case CFG_TYPE_U8:
+                *(uint8_t*)dest = preferences.getUChar(info.key, 0);
+                break;
+            case CFG_TYPE_U16:
+                *(uint16_t*)dest = preferences.getUShort(info.key, 0);
+                break;
+            case CFG_TYPE_U32:
+                *(uint32_t*)dest = preferences.getUInt(info.key, 0);
+                break;
+            case CFG_TYPE_TEXT:
+                preferences.getString(info.key, (char*)dest, info.size);
+                break;
+            case CFG_TYPE_U16_LIST:
+            case CFG_TYPE_TEXT_LIST:
+                preferences.getBytes(info.key, dest, info.size);
+                break;
+        }
+    }
+    validate();
+
+    // Everything goes into the blob on the next save, the old keys go away
+    dirty = (CFG_FIELD_COUNT == 64) ? ~0ULL : (1ULL << CFG_FIELD_COUNT) - 1;
+    legacyKeys = true;
+    printf("Config: read %d fields from the per-key layout\n", CFG_FIELD_COUNT);
+    return true;
+}
+
+// Bring loaded or imported values into range (through the setters, so a
+// repair is saved)
+void ConfigManager::validate() {
+    if (config.alert_extra_count > ALERT_MAX_REGIONS - 1) {
+        setU8(CFG_ALERT_EXTRA_COUNT, 0);
+    }
+    if (config.light_extra_count > LIGHT_MAX_QUEUES - 1) {
+        setU8(CFG_LIGHT_EXTRA_COUNT, 0);
+    }
+    if (config.led_count < 1 || config.led_count > LED_MAX_PIXELS) {
+        setU16(CFG_LED_COUNT, constrain(config.led_count, 1, LED_MAX_PIXELS));
+    }
+    if (config.led_layout != LED_LAYOUT_WHOLE && config.led_layout != LED_LAYOUT_SPLIT) {
+        setU8(CFG_LED_LAYOUT, LED_LAYOUT_WHOLE);
+    }
+    if (config.led_color_order != LED_ORDER_RGB && config.led_color_order != LED_ORDER_GRB) {
+        setU8(CFG_LED_COLOR_ORDER, LED_ORDER_RGB);
+    }
+    if (config.web_port == 0) {
+        setU16(CFG_WEB_PORT, 8080);
+    }
+    // 0 s would leave the blink running forever
+    if (config.blink_total_duration < 1) {
+        setU16(CFG_BLINK_TOTAL_DURATION, 1);
+    }
+    if (config.blink_info_duration < 1) {
+        setU16(CFG_BLINK_INFO_DURATION, 1);
+    }
+    // Text must be terminated whatever was stored
+    for (uint8_t i = 0; i < CFG_FIELD_COUNT; i++) {
+        const ConfigFieldInfo& info = FIELD_INFO[i];
+        char* text = (char*)fieldPtr((ConfigField)i);
+        if (info.type == CFG_TYPE_TEXT) {
+            text[info.size - 1] = '\0';
+        } else if (info.type == CFG_TYPE_TEXT_LIST) {
+            for (uint16_t at = info.elementSize - 1; at < info.size; at += info.elementSize) {
+                text[at] = '\0';
+            }
+        }
+    }
+}
+
+size_t ConfigManager::encodeBlob(uint8_t* blob) {
+    uint8_t* records = blob + sizeof(ConfigBlobHeader);
+    size_t length = 0;
+    for (uint8_t i = 0; i < CFG_FIELD_COUNT; i++) {
+        const ConfigFieldInfo& info = FIELD_INFO[i];
+        const uint8_t* value = (const uint8_t*)fieldPtr((ConfigField)i);
+        size_t size = info.size;
+        if (info.type == CFG_TYPE_TEXT) {
+            size = strnlen((const char*)value, info.size - 1) + 1;
+        }
+        records[length++] = i;
+        records[length++] = (uint8_t)size;
+        memcpy(records + length, value, size);
+        length += size;
+    }
+
+    ConfigBlobHeader header;
+    header.magic = CONFIG_BLOB_MAGIC;
+    header.version = CONFIG_BLOB_VERSION;
+    header.length = length;
+    header.crc = crc32(records, length);
+    memcpy(blob, &header, sizeof(header));
+    return sizeof(header) + length;
+}
+
+bool ConfigManager::decodeBlob(const uint8_t* blob, size_t length) {
+    ConfigBlobHeader header;
+    memcpy(&header, blob, sizeof(header));
+    const uint8_t* records = blob + sizeof(header);
 
+    if (header.magic != CONFIG_BLOB_MAGIC || header.length != length - sizeof(header)) {
+        printf("Config: blob header invalid\n");
+        return false;
+    }
+    if (crc32(records, header.length) != header.crc) {
+        printf("Config: blob CRC mismatch\n");
+        return false;
+    }
+    if (header.version != CONFIG_BLOB_VERSION) {
+        // Only version 1 exists; a future encoding change is converted here
+        printf("Config: blob version %u, expected %u\n", header.version, CONFIG_BLOB_VERSION);
+        return false;
+    }
+
+    size_t at = 0;
+    while (at + 2 <= header.length) {
+        uint8_t id = records[at];
+        uint8_t size = records[at + 1];
+        at += 2;
+        if (at + size > header.length) {
+            printf("Config: blob record %u truncated\n", id);
+            return false;
+        }
+        if (id < CFG_FIELD_COUNT) {
+            const ConfigFieldInfo& info = FIELD_INFO[id];
+            bool fixed = info.type != CFG_TYPE_TEXT && info.type != CFG_TYPE_TEXT_LIST &&
+                         info.type != CFG_TYPE_U16_LIST;
+            if (!fixed || size == info.size) {
+                // Lists and text may have grown or shrunk since they were stored
+                memcpy(fieldPtr((ConfigField)id), records + at, min((size_t)size, (size_t)info.size));
+            }
+        }
+        at += size;
+    }
     return true;
 }
 
 bool ConfigManager::save() {
-    // Mark as initialized
-    preferences.putBool("initialized", true);
-
-    // Save WiFi settings
-    preferences.putString("wifi_ssid", config.wifi_ssid);
-    preferences.putString("wifi_pass", config.wifi_password);
-    preferences.putBool("use_static_ip", config.use_static_ip);
-    preferences.putString("static_ip", config.static_ip);
-    preferences.putString("static_gw", config.static_gateway);
-    preferences.putString("static_sn", config.static_subnet);
-
-    // Save web server settings
-    preferences.putUShort("web_port", config.web_port);
-
-    // Save Alert API settings
-    preferences.putString("alert_url", config.alert_api_url);
-    preferences.putUShort("alert_region", config.alert_region_id);
-    preferences.putUInt("alert_interval", config.alert_check_interval);
-
-    // Save Light outage API settings
-    preferences.putString("light_url", config.light_api_url);
-    preferences.putString("light_queue", config.light_queue);
-    preferences.putUInt("light_interval", config.light_check_interval);
-
-    // Save Yasno address selection
-    preferences.putUInt("yasno_str_id", config.yasno_street_id);
-    preferences.putString("yasno_str_nm", config.yasno_street_name);
-    preferences.putUInt("yasno_hse_id", config.yasno_house_id);
-    preferences.putString("yasno_hse_nm", config.yasno_house_name);
-
-    // Save RGB LED settings
-    preferences.putUChar("rgb_ambient", config.ambient_brightness);
-    preferences.putUInt("rgb_no_alert", config.color_no_alert);
-    preferences.putUInt("rgb_alert", config.color_alert);
-    preferences.putUInt("rgb_outage", config.color_outage);
-    preferences.putUInt("rgb_no_status", config.color_no_status);
-    preferences.putUShort("blink_on", config.blink_on_duration);
-    preferences.putUShort("blink_off", config.blink_off_duration);
-    preferences.putUShort("blink_total", config.blink_total_duration);
-    preferences.putUInt("blink_alert", config.color_blink_alert);
-    preferences.putUInt("blink_dismiss", config.color_blink_alert_dismiss);
-    preferences.putUInt("blink_outage", config.color_blink_outage);
-    preferences.putUInt("blink_restore", config.color_blink_restore);
-
-    // Save display settings
-    preferences.putUChar("disp_bright", config.display_brightness);
+    if (dirty == 0) {
+        stats.skippedSaves++;
+        return true;
+    }
+
+    // Web forms write straight through the setters
+    validate();
+
+    size_t length = encodeBlob(blobBuffer);
+
+    // Raw NVS handle on the same namespace: the blob, the removal of the old
+    // per-key entries and the wear counter all go out in a single commit
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(CONFIG_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        printf("Config: NVS open failed (%s)\n", esp_err_to_name(err));
+        return false;
+    }
 
+    uint32_t bytes = blobEntryBytes(length) + NVS_ENTRY_BYTES;
+    err = nvs_set_blob(handle, CONFIG_BLOB_KEY, blobBuffer, length);
+    if (err == ESP_OK && legacyKeys) {
+        for (uint8_t i = 0; i < CFG_FIELD_COUNT; i++) {
+            if (FIELD_INFO[i].key[0] != '\0') {
+                nvs_erase_key(handle, FIELD_INFO[i].key);  // Missing keys are fine
+            }
+        }
+        nvs_erase_key(handle, "initialized");
+    }
+    if (err == ESP_OK) {
+        // The counter rides along in the same commit
+        err = nvs_set_u32(handle, "wear_bytes", stats.totalBytes + bytes);
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    if (err != ESP_OK) {
+        // Keep everything dirty so the next save retries
+        printf("Config: save failed (%s)\n", esp_err_to_name(err));
+        return false;
+    }
+
+    uint64_t changed = dirty;
+    stats.saves++;
+    stats.lastFields = countBits(changed);
+    stats.lastBytes = bytes;
+    stats.totalBytes += bytes;
+    dirty = 0;
+    legacyKeys = false;
+    printf("Config saved: %u field(s) changed, %u byte blob, %lu bytes programmed (%lu total)\n",
+           stats.lastFields, (unsigned)length, (unsigned long)bytes, (unsigned long)stats.totalBytes);
+
+    dispatch(changed);
     return true;
 }
 
+bool ConfigManager::subscribe(uint64_t fieldMask, ConfigChangeCallback callback) {
+    if (callback == NULL || subscriberCount >= CONFIG_MAX_SUBSCRIBERS) {
+        printf("Config: subscriber table full\n");
+        return false;
+    }
+    subscribers[subscriberCount].fieldMask = fieldMask;
+    subscribers[subscriberCount].callback = callback;
+    subscriberCount++;
+    return true;
+}
+
+void ConfigManager::dispatch(uint64_t changed) {
+    for (uint8_t i = 0; i < subscriberCount; i++) {
+        if ((subscribers[i].fieldMask & changed) != 0) {
+            subscribers[i].callback(changed);
+        }
+    }
+}
+
 void ConfigManager::resetToDefaults() {
     setDefaults();
+    dirty = (CFG_FIELD_COUNT == 64) ? ~0ULL : (1ULL << CFG_FIELD_COUNT) - 1;
 }
 
 AlertLightConfig& ConfigManager::getConfig() {
     return config;
 }
 
+void* ConfigManager::fieldPtr(ConfigField field) {
+    return (uint8_t*)&config + FIELD_INFO[field].offset;
+}
+
+bool ConfigManager::setField(ConfigField field, uint8_t type, const void* value, size_t size) {
+    if (field >= CFG_FIELD_COUNT) {
+        return false;
+    }
+    const ConfigFieldInfo& info = FIELD_INFO[field];
+    // Bool and u8 share storage; anything else must match exactly
+    bool typeOk = info.type == type || (info.type == CFG_TYPE_BOOL && type == CFG_TYPE_U8);
+    if (!typeOk || size != info.size) {
+        printf("Config: wrong setter for %s\n", info.name);
+        return false;
+    }
+    void* current = fieldPtr(field);
+    if (memcmp(current, value, size) == 0) {
+        return false;
+    }
+    memcpy(current, value, size);
+    dirty |= 1ULL << field;
+    return true;
+}
+
+bool ConfigManager::setBool(ConfigField field, bool value) {
+    return setField(field, CFG_TYPE_BOOL, &value, sizeof(value));
+}
+
+bool ConfigManager::setU8(ConfigField field, uint8_t value) {
+    return setField(field, CFG_TYPE_U8, &value, sizeof(value));
+}
+
+bool ConfigManager::setU16(ConfigField field, uint16_t value) {
+    return setField(field, CFG_TYPE_U16, &value, sizeof(value));
+}
+
+bool ConfigManager::setU32(ConfigField field, uint32_t value) {
+    return setField(field, CFG_TYPE_U32, &value, sizeof(value));
+}
+
+bool ConfigManager::setText(ConfigField field, const char* value) {
+    if (field >= CFG_FIELD_COUNT || FIELD_INFO[field].type != CFG_TYPE_TEXT) {
+        return false;
+    }
+    char* current = (char*)fieldPtr(field);
+    size_t size = FIELD_INFO[field].size;
+    if (strncmp(current, value, size - 1) == 0) {     // Equal once truncated
+        return false;
+    }
+    strncpy(current, value, size - 1);
+    current[size - 1] = '\0';
+    dirty |= 1ULL << field;
+    return true;
+}
+
+bool ConfigManager::setBytes(ConfigField field, const void* value, size_t size) {
+    if (field >= CFG_FIELD_COUNT) {
+        return false;
+    }
+    uint8_t type = FIELD_INFO[field].type;
+    if (type != CFG_TYPE_U16_LIST && type != CFG_TYPE_TEXT_LIST) {
+        type = CFG_TYPE_U16_LIST;   // Not a list - let setField() reject it
+    }
+    return setField(field, type, value, size);
+}
+
+void ConfigManager::markDirty(ConfigField field) {
+    if (field < CFG_FIELD_COUNT) {
+        dirty |= 1ULL << field;
+    }
+}
+
+bool ConfigManager::isDirty(ConfigField field) {
+    return field < CFG_FIELD_COUNT && (dirty & (1ULL << field)) != 0;
+}
+
+bool ConfigManager::hasChanges() {
+    return dirty != 0;
+}
+
+const ConfigWriteStats& ConfigManager::getWriteStats() {
+    return stats;
+}
+
+ConfigLoadSource ConfigManager::getLoadSource() {
+    return loadSource;
+}
+
+const char* ConfigManager::loadSourceToString(ConfigLoadSource source) {
+    switch (source) {
+        case CONFIG_SOURCE_BLOB: return "loaded from NVS blob";
+        case CONFIG_SOURCE_MIGRATED: return "migrated from per-key layout";
+        case CONFIG_SOURCE_CORRUPT: return "stored blob was corrupt, rebuilt";
+        default: return "factory defaults";
+    }
+}
+
+const char* ConfigManager::getFieldName(ConfigField field) {
+    return field < CFG_FIELD_COUNT ? FIELD_INFO[field].name : "";
+}
+
+String ConfigManager::exportJson(bool includeSecrets) {
+    DynamicJsonDocument doc(CONFIG_JSON_SIZE);
+    doc["version"] = CONFIG_BLOB_VERSION;
+    JsonObject fields = doc.createNestedObject("config");
+
+    for (uint8_t i = 0; i < CFG_FIELD_COUNT; i++) {
+        const ConfigFieldInfo& info = FIELD_INFO[i];
+        if ((info.flags & CFG_FLAG_SECRET) && !includeSecrets) {
+            continue;
+        }
+        const uint8_t* value = (const uint8_t*)fieldPtr((ConfigField)i);
+        switch (info.type) {
+            case CFG_TYPE_BOOL:
+                fields[info.name] = *(const bool*)value;
+                break;
+            case CFG_TYPE_U8:
+                fields[info.name] = *value;
+                break;
+            case CFG_TYPE_U16:
+                fields[info.name] = *(const uint16_t*)value;
+                break;
+            case CFG_TYPE_U32:
+                fields[info.name] = *(const uint32_t*)value;
+                break;
+            case CFG_TYPE_TEXT:
+                fields[info.name] = (const char*)value;
+                break;
+            case CFG_TYPE_U16_LIST: {
+                JsonArray list = fields.createNestedArray(info.name);
+                for (uint16_t at = 0; at < info.size; at += info.elementSize) {
+                    list.add(*(const uint16_t*)(value + at));
+                }
+                break;
+            }
+            case CFG_TYPE_TEXT_LIST: {
+                JsonArray list = fields.createNestedArray(info.name);
+                for (uint16_t at = 0; at < info.size; at += info.elementSize) {
+                    list.add((const char*)(value + at));
+                }
+                break;
+            }
+        }
+    }
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
+bool ConfigManager::importJson(const String& json, String& error) {
+    DynamicJsonDocument doc(CONFIG_JSON_SIZE);
+    DeserializationError parseError = deserializeJson(doc, json);
+    if (parseError) {
+        error = String("JSON parse error: ") + parseError.c_str();
+        return false;
+    }
+    JsonObject fields = doc["config"];
+    if (fields.isNull()) {
+        error = "Missing \"config\" object";
+        return false;
+    }
+
+    // Apply to a copy of the state and roll back on the first bad value
+    AlertLightConfig before = config;
+    uint64_t dirtyBefore = dirty;
+    uint8_t applied = 0;
+
+    for (uint8_t i = 0; i < CFG_FIELD_COUNT && error.length() == 0; i++) {
+        const ConfigFieldInfo& info = FIELD_INFO[i];
+        ConfigField field = (ConfigField)i;
+        JsonVariant value = fields[info.name];
+        if (value.isNull()) {
+            continue;
+        }
+        uint32_t limit = info.type == CFG_TYPE_U8 ? 0xFF : (info.type == CFG_TYPE_U16 ? 0xFFFF : 0xFFFFFFFF);
+
+        switch (info.type) {
+            case CFG_TYPE_BOOL:
+                if (!value.is<bool>()) {
+                    error = String(info.name) + ": expected true/false";
+                } else {
+                    setBool(field, value.as<bool>());
+                }
+                break;
+            case CFG_TYPE_U8:
+            case CFG_TYPE_U16:
+            case CFG_TYPE_U32:
+                if (!value.is<uint32_t>() || value.as<uint32_t>() > limit) {
+                    error = String(info.name) + ": expected a number up to " + String(limit);
+                } else if (info.type == CFG_TYPE_U8) {
+                    setU8(field, value.as<uint8_t>());
+                } else if (info.type == CFG_TYPE_U16) {
+                    setU16(field, value.as<uint16_t>());
+                } else {
+                    setU32(field, value.as<uint32_t>());
+                }
+                break;
+            case CFG_TYPE_TEXT:
+                if (!value.is<const char*>()) {
+                    error = String(info.name) + ": expected a string";
+                } else {
+                    setText(field, value.as<const char*>());
+                }
+                break;
+            case CFG_TYPE_U16_LIST:
+            case CFG_TYPE_TEXT_LIST: {
+                JsonArray list = value.as<JsonArray>();
+                uint8_t buffer[64];
+                if (!value.is<JsonArray>() || list.size() * info.elementSize > info.size || info.size > sizeof(buffer)) {
+                    error = String(info.name) + ": expected a list of up to " + String(info.size / info.elementSize);
+                    break;
+                }
+                memset(buffer, 0, info.size);
+                uint16_t at = 0;
+                for (JsonVariant item : list) {
+                    if (info.type == CFG_TYPE_U16_LIST) {
+                        if (!item.is<uint16_t>()) {
+                            error = String(info.name) + ": expected numbers up to 65535";
+                            break;
+                        }
+                        uint16_t number = item.as<uint16_t>();
+                        memcpy(buffer + at, &number, sizeof(number));
+                    } else {
+                        if (!item.is<const char*>()) {
+                            error = String(info.name) + ": expected a list of strings";
+                            break;
+                        }
+                        strncpy((char*)buffer + at, item.as<const char*>(), info.elementSize - 1);
+                    }
+                    at += info.elementSize;
+                }
+                if (error.length() == 0) {
+                    setBytes(field, buffer, info.size);
+                }
+                break;
+            }
+        }
+        applied++;
+    }
+
+    if (error.length() > 0) {
+        config = before;
+        dirty = dirtyBefore;
+        return false;
+    }
+    validate();
+    printf("Config: imported %u field(s), %u changed\n", applied, countBits(dirty & ~dirtyBefore));
+    return true;
+}
+
 void ConfigManager::setWiFiCredentials(const char* ssid, const char* password) {
-    strncpy(config.wifi_ssid, ssid, sizeof(config.wifi_ssid) - 1);
-    strncpy(config.wifi_password, password, sizeof(config.wifi_password) - 1);
+    setText(CFG_WIFI_SSID, ssid);
+    setText(CFG_WIFI_PASSWORD, password);
 }
 
 void ConfigManager::setStaticIP(const char* ip, const char* gateway, const char* subnet) {
-    config.use_static_ip = true;
-    strncpy(config.static_ip, ip, sizeof(config.static_ip) - 1);
-    strncpy(config.static_gateway, gateway, sizeof(config.static_gateway) - 1);
-    strncpy(config.static_subnet, subnet, sizeof(config.static_subnet) - 1);
+    setBool(CFG_USE_STATIC_IP, true);
+    setText(CFG_STATIC_IP, ip);
+    setText(CFG_STATIC_GATEWAY, gateway);
+    setText(CFG_STATIC_SUBNET, subnet);
 }
 
 void ConfigManager::setAlertAPI(const char* url, uint16_t region_id, uint32_t interval) {
-    strncpy(config.alert_api_url, url, sizeof(config.alert_api_url) - 1);
-    config.alert_region_id = region_id;
-    config.alert_check_interval = interval;
+    setText(CFG_ALERT_API_URL, url);
+    setU16(CFG_ALERT_REGION_ID, region_id);
+    setU32(CFG_ALERT_CHECK_INTERVAL, interval);
+}
+
+void ConfigManager::setAlertExtraRegions(const uint16_t* region_ids, uint8_t count) {
+    if (count > ALERT_MAX_REGIONS - 1) {
+        count = ALERT_MAX_REGIONS - 1;
+    }
+    uint16_t regions[ALERT_MAX_REGIONS - 1];
+    memset(regions, 0, sizeof(regions));
+    for (uint8_t i = 0; i < count; i++) {
+        regions[i] = region_ids[i];
+    }
+    setBytes(CFG_ALERT_EXTRA_REGIONS, regions, sizeof(regions));
+    setU8(CFG_ALERT_EXTRA_COUNT, count);
 }
 
 void ConfigManager::setLightAPI(const char* url, const char* queue, uint32_t interval) {
-    strncpy(config.light_api_url, url, sizeof(config.light_api_url) - 1);
-    strncpy(config.light_queue, queue, sizeof(config.light_queue) - 1);
-    config.light_check_interval = interval;
+    setText(CFG_LIGHT_API_URL, url);
+    setText(CFG_LIGHT_QUEUE, queue);
+    setU32(CFG_LIGHT_CHECK_INTERVAL, interval);
+}
+
+void ConfigManager::setLightExtraQueues(const char queues[][8], uint8_t count) {
+    if (count > LIGHT_MAX_QUEUES - 1) {
+        count = LIGHT_MAX_QUEUES - 1;
+    }
+    char extra[LIGHT_MAX_QUEUES - 1][8];
+    memset(extra, 0, sizeof(extra));
+    for (uint8_t i = 0; i < count; i++) {
+        strncpy(extra[i], queues[i], sizeof(extra[i]) - 1);
+    }
+    setBytes(CFG_LIGHT_EXTRA_QUEUES, extra, sizeof(extra));
+    setU8(CFG_LIGHT_EXTRA_COUNT, count);
 }
 
 void ConfigManager::setRGBColors(uint32_t no_alert, uint32_t alert, uint32_t outage, uint32_t no_status) {
-    config.color_no_alert = no_alert;
-    config.color_alert = alert;
-    config.color_outage = outage;
-    config.color_no_status = no_status;
+    setU32(CFG_COLOR_NO_ALERT, no_alert);
+    setU32(CFG_COLOR_ALERT, alert);
+    setU32(CFG_COLOR_OUTAGE, outage);
+    setU32(CFG_COLOR_NO_STATUS, no_status);
 }
 
 void ConfigManager::setRGBBlinkSettings(uint16_t on_ms, uint16_t off_ms, uint16_t total_sec) {
-    config.blink_on_duration = on_ms;
-    config.blink_off_duration = off_ms;
-    config.blink_total_duration = total_sec;
+    setU16(CFG_BLINK_ON_DURATION, on_ms);
+    setU16(CFG_BLINK_OFF_DURATION, off_ms);
+    setU16(CFG_BLINK_TOTAL_DURATION, total_sec);
 }
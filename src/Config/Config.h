@@ -4,6 +4,26 @@
 #include <Arduino.h>
 #include <Preferences.h>
 
+// Maximum number of watched alert regions (home region + neighbours).
+// Alert state is kept as a bitmask, so this must stay <= 8.
+#define ALERT_MAX_REGIONS 4
+
+// Maximum number of outage queues (configured address + extra addresses).
+// All of them come from the same schedule response.
+#define LIGHT_MAX_QUEUES 3
+
+// Addressable LED strip on the RGB pin. The frame and its RMT symbols are
+// sized from the configured length; this caps both.
+#define LED_MAX_PIXELS 300
+
+// How the strip shows status
+#define LED_LAYOUT_WHOLE 0              // Whole strip in the ambient colour
+#define LED_LAYOUT_SPLIT 1              // Alert status on the left half, outage status on the right
+
+// Byte order the LEDs expect on the wire
+#define LED_ORDER_RGB 0                 // Onboard LED
+#define LED_ORDER_GRB 1                 // Most WS2812 strips
+
 // Configuration structure
 struct AlertLightConfig {
     // WiFi Settings
@@ -18,13 +38,20 @@ struct AlertLightConfig {
     uint16_t web_port;
 
     // Alert API Settings
-    char alert_api_url[128];
-    uint16_t alert_region_id;
+    char alert_api_url[128];        // Primary source (Ajax), region list is appended
+    char alert_fallback_url[128];   // Hedge source (Ubilling), empty = no hedging
+    uint16_t alert_hedge_ms;        // Latency budget before the hedge request is sent
+    char alert_push_url[128];       // SSE relay (Ajax format), region list is appended; empty = polling only
+    uint16_t alert_region_id;       // Home region (watched slot 0)
+    uint8_t alert_extra_count;      // Number of additional watched regions
+    uint16_t alert_extra_regions[ALERT_MAX_REGIONS - 1];
     uint32_t alert_check_interval;  // seconds
 
     // Light Outage API Settings
     char light_api_url[128];
-    char light_queue[8];
+    char light_queue[8];            // Queue of the Yasno address below
+    uint8_t light_extra_count;      // Number of additional queues (other addresses)
+    char light_extra_queues[LIGHT_MAX_QUEUES - 1][8];
     uint32_t light_check_interval;  // seconds
 
     // Yasno address selection (persisted for display and reuse)
@@ -41,16 +68,120 @@ struct AlertLightConfig {
     uint32_t color_no_status;
     uint16_t blink_on_duration;     // milliseconds
     uint16_t blink_off_duration;    // milliseconds
-    uint16_t blink_total_duration;  // seconds
+    uint16_t blink_total_duration;  // seconds, alert and outage start
+    uint16_t blink_info_duration;   // seconds, alert dismiss, power restore, schedule change
     uint32_t color_blink_alert;
     uint32_t color_blink_alert_dismiss;  // Green blink when alert dismissed
     uint32_t color_blink_outage;
     uint32_t color_blink_restore;
+    uint32_t color_blink_schedule;  // Outage schedule changed
+    uint16_t led_count;             // Pixels on the strip (1 = onboard LED only)
+    uint8_t led_layout;             // LED_LAYOUT_*
+    uint8_t led_color_order;        // LED_ORDER_*
 
     // Display Settings
     uint8_t display_brightness;     // 0-100%
 };
 
+// How a field is stored and exported
+enum ConfigFieldType : uint8_t {
+    CFG_TYPE_BOOL,
+    CFG_TYPE_U8,
+    CFG_TYPE_U16,
+    CFG_TYPE_U32,
+    CFG_TYPE_TEXT,                  // char[], always terminated
+    CFG_TYPE_U16_LIST,              // uint16_t[]
+    CFG_TYPE_TEXT_LIST              // char[][N]
+};
+
+#define CFG_FLAG_NONE   0
+#define CFG_FLAG_SECRET 1           // Left out of JSON export unless asked for
+
+// Every persisted field of AlertLightConfig:
+//   X(id, member, legacy NVS key, kind, default, flags)
+// This table drives the defaults, the blob, migration from the old
+// per-key layout and JSON import/export. The position in the list is the
+// field's id inside the stored blob: append new fields at the end, never
+// reorder or reuse an entry. Fields added later need no legacy key ("").
+#define CONFIG_FIELDS(X) \
+    X(CFG_WIFI_SSID,                 wifi_ssid,                 "wifi_ssid",      TEXT,      "",              CFG_FLAG_NONE)   \
+    X(CFG_WIFI_PASSWORD,             wifi_password,             "wifi_pass",      TEXT,      "",              CFG_FLAG_SECRET) \
+    X(CFG_USE_STATIC_IP,             use_static_ip,             "use_static_ip",  BOOL,      false,           CFG_FLAG_NONE)   \
+    X(CFG_STATIC_IP,                 static_ip,                 "static_ip",      TEXT,      "192.168.1.100", CFG_FLAG_NONE)   \
+    X(CFG_STATIC_GATEWAY,            static_gateway,            "static_gw",      TEXT,      "192.168.1.1",   CFG_FLAG_NONE)   \
+    X(CFG_STATIC_SUBNET,             static_subnet,             "static_sn",      TEXT,      "255.255.255.0", CFG_FLAG_NONE)   \
+    X(CFG_WEB_PORT,                  web_port,                  "web_port",       U16,       8080,            CFG_FLAG_NONE)   \
+    X(CFG_ALERT_API_URL,             alert_api_url,             "alert_url",      TEXT,      "https://air-save.ops.ajax.systems/api/mobile/status/regions/v2?regions=", CFG_FLAG_NONE) \
+    X(CFG_ALERT_FALLBACK_URL,        alert_fallback_url,        "alert_fb_url",   TEXT,      "https://ubilling.net.ua/aerialalerts/", CFG_FLAG_NONE) \
+    X(CFG_ALERT_HEDGE_MS,            alert_hedge_ms,            "alert_hedge",    U16,       1500,            CFG_FLAG_NONE)   \
+    X(CFG_ALERT_PUSH_URL,            alert_push_url,            "alert_push",     TEXT,      "",              CFG_FLAG_NONE)   \
+    X(CFG_ALERT_REGION_ID,           alert_region_id,           "alert_region",   U16,       16,              CFG_FLAG_NONE)   /* Kyiv */ \
+    X(CFG_ALERT_EXTRA_COUNT,         alert_extra_count,         "alert_extra_n",  U8,        0,               CFG_FLAG_NONE)   \
+    X(CFG_ALERT_EXTRA_REGIONS,       alert_extra_regions,       "alert_extra",    U16_LIST,  0,               CFG_FLAG_NONE)   \
+    X(CFG_ALERT_CHECK_INTERVAL,      alert_check_interval,      "alert_interval", U32,       30,              CFG_FLAG_NONE)   \
+    X(CFG_LIGHT_API_URL,             light_api_url,             "light_url",      TEXT,      "https://app.yasno.ua/api/blackout-service/public/shutdowns/regions/25/dsos/902/planned-outages", CFG_FLAG_NONE) \
+    X(CFG_LIGHT_QUEUE,               light_queue,               "light_queue",    TEXT,      "6.2",           CFG_FLAG_NONE)   \
+    X(CFG_LIGHT_EXTRA_COUNT,         light_extra_count,         "light_extra_n",  U8,        0,               CFG_FLAG_NONE)   \
+    X(CFG_LIGHT_EXTRA_QUEUES,        light_extra_queues,        "light_extra",    TEXT_LIST, 0,               CFG_FLAG_NONE)   \
+    X(CFG_LIGHT_CHECK_INTERVAL,      light_check_interval,      "light_interval", U32,       900,             CFG_FLAG_NONE)   /* 15 minutes */ \
+    X(CFG_YASNO_STREET_ID,           yasno_street_id,           "yasno_str_id",   U32,       0,               CFG_FLAG_NONE)   \
+    X(CFG_YASNO_STREET_NAME,         yasno_street_name,         "yasno_str_nm",   TEXT,      "",              CFG_FLAG_NONE)   \
+    X(CFG_YASNO_HOUSE_ID,            yasno_house_id,            "yasno_hse_id",   U32,       0,               CFG_FLAG_NONE)   \
+    X(CFG_YASNO_HOUSE_NAME,          yasno_house_name,          "yasno_hse_nm",   TEXT,      "",              CFG_FLAG_NONE)   \
+    X(CFG_AMBIENT_BRIGHTNESS,        ambient_brightness,        "rgb_ambient",    U8,        10,              CFG_FLAG_NONE)   \
+    X(CFG_COLOR_NO_ALERT,            color_no_alert,            "rgb_no_alert",   U32,       0x00FF00,        CFG_FLAG_NONE)   /* Green */ \
+    X(CFG_COLOR_ALERT,               color_alert,               "rgb_alert",      U32,       0xFF0000,        CFG_FLAG_NONE)   /* Red */ \
+    X(CFG_COLOR_OUTAGE,              color_outage,              "rgb_outage",     U32,       0x0000FF,        CFG_FLAG_NONE)   /* Dark blue */ \
+    X(CFG_COLOR_NO_STATUS,           color_no_status,           "rgb_no_status",  U32,       0x808080,        CFG_FLAG_NONE)   /* Grey */ \
+    X(CFG_BLINK_ON_DURATION,         blink_on_duration,         "blink_on",       U16,       500,             CFG_FLAG_NONE)   \
+    X(CFG_BLINK_OFF_DURATION,        blink_off_duration,        "blink_off",      U16,       500,             CFG_FLAG_NONE)   \
+    X(CFG_BLINK_TOTAL_DURATION,      blink_total_duration,      "blink_total",    U16,       30,              CFG_FLAG_NONE)   \
+    X(CFG_BLINK_INFO_DURATION,       blink_info_duration,       "blink_info",     U16,       10,              CFG_FLAG_NONE)   \
+    X(CFG_COLOR_BLINK_ALERT,         color_blink_alert,         "blink_alert",    U32,       0xFF0000,        CFG_FLAG_NONE)   /* Red */ \
+    X(CFG_COLOR_BLINK_ALERT_DISMISS, color_blink_alert_dismiss, "blink_dismiss",  U32,       0x00FF00,        CFG_FLAG_NONE)   /* Green */ \
+    X(CFG_COLOR_BLINK_OUTAGE,        color_blink_outage,        "blink_outage",   U32,       0x00008B,        CFG_FLAG_NONE)   /* Dark blue */ \
+    X(CFG_COLOR_BLINK_RESTORE,       color_blink_restore,       "blink_restore",  U32,       0xFFFF00,        CFG_FLAG_NONE)   /* Yellow */ \
+    X(CFG_COLOR_BLINK_SCHEDULE,      color_blink_schedule,      "blink_sched",    U32,       0xFF00FF,        CFG_FLAG_NONE)   /* Magenta */ \
+    X(CFG_LED_COUNT,                 led_count,                 "led_count",      U16,       1,               CFG_FLAG_NONE)   \
+    X(CFG_LED_LAYOUT,                led_layout,                "led_layout",     U8,        LED_LAYOUT_WHOLE, CFG_FLAG_NONE)  \
+    X(CFG_DISPLAY_BRIGHTNESS,        display_brightness,        "disp_bright",    U8,        90,              CFG_FLAG_NONE)   \
+    X(CFG_LED_COLOR_ORDER,           led_color_order,           "",               U8,        LED_ORDER_RGB,   CFG_FLAG_NONE)
+
+// Field ids, in table order
+#define CFG_ENUM_ENTRY(id, member, key, kind, def, flags) id,
+enum ConfigField {
+    CONFIG_FIELDS(CFG_ENUM_ENTRY)
+    CFG_FIELD_COUNT
+};
+#undef CFG_ENUM_ENTRY
+
+// Field sets for subscribe()
+#define CFG_BIT(field)          (1ULL << (field))
+#define CONFIG_MAX_SUBSCRIBERS  8
+
+// Called after a save() that changed at least one field of the mask;
+// changed holds every field written by that save
+typedef void (*ConfigChangeCallback)(uint64_t changed);
+
+// Where the running configuration came from at boot
+enum ConfigLoadSource {
+    CONFIG_SOURCE_DEFAULTS,         // Nothing stored yet
+    CONFIG_SOURCE_BLOB,
+    CONFIG_SOURCE_MIGRATED,         // Read from the old per-key layout
+    CONFIG_SOURCE_CORRUPT           // Blob failed its check - defaults (or legacy keys) used
+};
+
+// Flash wear bookkeeping. Bytes are NVS entry bytes (32 per entry, a blob
+// takes one more entry per started 32 bytes), i.e. what gets programmed,
+// not the payload size.
+struct ConfigWriteStats {
+    uint32_t saves;                 // save() calls that wrote something
+    uint32_t skippedSaves;          // save() calls with nothing dirty
+    uint16_t lastFields;            // Fields changed since the save before
+    uint32_t lastBytes;             // Whole blob plus the counter, however few fields changed
+    uint32_t totalBytes;            // Since first boot (kept in NVS)
+};
+
 class ConfigManager {
 public:
     ConfigManager();
@@ -58,31 +189,83 @@ public:
     // Initialize with default values
     void begin();
 
-    // Load configuration from NVS
+    // Load configuration from NVS: the blob with one read, or the old
+    // per-key layout (then the next save migrates it)
     bool load();
 
-    // Save configuration to NVS
+    // Write the blob in one commit (no-op when nothing changed)
     bool save();
 
     // Reset to factory defaults
     void resetToDefaults();
 
-    // Get current configuration
+    // Get current configuration. Change fields through the setters below;
+    // a direct write is not saved unless markDirty() is called for it.
     AlertLightConfig& getConfig();
 
+    // Typed setters - mark the field dirty only when the value changes
+    bool setBool(ConfigField field, bool value);
+    bool setU8(ConfigField field, uint8_t value);
+    bool setU16(ConfigField field, uint16_t value);
+    bool setU32(ConfigField field, uint32_t value);
+    bool setText(ConfigField field, const char* value);     // Truncated to the field
+    bool setBytes(ConfigField field, const void* value, size_t size);
+    void markDirty(ConfigField field);
+    bool isDirty(ConfigField field);
+    bool hasChanges();
+
+    // Register for changes to any field in fieldMask (CFG_BIT() ored
+    // together). Callbacks run inside save(), from the saving task: note
+    // what to reapply and do slow work (reconnects, refetches) later.
+    bool subscribe(uint64_t fieldMask, ConfigChangeCallback callback);
+
+    const ConfigWriteStats& getWriteStats();
+    ConfigLoadSource getLoadSource();
+    static const char* loadSourceToString(ConfigLoadSource source);
+    static const char* getFieldName(ConfigField field);
+
+    // Settings as JSON ({"version": n, "config": {member: value, ...}}).
+    // Import applies known members only and leaves the rest unchanged;
+    // nothing is applied when a value has the wrong type.
+    String exportJson(bool includeSecrets);
+    bool importJson(const String& json, String& error);
+
     // Update individual settings
     void setWiFiCredentials(const char* ssid, const char* password);
     void setStaticIP(const char* ip, const char* gateway, const char* subnet);
     void setAlertAPI(const char* url, uint16_t region_id, uint32_t interval);
+    void setAlertExtraRegions(const uint16_t* region_ids, uint8_t count);
     void setLightAPI(const char* url, const char* queue, uint32_t interval);
+    void setLightExtraQueues(const char queues[][8], uint8_t count);
     void setRGBColors(uint32_t no_alert, uint32_t alert, uint32_t outage, uint32_t no_status);
     void setRGBBlinkSettings(uint16_t on_ms, uint16_t off_ms, uint16_t total_sec);
 
 private:
+    struct Subscriber {
+        uint64_t fieldMask;
+        ConfigChangeCallback callback;
+    };
+
     Preferences preferences;
     AlertLightConfig config;
+    uint64_t dirty;                 // Bit per ConfigField
+    ConfigWriteStats stats;
+    ConfigLoadSource loadSource;
+    bool legacyKeys;                // Old per-key entries to erase on the next save
+    Subscriber subscribers[CONFIG_MAX_SUBSCRIBERS];
+    uint8_t subscriberCount;
 
     void setDefaults();
+    void applyDefault(ConfigField field, const char* text);
+    void applyDefault(ConfigField field, int value);
+    bool loadBlob();
+    bool loadLegacy();
+    void validate();
+    size_t encodeBlob(uint8_t* blob);
+    bool decodeBlob(const uint8_t* blob, size_t length);
+    void* fieldPtr(ConfigField field);
+    bool setField(ConfigField field, uint8_t type, const void* value, size_t size);
+    void dispatch(uint64_t changed);
 };
 
 extern ConfigManager configManager;
@@ -0,0 +1,49 @@
+#include "DeviceState.h"
+
+DeviceState deviceState;
+
+DeviceState::DeviceState() {
+    memset(&data, 0, sizeof(data));
+    sequence = 0;
+    writeLock = portMUX_INITIALIZER_UNLOCKED;
+}
+
+void DeviceState::beginWrite() {
+    portENTER_CRITICAL(&writeLock);
+    __atomic_store_n(&sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void DeviceState::endWrite() {
+    __atomic_store_n(&sequence, sequence + 1, __ATOMIC_RELEASE);
+    portEXIT_CRITICAL(&writeLock);
+}
+
+void DeviceState::publishAlert(const AlertStateView& alert) {
+    beginWrite();
+    memcpy(&data.alert, &alert, sizeof(alert));
+    endWrite();
+}
+
+void DeviceState::publishLight(const LightStateView& light) {
+    beginWrite();
+    memcpy(&data.light, &light, sizeof(light));
+    endWrite();
+}
+
+DeviceSnapshot DeviceState::read() {
+    DeviceSnapshot copy;
+    uint32_t before, after;
+    do {
+        before = __atomic_load_n(&sequence, __ATOMIC_ACQUIRE);
+        memcpy(&copy, &data, sizeof(copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&sequence, __ATOMIC_RELAXED);
+    } while ((before & 1) != 0 || before != after);
+    return copy;
+}
+
+void DeviceState::copyText(char* dest, size_t size, const String& text) {
+    strncpy(dest, text.c_str(), size - 1);
+    dest[size - 1] = '\0';
+}
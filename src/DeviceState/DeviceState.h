@@ -0,0 +1,92 @@
+#ifndef DEVICESTATE_H
+#define DEVICESTATE_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "../Config/Config.h"
+
+#define DEVICE_STATE_NAME_LEN   64      // Region names are UTF-8 Cyrillic
+#define DEVICE_STATE_ERROR_LEN  96
+#define DEVICE_STATE_TIME_LEN   20
+#define DEVICE_STATE_QUEUE_LEN  8
+
+// Alert side, written by AlertManager
+struct AlertStateView {
+    bool known;                 // Fresh API answer or restored snapshot
+    bool stale;                 // Restored, not confirmed by the API yet
+    bool active;                // Home region
+    uint8_t mask;               // One bit per watched slot
+    uint8_t watchedCount;
+    uint16_t watchedIds[ALERT_MAX_REGIONS];
+    int httpCode;
+    char region[DEVICE_STATE_NAME_LEN];
+    char source[16];
+    char lastCall[DEVICE_STATE_TIME_LEN];
+    char lastError[DEVICE_STATE_ERROR_LEN];
+};
+
+struct LightQueueView {
+    char name[DEVICE_STATE_QUEUE_LEN];
+    bool outage;
+    bool emergency;
+    bool tomorrowKnown;
+    bool tomorrowEmergency;
+};
+
+// Light side, written by LightManager
+struct LightStateView {
+    bool known;                 // Schedule fetched or restored for the configured queues
+    bool stale;
+    bool anyOutage;             // Merged over all queues
+    bool anyEmergency;
+    uint8_t queueCount;
+    LightQueueView queues[LIGHT_MAX_QUEUES];
+    int httpCode;
+    char lastCall[DEVICE_STATE_TIME_LEN];
+    char lastError[DEVICE_STATE_ERROR_LEN];
+    char lastChange[DEVICE_STATE_NAME_LEN];
+    char lastChangeTime[DEVICE_STATE_TIME_LEN];
+};
+
+// Plain data only - copied as a whole, never holds a pointer or String
+struct DeviceSnapshot {
+    AlertStateView alert;
+    LightStateView light;
+};
+
+// Device state shared between its writers (the managers) and its readers
+// (RGB, web pages). The managers still run on the loop task because they
+// drive LVGL; the seqlock keeps a reader on any task from seeing a
+// half-written section.
+//
+// Writers publish one section at a time under a seqlock: the sequence is
+// odd while a copy is in progress. Readers never block; they copy the
+// whole snapshot and retry if the sequence moved. The write runs in a
+// critical section, so a reader on the other core retries for a few
+// microseconds at most and a reader on the writer's core never sees an
+// odd sequence.
+class DeviceState {
+public:
+    DeviceState();
+
+    void publishAlert(const AlertStateView& alert);
+    void publishLight(const LightStateView& light);
+
+    // Consistent copy of the latest state
+    DeviceSnapshot read();
+
+    // Bounded copy into a fixed field, always terminated
+    static void copyText(char* dest, size_t size, const String& text);
+
+private:
+    DeviceSnapshot data;
+    volatile uint32_t sequence;
+    portMUX_TYPE writeLock;
+
+    void beginWrite();
+    void endWrite();
+};
+
+extern DeviceState deviceState;
+
+#endif // DEVICESTATE_H
@@ -100,8 +100,7 @@ void Lvgl_Init(void)
 
   printf("LVGL initialization complete\n");
 }
-void Timer_Loop(void)
+uint32_t Timer_Loop(void)
 {
-  lv_timer_handler(); /* let the GUI do its work */
-  // delay( 5 );
+  return lv_timer_handler(); /* let the GUI do its work; ms until LVGL needs it again */
 }
\ No newline at end of file
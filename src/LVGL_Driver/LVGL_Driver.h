@@ -19,7 +19,7 @@ void Lvgl_Touchpad_Read( lv_indev_drv_t * indev_drv, lv_indev_data_t * data );
 void example_increase_lvgl_tick(void *arg);
 
 void Lvgl_Init(void);
-void Timer_Loop(void);
+uint32_t Timer_Loop(void);
 
 // Diagnostic tools - include if you need advanced debugging
 // #include "LVGL_Diagnostics.h"
@@ -0,0 +1,177 @@
+#ifndef LEDCOMPOSITOR_H
+#define LEDCOMPOSITOR_H
+
+#include <stdint.h>
+#include <string.h>
+#include "LedTables.h"
+
+#define LED_MAX_SEGMENTS    4
+#define LED_SEGMENT_ALL     0xFF        // Overlay target: the whole strip
+
+// A run of pixels showing one status colour
+struct LedSegment {
+    uint16_t first;
+    uint16_t count;
+    uint32_t color;                     // 0xRRGGBB
+    uint8_t brightness;                 // 0-255, linear (a setting, not an animation step)
+};
+
+// Builds one strip frame from two layers:
+//  - base: up to LED_MAX_SEGMENTS status segments, each a solid colour
+//  - overlay: the running event effect, opaque over one segment (or the
+//    whole strip), its level passed through the gamma table
+// Pixels not covered by any segment are dark.
+//
+// Plain C++ without Arduino or FreeRTOS. Not thread-safe - LedEffects
+// serialises access.
+class LedCompositor {
+public:
+    LedCompositor() {
+        pixelCount = 1;
+        segmentCount = 0;
+        memset(segments, 0, sizeof(segments));
+        overlayActive = false;
+        overlayColor = 0;
+        overlayLevel = 0;
+        overlaySegment = LED_SEGMENT_ALL;
+        greenFirst = false;
+    }
+
+    // All setters return true when the rendered frame may have changed
+    bool setPixelCount(uint16_t count) {
+        if (count == 0) {
+            count = 1;
+        }
+        if (count == pixelCount) {
+            return false;
+        }
+        pixelCount = count;
+        return true;
+    }
+
+    uint16_t getPixelCount() const {
+        return pixelCount;
+    }
+
+    // Wire order: R,G,B (onboard LED) or G,R,B (WS2812 strips)
+    bool setGreenFirst(bool value) {
+        if (value == greenFirst) {
+            return false;
+        }
+        greenFirst = value;
+        return true;
+    }
+
+    bool isGreenFirst() const {
+        return greenFirst;
+    }
+
+    bool setSegments(const LedSegment* newSegments, uint8_t count) {
+        if (count > LED_MAX_SEGMENTS) {
+            count = LED_MAX_SEGMENTS;
+        }
+        bool changed = count != segmentCount;
+        for (uint8_t i = 0; i < count; i++) {
+            if (!sameSegment(segments[i], newSegments[i])) {
+                segments[i] = newSegments[i];
+                changed = true;
+            }
+        }
+        segmentCount = count;
+        return changed;
+    }
+
+    bool setOverlay(uint32_t color, uint8_t level, uint8_t segment) {
+        if (overlayActive && overlayColor == color && overlayLevel == level && overlaySegment == segment) {
+            return false;
+        }
+        overlayActive = true;
+        overlayColor = color;
+        overlayLevel = level;
+        overlaySegment = segment;
+        return true;
+    }
+
+    bool clearOverlay() {
+        if (!overlayActive) {
+            return false;
+        }
+        overlayActive = false;
+        return true;
+    }
+
+    // Write pixelCount * 3 bytes in wire order into frame
+    void render(uint8_t* frame) const {
+        memset(frame, 0, pixelCount * 3);
+
+        uint8_t pixel[3];
+        uint16_t first, count;
+        for (uint8_t i = 0; i < segmentCount; i++) {
+            if (clip(segments[i].first, segments[i].count, first, count)) {
+                scaleColor(segments[i].color, segments[i].brightness, greenFirst, pixel);
+                fill(frame, first, count, pixel);
+            }
+        }
+
+        if (overlayActive && getSegmentRange(overlaySegment, first, count)) {
+            scaleColor(overlayColor, LED_GAMMA.value[overlayLevel], greenFirst, pixel);
+            fill(frame, first, count, pixel);
+        }
+    }
+
+    // Pixel range of a base segment, clipped to the strip; an index past
+    // the last segment (LED_SEGMENT_ALL) is the whole strip
+    bool getSegmentRange(uint8_t segment, uint16_t& first, uint16_t& count) const {
+        if (segment >= segmentCount) {
+            first = 0;
+            count = pixelCount;
+            return true;
+        }
+        return clip(segments[segment].first, segments[segment].count, first, count);
+    }
+
+    // 0xRRGGBB scaled by 0..255 (rounded) into three wire bytes
+    static void scaleColor(uint32_t color, uint8_t scale, bool greenFirst, uint8_t* pixel) {
+        uint8_t red = (((color >> 16) & 0xFF) * scale + 127) / 255;
+        uint8_t green = (((color >> 8) & 0xFF) * scale + 127) / 255;
+        pixel[0] = greenFirst ? green : red;
+        pixel[1] = greenFirst ? red : green;
+        pixel[2] = ((color & 0xFF) * scale + 127) / 255;
+    }
+
+private:
+    uint16_t pixelCount;
+    uint8_t segmentCount;
+    LedSegment segments[LED_MAX_SEGMENTS];
+
+    bool overlayActive;
+    uint32_t overlayColor;
+    uint8_t overlayLevel;               // Linear 0..255, gamma applied in render()
+    uint8_t overlaySegment;
+    bool greenFirst;
+
+    static bool sameSegment(const LedSegment& a, const LedSegment& b) {
+        return a.first == b.first && a.count == b.count && a.color == b.color && a.brightness == b.brightness;
+    }
+
+    bool clip(uint16_t first, uint16_t count, uint16_t& outFirst, uint16_t& outCount) const {
+        if (first >= pixelCount || count == 0) {
+            return false;
+        }
+        outFirst = first;
+        outCount = (count > pixelCount - first) ? pixelCount - first : count;
+        return true;
+    }
+
+    static void fill(uint8_t* frame, uint16_t first, uint16_t count, const uint8_t* pixel) {
+        uint8_t* out = frame + first * 3;
+        for (uint16_t i = 0; i < count; i++) {
+            out[0] = pixel[0];
+            out[1] = pixel[1];
+            out[2] = pixel[2];
+            out += 3;
+        }
+    }
+};
+
+#endif // LEDCOMPOSITOR_H
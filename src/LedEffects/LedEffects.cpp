@@ -0,0 +1,257 @@
+#include "LedEffects.h"
+#include "LedTables.h"
+#include "../RGB_Lamp/RGB_lamp.h"
+
+LedEffects ledEffects;
+
+LedEffects::LedEffects() {
+    timer = NULL;
+    outputLock = NULL;
+    paramsLock = portMUX_INITIALIZER_UNLOCKED;
+    running = false;
+    effect = LED_EFFECT_NONE;
+    color = 0;
+    onMs = 0;
+    offMs = 0;
+    durationMs = 0;
+    segment = LED_SEGMENT_ALL;
+    startUs = 0;
+    frameCount = 0;
+    outputDirty = false;
+}
+
+void LedEffects::begin() {
+    outputLock = xSemaphoreCreateMutex();
+
+    esp_timer_create_args_t args = {};
+    args.callback = onFrame;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "led_fx";
+    if (esp_timer_create(&args, &timer) != ESP_OK) {
+        printf("LED effects: timer creation failed\n");
+        timer = NULL;
+    }
+}
+
+void LedEffects::setPixelCount(uint16_t count) {
+    if (count > LED_MAX_PIXELS) {
+        count = LED_MAX_PIXELS;
+    }
+    if (outputLock == NULL || count == compositor.getPixelCount()) {
+        return;
+    }
+    if (xSemaphoreTake(outputLock, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    if (compositor.setPixelCount(count) && !running) {
+        present();
+    }
+    xSemaphoreGive(outputLock);
+    printf("LED strip: %u pixel(s)\n", count);
+}
+
+uint16_t LedEffects::getPixelCount() {
+    return compositor.getPixelCount();
+}
+
+void LedEffects::setColorOrder(uint8_t order) {
+    bool greenFirst = order == LED_ORDER_GRB;
+    if (outputLock == NULL || greenFirst == compositor.isGreenFirst()) {
+        return;
+    }
+    if (xSemaphoreTake(outputLock, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    if (compositor.setGreenFirst(greenFirst) && !running) {
+        present();
+    }
+    xSemaphoreGive(outputLock);
+}
+
+void LedEffects::play(LedEffect newEffect, uint32_t newColor, uint16_t newOnMs, uint16_t newOffMs,
+                      uint32_t newDurationMs, uint8_t newSegment) {
+    if (timer == NULL || newEffect == LED_EFFECT_NONE) {
+        return;
+    }
+
+    portENTER_CRITICAL(&paramsLock);
+    effect = newEffect;
+    color = newColor;
+    onMs = newOnMs > 0 ? newOnMs : 1;
+    offMs = newOffMs > 0 ? newOffMs : 1;
+    durationMs = newDurationMs;
+    segment = newSegment;
+    startUs = esp_timer_get_time();
+    running = true;
+    portEXIT_CRITICAL(&paramsLock);
+
+    // Restarting an already running timer keeps its period - stop first
+    esp_timer_stop(timer);
+    esp_timer_start_periodic(timer, LED_EFFECT_FRAME_US);
+    printf("LED effect: %s 0x%06X (%u/%u ms, %u ms total)\n", effectToString(newEffect), newColor,
+           newOnMs, newOffMs, newDurationMs);
+}
+
+void LedEffects::stop() {
+    if (timer != NULL) {
+        esp_timer_stop(timer);
+    }
+    running = false;
+
+    // A frame in flight sees running == false under the lock and leaves the
+    // overlay alone; push the bare base layer out so the last effect frame
+    // does not stay on the strip until the next base change
+    if (outputLock != NULL && xSemaphoreTake(outputLock, portMAX_DELAY) == pdTRUE) {
+        compositor.clearOverlay();
+        present();
+        xSemaphoreGive(outputLock);
+    }
+}
+
+bool LedEffects::isRunning() {
+    return running;
+}
+
+void LedEffects::showSolid(uint32_t solidColor, uint8_t brightness) {
+    LedSegment whole = {0, LED_MAX_PIXELS, solidColor, brightness};
+    showSegments(&whole, 1);
+}
+
+void LedEffects::showSegments(const LedSegment* segments, uint8_t count) {
+    if (outputLock == NULL) {
+        return;
+    }
+    if (xSemaphoreTake(outputLock, portMAX_DELAY) != pdTRUE) {
+        return;
+    }
+    // While an effect plays the next timer frame picks the new base up.
+    // A frame the strip did not take is sent again on the next call.
+    if ((compositor.setSegments(segments, count) || outputDirty) && !running) {
+        present();
+    }
+    xSemaphoreGive(outputLock);
+}
+
+void LedEffects::onFrame(void* arg) {
+    ((LedEffects*)arg)->renderFrame();
+}
+
+void LedEffects::renderFrame() {
+    portENTER_CRITICAL(&paramsLock);
+    LedEffect current = effect;
+    uint32_t frameColor = color;
+    uint32_t on = onMs;
+    uint32_t off = offMs;
+    uint32_t duration = durationMs;
+    uint8_t target = segment;
+    int64_t start = startUs;
+    portEXIT_CRITICAL(&paramsLock);
+
+    uint32_t elapsedMs = (uint32_t)((esp_timer_get_time() - start) / 1000);
+    bool finished = duration > 0 && elapsedMs >= duration;
+
+    // Loop task is updating the base layer - skip this frame rather than
+    // wait, except the last one: it takes the overlay off the strip
+    if (xSemaphoreTake(outputLock, finished ? portMAX_DELAY : 0) == pdTRUE) {
+        if (running) {
+            if (finished) {
+                compositor.clearOverlay();  // Back to the base layer
+            } else {
+                compositor.setOverlay(frameColor, levelAt(current, elapsedMs, on, off, duration), target);
+            }
+            present();
+            frameCount++;
+        }
+        xSemaphoreGive(outputLock);
+    }
+
+    if (finished) {
+        // Unless play() started a new effect meanwhile
+        portENTER_CRITICAL(&paramsLock);
+        bool same = startUs == start;
+        if (same) {
+            running = false;
+        }
+        portEXIT_CRITICAL(&paramsLock);
+        if (same) {
+            esp_timer_stop(timer);
+        }
+    }
+}
+
+uint8_t LedEffects::ramp(uint32_t position, uint32_t length) {
+    if (length == 0 || position >= length) {
+        return 255;
+    }
+    return LED_EASE.value[position * 255 / length];
+}
+
+uint8_t LedEffects::levelAt(LedEffect effect, uint32_t elapsedMs, uint32_t onMs, uint32_t offMs,
+                            uint32_t durationMs) {
+    uint32_t cycle = onMs + offMs;
+
+    switch (effect) {
+        case LED_EFFECT_BREATHE: {
+            // Rise over 'on', fall over 'off'
+            uint32_t position = elapsedMs % cycle;
+            if (position < onMs) {
+                return ramp(position, onMs);
+            }
+            return 255 - ramp(position - onMs, offMs);
+        }
+
+        case LED_EFFECT_FADE: {
+            if (elapsedMs < onMs) {
+                return ramp(elapsedMs, onMs);
+            }
+            if (durationMs > 0 && elapsedMs + offMs >= durationMs) {
+                uint32_t left = durationMs > elapsedMs ? durationMs - elapsedMs : 0;
+                return ramp(left, offMs);
+            }
+            return 255;
+        }
+
+        case LED_EFFECT_PULSE_TRAIN: {
+            // LED_PULSE_TRAIN_COUNT pulses, then two cycles dark
+            uint32_t train = cycle * (LED_PULSE_TRAIN_COUNT + 2);
+            uint32_t position = elapsedMs % train;
+            if (position >= cycle * LED_PULSE_TRAIN_COUNT) {
+                return 0;
+            }
+            position %= cycle;
+            if (position >= onMs) {
+                return 0;
+            }
+            uint32_t edge = min((uint32_t)LED_PULSE_EDGE_MS, onMs / 2);
+            if (position < edge) {
+                return ramp(position, edge);
+            }
+            if (position + edge >= onMs) {
+                return ramp(onMs - position, edge);
+            }
+            return 255;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+void LedEffects::present() {
+    compositor.render(frame);
+    outputDirty = !RGB_Lamp_Write(frame, compositor.getPixelCount());
+}
+
+uint32_t LedEffects::getFrameCount() {
+    return frameCount;
+}
+
+const char* LedEffects::effectToString(LedEffect effect) {
+    switch (effect) {
+        case LED_EFFECT_BREATHE: return "Breathe";
+        case LED_EFFECT_FADE: return "Fade in/out";
+        case LED_EFFECT_PULSE_TRAIN: return "Pulse train";
+        default: return "None";
+    }
+}
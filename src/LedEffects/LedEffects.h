@@ -0,0 +1,92 @@
+#ifndef LEDEFFECTS_H
+#define LEDEFFECTS_H
+
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "../Config/Config.h"
+#include "LedCompositor.h"
+
+#define LED_EFFECT_FPS          50
+#define LED_EFFECT_FRAME_US     (1000000 / LED_EFFECT_FPS)
+#define LED_PULSE_TRAIN_COUNT   3       // Pulses per train, then a pause of two cycles
+#define LED_PULSE_EDGE_MS       40      // Eased rise/fall of each pulse
+
+enum LedEffect {
+    LED_EFFECT_NONE = 0,
+    LED_EFFECT_BREATHE,         // Eased rise and fall over on+off
+    LED_EFFECT_FADE,            // Fade in over on, hold, fade out over the last off
+    LED_EFFECT_PULSE_TRAIN      // Groups of short pulses with soft edges
+};
+
+// Frame engine for the status LED strip. Effects are rendered from the gamma
+// and easing tables in LedTables.h by a periodic esp_timer, so their timing
+// does not depend on how busy loop() is. Each tick sets the overlay level of
+// the LedCompositor and sends the composited strip as one frame; status
+// colours from RGBManager update the base layer under the same output lock
+// and are sent straight away only while no effect is playing.
+class LedEffects {
+public:
+    LedEffects();
+
+    // Create the frame timer (stopped until an effect plays)
+    void begin();
+
+    // Strip length, clamped to 1..LED_MAX_PIXELS
+    void setPixelCount(uint16_t count);
+    uint16_t getPixelCount();
+
+    // LED_ORDER_* byte order of the attached LEDs
+    void setColorOrder(uint8_t order);
+
+    // Start an effect over one base segment (LED_SEGMENT_ALL = whole strip);
+    // durationMs 0 plays until stop()
+    void play(LedEffect effect, uint32_t color, uint16_t onMs, uint16_t offMs, uint32_t durationMs,
+              uint8_t segment = LED_SEGMENT_ALL);
+    void stop();
+    bool isRunning();
+
+    // Base layer: one colour over the whole strip, or per-segment status.
+    // Brightness 0-255.
+    void showSolid(uint32_t color, uint8_t brightness);
+    void showSegments(const LedSegment* segments, uint8_t count);
+
+    // Debug info
+    uint32_t getFrameCount();
+    static const char* effectToString(LedEffect effect);
+
+private:
+    esp_timer_handle_t timer;
+    SemaphoreHandle_t outputLock;   // Compositor and frame
+    portMUX_TYPE paramsLock;        // Effect parameters, read by the timer task
+
+    LedCompositor compositor;
+    uint8_t frame[LED_MAX_PIXELS * 3];
+
+    volatile bool running;
+    LedEffect effect;
+    uint32_t color;
+    uint32_t onMs;
+    uint32_t offMs;
+    uint32_t durationMs;
+    uint8_t segment;
+    int64_t startUs;
+    uint32_t frameCount;
+    bool outputDirty;               // Last present() not taken by the strip (RMT busy)
+
+    static void onFrame(void* arg);
+    void renderFrame();
+
+    // 0..255 linear intensity of an effect at a point in time
+    static uint8_t levelAt(LedEffect effect, uint32_t elapsedMs, uint32_t onMs, uint32_t offMs,
+                           uint32_t durationMs);
+    static uint8_t ramp(uint32_t position, uint32_t length);
+
+    // Composite and send the strip (caller holds outputLock)
+    void present();
+};
+
+extern LedEffects ledEffects;
+
+#endif // LEDEFFECTS_H
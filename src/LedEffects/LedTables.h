@@ -0,0 +1,46 @@
+#ifndef LEDTABLES_H
+#define LEDTABLES_H
+
+#include <stdint.h>
+
+// Lookup tables for LED effects, built by the compiler and kept in flash.
+// All values are 0..255; index is a linear 0..255 input.
+
+struct LedTable {
+    uint8_t value[256];
+};
+
+// Perceptual correction, roughly gamma 2.5: blend of x^2 and x^3.
+// A linear ramp on a WS2812 looks like it jumps to full and then sits there.
+constexpr LedTable makeGammaTable() {
+    LedTable table = {};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t square = i * i;                // / 255
+        uint32_t cube = i * i * i / 255;        // / 255
+        uint32_t mixed = (square + cube) / 2;   // (x^2 + x^3) / 2, still / 255
+        uint32_t out = (mixed + 127) / 255;
+        // Keep the faintest non-zero input visible
+        table.value[i] = (i > 0 && out == 0) ? 1 : (uint8_t)out;
+    }
+    return table;
+}
+
+// Smoothstep 3t^2 - 2t^3 in fixed point: eases in and out of both ends
+constexpr LedTable makeEaseTable() {
+    LedTable table = {};
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t t2 = i * i;                    // / 255^2
+        uint32_t t3 = t2 * i;                   // / 255^3
+        uint32_t out = (3 * t2 * 255 - 2 * t3 + 255 * 255 / 2) / (255 * 255);
+        table.value[i] = (uint8_t)out;
+    }
+    return table;
+}
+
+static constexpr LedTable LED_GAMMA = makeGammaTable();
+static constexpr LedTable LED_EASE = makeEaseTable();
+
+static_assert(LED_GAMMA.value[0] == 0 && LED_GAMMA.value[255] == 255, "gamma table must span 0..255");
+static_assert(LED_EASE.value[0] == 0 && LED_EASE.value[255] == 255, "ease table must span 0..255");
+
+#endif // LEDTABLES_H
@@ -1,285 +1,969 @@
 #include "LightManager.h"
 #include "../AlertLight_UI/AlertLight_UI.h"
 #include "../RGBManager/RGBManager.h"
+#include "../TimeService/TimeService.h"
+#include <WiFi.h>
 #include <time.h>
 
 LightManager lightManager;
 
-LightManager::LightManager() {
-    lastCheckTime = 0;
+// Slot boundaries are whole minutes, midnight included
+static void onMinuteTick(const struct tm& now) {
+    lightManager.updateActiveStates();
+}
+
+static void onTimeSynced(const struct tm& now) {
+    lightManager.handleClockSet();
+}
+
+// Source, queues or interval saved - refetch instead of waiting out the old interval
+static void onConfigChanged(uint64_t changed) {
+    lightManager.forceUpdate();
+}
+
+LightManager::LightManager() : scheduler("Light") {
     lastSuccessTime = 0;
     lastHTTPCode = 0;
-    emergencyShutdown = false;
-    currentOutage = false;
     previousOutageState = false;
+    scheduleKnown = false;
     lastCallTimeStr = "Never";
+    lastChangeSummary = "";
+    lastChangeTimeStr = "";
+    for (uint8_t q = 0; q < LIGHT_MAX_QUEUES; q++) {
+        resetQueue(queues[q]);
+        queues[q].name = "";
+    }
+    queueCount = 0;
+    displayIndex = 0;
+    lastDisplaySwitch = 0;
+    nextTransition = 0;
+    bitmapYday = -1;
+    scheduleYear = -1;
+    memset(&persistedState, 0, sizeof(persistedState));
+    stateStale = false;
+    stateSavedAt = 0;
+    fetchQueue = NULL;
+    fetchInFlight = false;
 }
 
 void LightManager::begin() {
-    printf("Light Manager initialized\n");
+    fetchQueue = xQueueCreate(1, sizeof(LightFetch*));
+    syncQueues();
+    publishState();
+    timeService.subscribe(TIME_EVENT_MINUTE, onMinuteTick);
+    timeService.subscribe(TIME_EVENT_SYNCED, onTimeSynced);
+    configManager.subscribe(CFG_BIT(CFG_LIGHT_API_URL) | CFG_BIT(CFG_LIGHT_QUEUE) | CFG_BIT(CFG_LIGHT_EXTRA_COUNT) |
+                            CFG_BIT(CFG_LIGHT_EXTRA_QUEUES) | CFG_BIT(CFG_LIGHT_CHECK_INTERVAL),
+                            onConfigChanged);
+    printf("Light Manager initialized (%d queue(s))\n", queueCount);
 }
 
-void LightManager::update() {
+void LightManager::restoreState() {
+    syncQueues();
+
+    LightStateBlob blob;
+    uint32_t savedAt = 0;
+    if (!stateStore.load("light", &blob, sizeof(blob), savedAt) || blob.version != LIGHT_STATE_VERSION) {
+        printf("No saved light schedule\n");
+        return;
+    }
+
+    bool sameQueues = blob.queueCount == queueCount;
+    for (uint8_t q = 0; sameQueues && q < queueCount; q++) {
+        blob.queue[q][LIGHT_QUEUE_NAME_LEN - 1] = '\0';
+        sameQueues = queues[q].name == blob.queue[q];
+    }
+    if (!sameQueues) {
+        printf("Saved light schedule is for other queues, ignored\n");
+        return;
+    }
+
+    // Clock survives a software restart - a schedule from today or yesterday
+    // is still usable (yesterday's "tomorrow" rolls over below).
+    // After power-on the clock is unknown; keep it as cached until NTP/API catch up.
+    const struct tm& timeinfo = timeService.getLocalTime();
+    bool clockSet = timeService.isValid();
+    bool sameDay = blob.year == timeinfo.tm_year && blob.yday == timeinfo.tm_yday;
+    if (clockSet && !sameDay && !isFollowingDay(blob.year, blob.yday, timeinfo)) {
+        printf("Saved light schedule is too old, ignored\n");
+        return;
+    }
+
+    persistedState = blob;
+    stateSavedAt = savedAt;
+    stateStale = true;
+    scheduleKnown = true;
+
+    for (uint8_t q = 0; q < queueCount; q++) {
+        resetQueue(queues[q]);
+        for (uint8_t day = 0; day < LIGHT_DAYS; day++) {
+            unpackDay(blob.days[q][day], queues[q], day);
+        }
+        queues[q].currentOutage = queues[q].emergency[0];
+    }
+    rebuildMergedBitmap();
+    previousOutageState = isAnyOutage();
+    bitmapYday = blob.yday;
+    scheduleYear = blob.year;
+    nextTransition = 0;
+
+    printf("Restored light schedule for %d queue(s), saved at %lu\n", queueCount, (unsigned long)savedAt);
+    updateActiveStates();
+    publishState();
+    refreshUI();
+}
+
+void LightManager::publishState() {
+    LightStateView view;
+    memset(&view, 0, sizeof(view));
+    view.known = scheduleKnown;
+    view.stale = stateStale;
+    view.anyOutage = isAnyOutage();
+    view.anyEmergency = isAnyEmergency();
+    view.queueCount = queueCount;
+    for (uint8_t q = 0; q < queueCount; q++) {
+        LightQueueView& out = view.queues[q];
+        DeviceState::copyText(out.name, sizeof(out.name), queues[q].name);
+        out.outage = queues[q].currentOutage;
+        out.emergency = queues[q].emergency[0];
+        out.tomorrowKnown = queues[q].known[1];
+        out.tomorrowEmergency = queues[q].emergency[1];
+    }
+    view.httpCode = lastHTTPCode;
+    DeviceState::copyText(view.lastCall, sizeof(view.lastCall), lastCallTimeStr);
+    DeviceState::copyText(view.lastError, sizeof(view.lastError), lastError);
+    DeviceState::copyText(view.lastChange, sizeof(view.lastChange), lastChangeSummary);
+    DeviceState::copyText(view.lastChangeTime, sizeof(view.lastChangeTime), lastChangeTimeStr);
+    deviceState.publishLight(view);
+}
+
+void LightManager::persistState() {
+    LightStateBlob blob;
+    memset(&blob, 0, sizeof(blob));
+    blob.version = LIGHT_STATE_VERSION;
+    blob.queueCount = queueCount;
+    blob.year = scheduleYear;
+    blob.yday = (scheduleYear >= 0) ? bitmapYday : -1;
+    for (uint8_t q = 0; q < queueCount; q++) {
+        strncpy(blob.queue[q], queues[q].name.c_str(), LIGHT_QUEUE_NAME_LEN - 1);
+        for (uint8_t day = 0; day < LIGHT_DAYS; day++) {
+            packDay(blob.days[q][day], queues[q], day);
+        }
+    }
+
+    // Flash writes only when the schedule actually changed
+    if (memcmp(&blob, &persistedState, sizeof(blob)) == 0) {
+        return;
+    }
+    if (stateStore.save("light", &blob, sizeof(blob))) {
+        persistedState = blob;
+    }
+}
+
+void LightManager::packDay(LightStateDay& out, const LightQueue& queue, uint8_t day) {
+    out.known = queue.known[day] ? 1 : 0;
+    out.emergency = queue.emergency[day] ? 1 : 0;
+
+    const std::vector<OutageRange>& ranges = queue.ranges[day];
+    size_t count = ranges.size();
+    if (count > LIGHT_STATE_MAX_SLOTS) {
+        count = LIGHT_STATE_MAX_SLOTS;
+    }
+    out.count = count;
+    for (size_t i = 0; i < count; i++) {
+        out.start_min[i] = ranges[i].start_min;
+        out.end_min[i] = ranges[i].end_min;
+    }
+}
+
+void LightManager::unpackDay(const LightStateDay& in, LightQueue& queue, uint8_t day) {
+    std::vector<OutageRange>& ranges = queue.ranges[day];
+    ranges.clear();
+    queue.bitmap.clearDay(day);
+
+    uint8_t count = in.count > LIGHT_STATE_MAX_SLOTS ? LIGHT_STATE_MAX_SLOTS : in.count;
+    for (uint8_t i = 0; i < count; i++) {
+        OutageRange range;
+        range.start_min = in.start_min[i];
+        range.end_min = in.end_min[i];
+        range.is_active = false;
+        ranges.push_back(range);
+        queue.bitmap.markRange(day, range.start_min, range.end_min);
+    }
+    if (in.known && !in.emergency) {
+        queue.bitmap.setKnown(day);
+    }
+    queue.known[day] = in.known != 0;
+    queue.emergency[day] = in.emergency != 0;
+}
+
+bool LightManager::syncQueues() {
     AlertLightConfig& cfg = configManager.getConfig();
 
+    // Configured address first, then the extra queues (empty and duplicate entries skipped)
+    String names[LIGHT_MAX_QUEUES];
+    uint8_t count = 0;
+    names[count++] = String(cfg.light_queue);
+    for (uint8_t i = 0; i < cfg.light_extra_count && i < LIGHT_MAX_QUEUES - 1; i++) {
+        String name = String(cfg.light_extra_queues[i]);
+        bool skip = name.length() == 0;
+        for (uint8_t j = 0; j < count && !skip; j++) {
+            skip = names[j] == name;
+        }
+        if (!skip) {
+            names[count++] = name;
+        }
+    }
+
+    bool changed = count != queueCount;
+    for (uint8_t q = 0; q < count && !changed; q++) {
+        changed = names[q] != queues[q].name;
+    }
+    if (!changed) {
+        return false;
+    }
+
+    printf("Light queues:");
+    for (uint8_t q = 0; q < LIGHT_MAX_QUEUES; q++) {
+        resetQueue(queues[q]);
+        queues[q].name = (q < count) ? names[q] : String("");
+        if (q < count) {
+            printf(" %s", names[q].c_str());
+        }
+    }
+    printf("\n");
+
+    queueCount = count;
+    displayIndex = 0;
+    nextTransition = 0;
+    scheduleKnown = false;
+    rebuildMergedBitmap();
+    return true;
+}
+
+void LightManager::resetQueue(LightQueue& queue) {
+    for (uint8_t day = 0; day < LIGHT_DAYS; day++) {
+        queue.ranges[day].clear();
+        queue.known[day] = false;
+        queue.emergency[day] = false;
+        queue.previousKnown[day] = false;
+    }
+    queue.currentOutage = false;
+    queue.bitmap.clear();
+}
+
+static uint32_t fnvMix(uint32_t hash, uint32_t value) {
+    return (hash ^ value) * 16777619UL;
+}
+
+// FNV-1a over the name and today's state; tomorrow is not on screen
+uint32_t LightManager::hashQueue(const LightQueue& queue) {
+    uint32_t hash = 2166136261UL;
+    for (unsigned int i = 0; i < queue.name.length(); i++) {
+        hash = fnvMix(hash, (uint8_t)queue.name[i]);
+    }
+    hash = fnvMix(hash, queue.known[0] | (queue.emergency[0] << 1) | (queue.currentOutage << 2));
+    for (size_t i = 0; i < queue.ranges[0].size(); i++) {
+        hash = fnvMix(hash, ((uint32_t)queue.ranges[0][i].start_min << 16) | queue.ranges[0][i].end_min);
+    }
+    return hash;
+}
+
+void LightManager::rebuildMergedBitmap() {
+    if (queueCount == 0) {
+        mergedBitmap.clear();
+        return;
+    }
+    mergedBitmap = queues[0].bitmap;
+    for (uint8_t q = 1; q < queueCount; q++) {
+        mergedBitmap.merge(queues[q].bitmap);
+    }
+}
+
+void LightManager::update() {
+    // Several queues share the light section - show each in turn
+    if (queueCount > 1 && millis() - lastDisplaySwitch >= LIGHT_DISPLAY_CYCLE_MS) {
+        lastDisplaySwitch = millis();
+        displayIndex = (displayIndex + 1) % queueCount;
+        refreshUI();
+    }
+
+    if (fetchInFlight) {
+        pollFetch();
+    }
+
+    // Failed requests without WiFi would only inflate the backoff
+    if (WiFi.status() != WL_CONNECTED) {
+        return;
+    }
+
     // Check if it's time to update
-    if (millis() - lastCheckTime >= cfg.light_check_interval * 1000) {
+    if (!fetchInFlight && scheduler.isDue()) {
         checkSchedule();
-        lastCheckTime = millis();
     }
 }
 
 void LightManager::forceCheck() {
-    checkSchedule();
-    lastCheckTime = millis();
+    if (!fetchInFlight) {
+        checkSchedule();
+    }
+}
+
+void LightManager::handleClockSet() {
+    if (scheduleYear < 0) {
+        printf("Light: clock set, refetching schedule\n");
+        forceUpdate();
+        return;
+    }
+    // The armed transition was computed on the old clock
+    nextTransition = 0;
+    updateActiveStates();
 }
 
 void LightManager::forceUpdate() {
+    // Staggered after the alert check so both requests don't fire at once
+    scheduler.triggerSoon(3000, 8000);
+}
+
+unsigned long LightManager::getPollInterval() {
     AlertLightConfig& cfg = configManager.getConfig();
-    unsigned long checkInterval = cfg.light_check_interval * 1000;
-    lastCheckTime = millis() - checkInterval - 1;
+    unsigned long interval = cfg.light_check_interval * 1000UL;
+
+    // Empty schedule for any queue - a new one may be published at any moment
+    bool fast = false;
+    for (uint8_t q = 0; q < queueCount && !fast; q++) {
+        fast = queues[q].ranges[0].size() == 0 && !queues[q].emergency[0];
+    }
+
+    if (!fast) {
+        int currentMinutes = timeService.getMinuteOfDay();
+        if (currentMinutes >= 0) {
+            fast = (currentMinutes >= LIGHT_PUBLISH_MORNING_START && currentMinutes < LIGHT_PUBLISH_MORNING_END) ||
+                   (currentMinutes >= LIGHT_PUBLISH_EVENING_START && currentMinutes < LIGHT_PUBLISH_EVENING_END);
+        }
+    }
+
+    if (fast) {
+        unsigned long fastInterval = interval / LIGHT_FAST_POLL_DIVISOR;
+        if (fastInterval < LIGHT_FAST_POLL_MIN_MS) {
+            fastInterval = LIGHT_FAST_POLL_MIN_MS;
+        }
+        if (fastInterval < interval) {
+            interval = fastInterval;
+        }
+    }
+    return interval;
 }
 
 void LightManager::updateActiveStates() {
-    // Only update if we have outage data
-    if (outageRanges.size() == 0 && !emergencyShutdown) {
+    // Nothing can change before the next slot boundary (or midnight)
+    if (nextTransition != 0 && timeService.now() < nextTransition) {
         return;
     }
 
-    // Get current time
-    time_t now = time(nullptr);
-    struct tm timeinfo;
-    localtime_r(&now, &timeinfo);
-    int currentMinutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
+    // No clock yet (e.g. restored schedule right after power-on)
+    if (!timeService.isValid()) {
+        return;
+    }
+    const struct tm& timeinfo = timeService.getLocalTime();
+    int currentMinutes = timeService.getMinuteOfDay();
 
-    // Recalculate active state for each outage range
-    bool hasActiveOutage = false;
     bool stateChanged = false;
+    if (scheduleYear >= 0 && (timeinfo.tm_yday != bitmapYday || timeinfo.tm_year != scheduleYear)) {
+        rolloverDay(timeinfo);
+        stateChanged = true;
+    }
+
+    if (applyActiveStates(currentMinutes)) {
+        stateChanged = true;
+    }
+    armNextTransition(timeinfo, currentMinutes);
+
+    // Update UI if state changed
+    if (stateChanged) {
+        printf("\n=== Light UI Update (updateActiveStates) ===\n");
+        publishState();
+        refreshUI();
+    }
+}
 
-    for (size_t i = 0; i < outageRanges.size(); i++) {
-        // Parse the time range to get start and end minutes
-        String timeRange = outageRanges[i].time_range;
-        int dashPos = timeRange.indexOf('-');
-        if (dashPos > 0) {
-            String startStr = timeRange.substring(0, dashPos);
-            String endStr = timeRange.substring(dashPos + 1);
+void LightManager::rolloverDay(const struct tm& timeinfo) {
+    bool nextDay = isFollowingDay(scheduleYear, bitmapYday, timeinfo);
+    bool refetch = false;
 
-            int startHour = startStr.substring(0, 2).toInt();
-            int startMin = startStr.substring(3, 5).toInt();
-            int endHour = endStr.substring(0, 2).toInt();
-            int endMin = endStr.substring(3, 5).toInt();
+    for (uint8_t q = 0; q < queueCount; q++) {
+        LightQueue& queue = queues[q];
 
-            int startMinutes = startHour * 60 + startMin;
-            int endMinutes = endHour * 60 + endMin;
+        if (nextDay && queue.known[1]) {
+            printf("Midnight rollover: queue %s, tomorrow's schedule is now today's (%d slots)\n",
+                   queue.name.c_str(), queue.ranges[1].size());
+            queue.ranges[0].swap(queue.ranges[1]);
+            queue.known[0] = true;
+            queue.emergency[0] = queue.emergency[1];
+            queue.bitmap.shiftDay();
+        } else {
+            // Nothing cached for the new day - ask Yasno soon instead of showing an old plan
+            printf("Schedule for the new day not cached for queue %s\n", queue.name.c_str());
+            queue.ranges[0].clear();
+            queue.known[0] = false;
+            queue.emergency[0] = false;
+            queue.bitmap.clear();
+            refetch = true;
+        }
 
-            bool wasActive = outageRanges[i].is_active;
-            outageRanges[i].is_active = (currentMinutes >= startMinutes && currentMinutes < endMinutes);
+        queue.ranges[1].clear();
+        queue.known[1] = false;
+        queue.emergency[1] = false;
+        for (size_t i = 0; i < queue.ranges[0].size(); i++) {
+            queue.ranges[0][i].is_active = false;
+        }
+    }
 
-            if (wasActive != outageRanges[i].is_active) {
-                stateChanged = true;
-            }
+    // One request covers all queues
+    if (refetch) {
+        scheduler.triggerSoon(0, LIGHT_ROLLOVER_POLL_SPREAD_MS);
+    }
 
-            if (outageRanges[i].is_active) {
-                hasActiveOutage = true;
+    rebuildMergedBitmap();
+    bitmapYday = timeinfo.tm_yday;
+    scheduleYear = timeinfo.tm_year;
+
+    persistState();
+}
+
+bool LightManager::isFollowingDay(int year, int yday, const struct tm& timeinfo) {
+    if (timeinfo.tm_year == year) {
+        return timeinfo.tm_yday == yday + 1;
+    }
+    // New Year's night
+    return timeinfo.tm_year == year + 1 && timeinfo.tm_yday == 0 && yday >= 364;
+}
+
+bool LightManager::applyActiveStates(int currentMinutes) {
+    bool changed = false;
+
+    for (uint8_t q = 0; q < queueCount; q++) {
+        LightQueue& queue = queues[q];
+
+        // Emergency state comes from the API only
+        bool hasActiveOutage = queue.emergency[0];
+        if (!queue.emergency[0]) {
+            for (size_t i = 0; i < queue.ranges[0].size(); i++) {
+                OutageRange& range = queue.ranges[0][i];
+                bool active = currentMinutes >= range.start_min && currentMinutes < range.end_min;
+                if (active != range.is_active) {
+                    range.is_active = active;
+                    changed = true;
+                }
+                if (active) {
+                    hasActiveOutage = true;
+                }
             }
         }
+
+        if (queue.currentOutage != hasActiveOutage) {
+            queue.currentOutage = hasActiveOutage;
+            changed = true;
+        }
     }
+    return changed;
+}
 
-    // Update currentOutage flag if changed
-    if (currentOutage != hasActiveOutage) {
-        currentOutage = hasActiveOutage;
-        stateChanged = true;
+void LightManager::armNextTransition(const struct tm& timeinfo, int currentMinutes) {
+    // Clock not synced yet - keep recalculating until it is
+    if (timeinfo.tm_year + 1900 < 2020) {
+        nextTransition = 0;
+        return;
     }
 
-    // Update UI if state changed
-    if (stateChanged) {
-        AlertLightConfig& cfg = configManager.getConfig();
-
-        if (emergencyShutdown) {
-            // Emergency shutdown - no change needed
-            return;
-        } else if (outageRanges.size() == 0) {
-            // No outages - no change needed
-            return;
-        } else {
-            // Convert vector to array for UI
-            outage_time_slot_t slots[outageRanges.size()];
-            printf("\n=== Light UI Update (updateActiveStates) ===\n");
-            printf("Queue: %s, Slots: %d\n", queueName.c_str(), outageRanges.size());
-            for (size_t i = 0; i < outageRanges.size(); i++) {
-                slots[i].time_range = outageRanges[i].time_range.c_str();
-                slots[i].is_active = outageRanges[i].is_active;
-                printf("  Slot %d: %s (active=%d)\n", i, slots[i].time_range, slots[i].is_active);
+    // Earliest slot boundary of any queue after now; midnight if none is left today
+    int next = 24 * 60;
+    for (uint8_t q = 0; q < queueCount; q++) {
+        const std::vector<OutageRange>& ranges = queues[q].ranges[0];
+        for (size_t i = 0; i < ranges.size(); i++) {
+            if (ranges[i].start_min > currentMinutes && ranges[i].start_min < next) {
+                next = ranges[i].start_min;
             }
-            AlertLight_UI_Update_Light(queueName.c_str(), slots, outageRanges.size());
-            printf("=================================\n\n");
-
-            if (currentOutage) {
-                AlertLight_UI_Update_LightIndicator_Emergency(true);
-            } else {
-                AlertLight_UI_Update_LightIndicator(true);
+            if (ranges[i].end_min > currentMinutes && ranges[i].end_min < next) {
+                next = ranges[i].end_min;
             }
         }
     }
+
+    // mktime normalizes 24:00 and handles DST days
+    struct tm target = timeinfo;
+    target.tm_hour = next / 60;
+    target.tm_min = next % 60;
+    target.tm_sec = 0;
+    target.tm_isdst = -1;
+    nextTransition = mktime(&target);
+}
+
+void LightManager::refreshSlotsUI(const LightQueue& queue) {
+    // Format only here, at the UI boundary; the screen has MAX_OUTAGE_SLOTS rows
+    const std::vector<OutageRange>& ranges = queue.ranges[0];
+    size_t count = ranges.size();
+    if (count > MAX_OUTAGE_SLOTS) {
+        count = MAX_OUTAGE_SLOTS;
+    }
+    outage_time_slot_t slots[MAX_OUTAGE_SLOTS];
+    char labels[MAX_OUTAGE_SLOTS][LIGHT_RANGE_TEXT_LEN];
+
+    String name = getDisplayQueue(queue);
+    for (size_t i = 0; i < count; i++) {
+        formatRange(ranges[i], labels[i], sizeof(labels[i]));
+        slots[i].time_range = labels[i];
+        slots[i].is_active = ranges[i].is_active;
+    }
+    AlertLight_UI_Update_Light(name.c_str(), slots, count);
+}
+
+void LightManager::refreshUI() {
+    if (displayIndex >= queueCount) {
+        displayIndex = 0;
+    }
+
+    if (queueCount == 0 || !queues[displayIndex].known[0]) {
+        // No data (yet) for today, use placeholder
+        String name = (queueCount > 0) ? queues[displayIndex].name : String(configManager.getConfig().light_queue);
+        outage_time_slot_t init_slot;
+        init_slot.time_range = "--:--";
+        init_slot.is_active = false;
+        AlertLight_UI_Update_Light(name.c_str(), &init_slot, 1);
+        return;
+    }
+
+    const LightQueue& queue = queues[displayIndex];
+    String name = getDisplayQueue(queue);
+
+    if (queue.emergency[0]) {
+        // Emergency shutdown - create single slot
+        outage_time_slot_t emergency_slot;
+        emergency_slot.time_range = "Екстрені відключення";
+        emergency_slot.is_active = true;
+        AlertLight_UI_Update_Light(name.c_str(), &emergency_slot, 1);
+        AlertLight_UI_Update_LightIndicator_Emergency(true);
+    } else if (queue.ranges[0].size() == 0) {
+        // No outages
+        outage_time_slot_t no_outage_slot;
+        no_outage_slot.time_range = "Немає";
+        no_outage_slot.is_active = false;
+        AlertLight_UI_Update_Light(name.c_str(), &no_outage_slot, 1);
+        AlertLight_UI_Update_LightIndicator(false);
+    } else {
+        refreshSlotsUI(queue);
+
+        if (queue.currentOutage) {
+            AlertLight_UI_Update_LightIndicator_Emergency(true);
+        } else {
+            AlertLight_UI_Update_LightIndicator(true);
+        }
+    }
+}
+
+String LightManager::getDisplayQueue(const LightQueue& queue) {
+    // Asterisk marks a schedule restored from the last run
+    return stateStale ? queue.name + "*" : queue.name;
+}
+
+void LightManager::formatRange(const OutageRange& range, char* buf, size_t len) {
+    snprintf(buf, len, "%02d:%02d-%02d:%02d",
+             range.start_min / 60, range.start_min % 60, range.end_min / 60, range.end_min % 60);
 }
 
 void LightManager::checkSchedule() {
     AlertLightConfig& cfg = configManager.getConfig();
 
+    if (fetchQueue == NULL) {
+        return;
+    }
+
+    // One request for all queues - the response lists every queue of the region
+    LightFetch* fetch = new LightFetch();
+    fetch->url = cfg.light_api_url;
+
+    // Network core - TLS handshakes stay off the core running LVGL and loop()
+    if (xTaskCreatePinnedToCore(fetchTask, "light_fetch", LIGHT_FETCH_STACK_SIZE, fetch, 1, NULL,
+                                LIGHT_FETCH_CORE) != pdPASS) {
+        printf("Light fetch task creation failed\n");
+        delete fetch;
+        scheduler.reportFailure();
+        return;
+    }
+    fetchInFlight = true;
+}
+
+void LightManager::fetchTask(void* param) {
+    LightFetch* fetch = (LightFetch*)param;
+    fetch->result = upstreamClient.get(fetch->url);
+
+    // Ownership passes to LightManager; only one fetch is ever in flight
+    xQueueSend(lightManager.fetchQueue, &fetch, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+void LightManager::pollFetch() {
+    LightFetch* fetch = NULL;
+    if (xQueueReceive(fetchQueue, &fetch, 0) != pdTRUE) {
+        return;
+    }
+    fetchInFlight = false;
+
+    // Address changed while the request ran - the poll is still due and goes out again
+    if (fetch->url == configManager.getConfig().light_api_url) {
+        handleFetchResult(fetch->result);
+    }
+    delete fetch;
+}
+
+void LightManager::handleFetchResult(const UpstreamResult& result) {
+    lastHTTPCode = result.httpCode;
+
+    // No NTP yet - the response date is enough to pick today's slots
+    if (result.ok()) {
+        timeService.seedFromHttpDate(result.date);
+    }
+
     // Get current time for logging
-    time_t now = time(nullptr);
-    struct tm timeinfo;
-    localtime_r(&now, &timeinfo);
     char timeStr[20];
-    strftime(timeStr, sizeof(timeStr), "%H:%M:%S", &timeinfo);
+    strftime(timeStr, sizeof(timeStr), "%H:%M:%S", &timeService.getLocalTime());
     lastCallTimeStr = String(timeStr);
 
-    HTTPClient http;
-    http.begin(cfg.light_api_url);
-    http.setTimeout(10000);
-
-    lastHTTPCode = http.GET();
+    if (result.ok()) {
+        lastResponseData = result.body;
 
-    if (lastHTTPCode == 200) {
-        lastResponseData = http.getString();
+        // What the user saw before this fetch
+        uint32_t before[LIGHT_MAX_QUEUES];
+        for (uint8_t q = 0; q < LIGHT_MAX_QUEUES; q++) {
+            before[q] = hashQueue(queues[q]);
+        }
+        uint8_t beforeCount = queueCount;
+        bool wasStale = stateStale;
 
         if (parseResponse(lastResponseData)) {
             lastError = "";
             lastSuccessTime = millis();
+            scheduleKnown = true;
 
-            // Update UI with dynamic outage slots
-            if (emergencyShutdown) {
-                // Emergency shutdown - create single slot
-                outage_time_slot_t emergency_slot;
-                emergency_slot.time_range = "Екстрені відключення";
-                emergency_slot.is_active = true;
-                AlertLight_UI_Update_Light(queueName.c_str(), &emergency_slot, 1);
-                AlertLight_UI_Update_LightIndicator_Emergency(true);
-            } else if (outageRanges.size() == 0) {
-                // No outages
-                outage_time_slot_t no_outage_slot;
-                no_outage_slot.time_range = "Немає";
-                no_outage_slot.is_active = false;
-                AlertLight_UI_Update_Light(queueName.c_str(), &no_outage_slot, 1);
-                AlertLight_UI_Update_LightIndicator(false);
-            } else {
-                // Convert vector to array for UI
-                outage_time_slot_t slots[outageRanges.size()];
-                printf("\n=== Light UI Update (checkSchedule) ===\n");
-                printf("Queue: %s, Slots: %d\n", queueName.c_str(), outageRanges.size());
-                for (size_t i = 0; i < outageRanges.size(); i++) {
-                    slots[i].time_range = outageRanges[i].time_range.c_str();
-                    slots[i].is_active = outageRanges[i].is_active;
-                    printf("  Slot %d: %s (active=%d)\n", i, slots[i].time_range, slots[i].is_active);
-                }
-                AlertLight_UI_Update_Light(queueName.c_str(), slots, outageRanges.size());
-                printf("=================================\n\n");
+            bool planChanged = detectScheduleChange();
+            if (planChanged) {
+                rgbManager.notifyScheduleChanged();
+            }
 
-                if (currentOutage) {
-                    AlertLight_UI_Update_LightIndicator_Emergency(true);
-                } else {
-                    AlertLight_UI_Update_LightIndicator(true);
-                }
+            stateStale = false;
+            persistState();
+
+            // Same plan, same active slots - the screen is already right
+            bool refresh = planChanged || wasStale || beforeCount != queueCount;
+            for (uint8_t q = 0; q < queueCount && !refresh; q++) {
+                refresh = before[q] != hashQueue(queues[q]);
             }
+            if (refresh) {
+                refreshUI();
+            }
+            scheduler.reportSuccess(getPollInterval());
         } else {
             lastError = "Failed to parse JSON response";
             printf("Light parse error\n");
+            scheduler.reportFailure();
         }
     } else {
-        lastError = "HTTP request failed: " + String(lastHTTPCode);
-        printf("Light API error: %d\n", lastHTTPCode);
+        lastError = upstreamClient.describe(result);
+        printf("Light API error: %s\n", lastError.c_str());
         lastResponseData = "";
+        scheduler.reportFailure();
+    }
+
+    publishState();
+}
+
+bool LightManager::detectScheduleChange() {
+    static const char* dayNames[LIGHT_DAYS] = {"today", "tomorrow"};
+
+    // A first schedule (boot, new day, tomorrow published, new queue) is news, not a change
+    String summary = "";
+    for (uint8_t q = 0; q < queueCount; q++) {
+        const LightQueue& queue = queues[q];
+
+        // A renamed queue was reset by syncQueues(), so nothing is previously known
+        for (uint8_t day = 0; day < LIGHT_DAYS; day++) {
+            if (!queue.previousKnown[day] || !queue.known[day]) {
+                continue;
+            }
+
+            String label = (queueCount > 1) ? queue.name + " " + dayNames[day] : String(dayNames[day]);
+            String change = "";
+            if (queue.previousEmergency[day] != queue.emergency[day]) {
+                change = label + (queue.emergency[day] ? ": emergency shutdowns" : ": back to schedule");
+            } else if (!queue.emergency[day]) {
+                change = describeDiff(label.c_str(), diffSchedules(queue.previousRanges[day], queue.ranges[day]));
+            }
+
+            if (change.length() > 0) {
+                if (summary.length() > 0) {
+                    summary += "; ";
+                }
+                summary += change;
+            }
+        }
+    }
+
+    if (summary.length() == 0) {
+        return false;
+    }
+
+    printf("Light schedule changed: %s\n", summary.c_str());
+    lastChangeSummary = summary;
+    lastChangeTimeStr = lastCallTimeStr;
+    return true;
+}
+
+ScheduleDiff LightManager::diffSchedules(const std::vector<OutageRange>& before, const std::vector<OutageRange>& after) {
+    ScheduleDiff diff = {0, 0, 0};
+
+    // At most a dozen slots per day - pairwise comparison is fine
+    for (size_t i = 0; i < after.size(); i++) {
+        bool same = false;
+        bool overlaps = false;
+        for (size_t j = 0; j < before.size(); j++) {
+            if (after[i].start_min == before[j].start_min && after[i].end_min == before[j].end_min) {
+                same = true;
+                break;
+            }
+            if (after[i].start_min < before[j].end_min && before[j].start_min < after[i].end_min) {
+                overlaps = true;
+            }
+        }
+        if (same) {
+            continue;
+        }
+        if (overlaps) {
+            diff.shifted++;
+        } else {
+            diff.added++;
+        }
+    }
+
+    for (size_t j = 0; j < before.size(); j++) {
+        bool kept = false;
+        for (size_t i = 0; i < after.size(); i++) {
+            if (after[i].start_min < before[j].end_min && before[j].start_min < after[i].end_min) {
+                kept = true;
+                break;
+            }
+        }
+        if (!kept) {
+            diff.removed++;
+        }
     }
+    return diff;
+}
 
-    http.end();
+String LightManager::describeDiff(const char* day, const ScheduleDiff& diff) {
+    if (!diff.any()) {
+        return "";
+    }
+    String text = String(day) + ":";
+    if (diff.added) {
+        text += " +" + String(diff.added) + " added";
+    }
+    if (diff.removed) {
+        text += " -" + String(diff.removed) + " removed";
+    }
+    if (diff.shifted) {
+        text += " ~" + String(diff.shifted) + " shifted";
+    }
+    return text;
 }
 
 bool LightManager::parseResponse(const String& json) {
+    syncQueues();
+
+    // The response carries every queue of the region; keep only the tracked ones
+    StaticJsonDocument<256> filter;
+    for (uint8_t q = 0; q < queueCount; q++) {
+        filter[queues[q].name] = true;
+    }
+
     StaticJsonDocument<8192> doc;
-    DeserializationError error = deserializeJson(doc, json);
+    DeserializationError error = deserializeJson(doc, json, DeserializationOption::Filter(filter));
 
     if (error) {
         return false;
     }
 
-    AlertLightConfig& cfg = configManager.getConfig();
-    queueName = String(cfg.light_queue);
-
-    if (!doc.containsKey(cfg.light_queue)) {
+    // The configured address must be there, extra queues are best effort
+    if (!doc.containsKey(queues[0].name)) {
         return false;
     }
-
-    JsonObject queueData = doc[cfg.light_queue];
-    if (!queueData.containsKey("today")) {
+    JsonObject primaryData = doc[queues[0].name];
+    if (!primaryData.containsKey("today")) {
         return false;
     }
 
-    JsonObject todayData = queueData["today"];
-    String status = todayData["status"].as<String>();
+    // The response is for the local day it was fetched on
+    const struct tm& timeinfo = timeService.getLocalTime();
+    bitmapYday = timeinfo.tm_yday;
+    scheduleYear = timeService.isValid() ? timeinfo.tm_year : -1;
+    int currentMinutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
 
-    if (status == "EmergencyShutdowns") {
-        emergencyShutdown = true;
-        currentOutage = true;
-        return true;
+    bool wasInOutage = isAnyOutage();
+    for (uint8_t q = 0; q < queueCount; q++) {
+        LightQueue& queue = queues[q];
+        JsonObject queueData = doc[queue.name];
+        if (queueData.isNull() || !queueData.containsKey("today")) {
+            printf("Queue %s not in the schedule response\n", queue.name.c_str());
+            resetQueue(queue);
+            continue;
+        }
+
+        JsonObject todayData = queueData["today"];
+        parseDay(todayData, queue, 0);
+
+        // Tomorrow is cached for the midnight rollover
+        if (queueData.containsKey("tomorrow")) {
+            JsonObject tomorrowData = queueData["tomorrow"];
+            parseDay(tomorrowData, queue, 1);
+        } else {
+            beginDay(queue, 1);
+        }
     }
+    rebuildMergedBitmap();
 
-    emergencyShutdown = false;
-    determineOutageStatus(todayData);
+    applyActiveStates(currentMinutes);
+    armNextTransition(timeinfo, currentMinutes);
+    notifyOutageChange(wasInOutage);
 
     return true;
 }
 
-void LightManager::determineOutageStatus(JsonObject& todayData) {
-    time_t now = time(nullptr);
-    struct tm timeinfo;
-    localtime_r(&now, &timeinfo);
-    int currentMinutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
+void LightManager::beginDay(LightQueue& queue, uint8_t day) {
+    // Swapped, not copied: both vectors keep their buffers from fetch to fetch
+    queue.previousRanges[day].swap(queue.ranges[day]);
+    queue.previousKnown[day] = queue.known[day];
+    queue.previousEmergency[day] = queue.emergency[day];
 
-    bool wasInOutage = currentOutage;
-    currentOutage = false;
-    outageRanges.clear();
+    queue.ranges[day].clear();
+    queue.known[day] = false;
+    queue.emergency[day] = false;
+    queue.bitmap.clearDay(day);
+}
+
+void LightManager::parseDay(JsonObject& dayData, LightQueue& queue, uint8_t day) {
+    std::vector<OutageRange>& ranges = queue.ranges[day];
+    beginDay(queue, day);
+
+    String status = dayData["status"].as<String>();
+    if (status == "EmergencyShutdowns") {
+        // No schedule to look ahead with
+        queue.known[day] = true;
+        queue.emergency[day] = true;
+        return;
+    }
+    if (day > 0 && (status == "WaitingForSchedule" || !dayData["slots"].is<JsonArray>())) {
+        // Tomorrow not published yet
+        return;
+    }
 
-    JsonArray slots = todayData["slots"].as<JsonArray>();
+    queue.known[day] = true;
+    queue.bitmap.setKnown(day);
 
+    JsonArray slots = dayData["slots"].as<JsonArray>();
     for (JsonVariant v : slots) {
         JsonObject slot = v.as<JsonObject>();
         String type = slot["type"].as<String>();
 
         if (type == "Definite") {
-            int start = slot["start"].as<int>();
-            int end = slot["end"].as<int>();
-
             OutageRange range;
-            range.time_range = formatTime(start) + "-" + formatTime(end);
-            range.is_active = (currentMinutes >= start && currentMinutes < end);
+            range.start_min = slot["start"].as<int>();
+            range.end_min = slot["end"].as<int>();
+            range.is_active = false;
 
-            if (range.is_active) {
-                currentOutage = true;
-            }
-
-            outageRanges.push_back(range);
+            ranges.push_back(range);
+            queue.bitmap.markRange(day, range.start_min, range.end_min);
         }
     }
+}
+
+void LightManager::notifyOutageChange(bool wasInOutage) {
+    // Emergency shutdowns are shown as such, not as a slot starting/ending
+    if (isAnyEmergency()) {
+        return;
+    }
 
     // Detect state changes and notify RGB manager
-    if (currentOutage != wasInOutage) {
-        if (currentOutage) {
+    bool nowInOutage = isAnyOutage();
+    if (nowInOutage != wasInOutage) {
+        if (nowInOutage) {
             // Outage started
             rgbManager.notifyOutageStarted();
         } else if (!wasInOutage && previousOutageState) {
             // Power restored (was in outage, now not)
             rgbManager.notifyPowerRestored();
         }
-        previousOutageState = currentOutage;
+        previousOutageState = nowInOutage;
+    }
+}
+
+int LightManager::bitmapMinuteNow() {
+    // Emergency days are never marked known, so they fall outside the horizon
+    if (!timeService.isValid() || timeService.getLocalTime().tm_yday != bitmapYday) {
+        return -1;
+    }
+    return timeService.getMinuteOfDay();
+}
+
+bool LightManager::isOutageIn(int minutesAhead) {
+    int minute = bitmapMinuteNow();
+    return minute >= 0 && mergedBitmap.isOutage(minute + minutesAhead);
+}
+
+bool LightManager::hasOutageWithin(int minutes) {
+    int minute = bitmapMinuteNow();
+    return minute >= 0 && mergedBitmap.hasOutageBetween(minute, minute + minutes + 1);
+}
+
+int LightManager::getMinutesUntilChange() {
+    int minute = bitmapMinuteNow();
+    if (minute < 0) {
+        return -1;
+    }
+    int change = mergedBitmap.nextChange(minute);
+    return change < 0 ? -1 : change - minute;
+}
+
+bool LightManager::isAnyOutage() {
+    for (uint8_t q = 0; q < queueCount; q++) {
+        if (queues[q].currentOutage) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LightManager::isAnyEmergency() {
+    for (uint8_t q = 0; q < queueCount; q++) {
+        if (queues[q].emergency[0]) {
+            return true;
+        }
     }
+    return false;
+}
+
+String LightManager::getLastChange() {
+    return lastChangeSummary;
+}
+
+String LightManager::getLastChangeTime() {
+    return lastChangeTimeStr;
 }
 
-String LightManager::formatTime(int minutes) {
-    int hours = minutes / 60;
-    int mins = minutes % 60;
-    char buf[6];
-    snprintf(buf, sizeof(buf), "%02d:%02d", hours, mins);
-    return String(buf);
+bool LightManager::isStateStale() {
+    return stateStale;
+}
+
+uint32_t LightManager::getStateSavedAt() {
+    return stateSavedAt;
 }
 
 // Getters for debug info
@@ -299,18 +983,42 @@ String LightManager::getLastResponse() {
     return lastResponseData;
 }
 
-bool LightManager::isEmergencyShutdown() {
-    return emergencyShutdown;
+unsigned long LightManager::getNextCheckIn() {
+    return scheduler.getMillisUntilDue();
+}
+
+uint8_t LightManager::getFailureCount() {
+    return scheduler.getFailureCount();
 }
 
-bool LightManager::isCurrentlyOutage() {
-    return currentOutage;
+uint8_t LightManager::getQueueCount() {
+    return queueCount;
 }
 
-String LightManager::getQueue() {
-    return queueName;
+String LightManager::getQueue(uint8_t queue) {
+    return queue < queueCount ? queues[queue].name : String("");
 }
 
-const std::vector<OutageRange>& LightManager::getOutageRanges() const {
-    return outageRanges;
+bool LightManager::isEmergencyShutdown(uint8_t queue) {
+    return queue < queueCount && queues[queue].emergency[0];
+}
+
+bool LightManager::isTomorrowKnown(uint8_t queue) {
+    return queue < queueCount && queues[queue].known[1];
+}
+
+bool LightManager::isTomorrowEmergency(uint8_t queue) {
+    return queue < queueCount && queues[queue].emergency[1];
+}
+
+bool LightManager::isCurrentlyOutage(uint8_t queue) {
+    return queue < queueCount && queues[queue].currentOutage;
+}
+
+const std::vector<OutageRange>& LightManager::getOutageRanges(uint8_t day, uint8_t queue) const {
+    static const std::vector<OutageRange> none;
+    if (queue >= queueCount || day >= LIGHT_DAYS) {
+        return none;
+    }
+    return queues[queue].ranges[day];
 }
@@ -2,16 +2,102 @@
 #define LIGHTMANAGER_H
 
 #include <Arduino.h>
-#include <HTTPClient.h>
 #include <ArduinoJson.h>
 #include <vector>
+#include <time.h>
 #include "../Config/Config.h"
+#include "../PollScheduler/PollScheduler.h"
+#include "../Upstream/UpstreamClient.h"
+#include "OutageBitmap.h"
+#include "../StateStore/StateStore.h"
+#include "../DeviceState/DeviceState.h"
+
+// Poll Yasno more often when the schedule is empty or around typical
+// publication times (local time, minutes since midnight)
+#define LIGHT_FAST_POLL_DIVISOR     3
+#define LIGHT_FAST_POLL_MIN_MS      120000UL  // never faster than 2 minutes
+#define LIGHT_PUBLISH_MORNING_START (7 * 60)
+#define LIGHT_PUBLISH_MORNING_END   (9 * 60)
+#define LIGHT_PUBLISH_EVENING_START (17 * 60)
+#define LIGHT_PUBLISH_EVENING_END   (23 * 60)
+
+// "HH:MM-HH:MM" plus terminator
+#define LIGHT_RANGE_TEXT_LEN        12
+
+// Schedule days kept in memory and NVS: today, tomorrow
+#define LIGHT_DAYS                  OUTAGE_DAYS
+
+// After midnight without a published schedule for the new day, refetch
+// within this window (random, so a fleet does not hit Yasno at 00:00)
+#define LIGHT_ROLLOVER_POLL_SPREAD_MS 300000UL
+
+// With several queues the light section shows each one in turn
+#define LIGHT_DISPLAY_CYCLE_MS      5000UL
+
+// The request runs in its own task so a slow Yasno never stalls loop() and LVGL
+#define LIGHT_FETCH_STACK_SIZE      10240
+#define LIGHT_FETCH_CORE            0       // WiFi/lwIP core; loop() and LVGL run on core 1
+
+// Warm start snapshot in StateStore; bump the version when the layout changes
+#define LIGHT_STATE_VERSION         3
+#define LIGHT_STATE_MAX_SLOTS       12
+#define LIGHT_QUEUE_NAME_LEN        8
+
+struct LightStateDay {
+    uint8_t known;
+    uint8_t emergency;
+    uint8_t count;
+    uint16_t start_min[LIGHT_STATE_MAX_SLOTS];
+    uint16_t end_min[LIGHT_STATE_MAX_SLOTS];
+};
+
+struct LightStateBlob {
+    uint8_t version;
+    uint8_t queueCount;
+    char queue[LIGHT_MAX_QUEUES][LIGHT_QUEUE_NAME_LEN];
+    int16_t year;       // tm_year/tm_yday of day 0, -1 = unknown
+    int16_t yday;
+    LightStateDay days[LIGHT_MAX_QUEUES][LIGHT_DAYS];
+};
+
+// One schedule request; owned by its fetch task until posted to the result queue
+struct LightFetch {
+    String url;
+    UpstreamResult result;
+};
 
 struct OutageRange {
-    String time_range;  // e.g., "08:30-12:30"
+    uint16_t start_min; // minutes since local midnight, e.g. 510 = 08:30
+    uint16_t end_min;   // exclusive, 1440 = end of day
     bool is_active;     // true if current time is in this range
 };
 
+// Schedule of one queue (day 0 = today, 1 = tomorrow), all queues come from the same fetch
+struct LightQueue {
+    String name;
+    std::vector<OutageRange> ranges[LIGHT_DAYS];
+    bool known[LIGHT_DAYS];
+    bool emergency[LIGHT_DAYS];
+    bool currentOutage;     // inside a slot right now, or emergency shutdowns
+    OutageBitmap bitmap;
+
+    // The day as the previous fetch left it, for the change summary
+    std::vector<OutageRange> previousRanges[LIGHT_DAYS];
+    bool previousKnown[LIGHT_DAYS];
+    bool previousEmergency[LIGHT_DAYS];
+};
+
+// Slot-level difference between two schedules of the same day.
+// A new slot overlapping an old one counts as shifted (moved/resized),
+// otherwise as added; old slots overlapping nothing new count as removed.
+struct ScheduleDiff {
+    uint8_t added;
+    uint8_t removed;
+    uint8_t shifted;
+
+    bool any() const { return added != 0 || removed != 0 || shifted != 0; }
+};
+
 class LightManager {
 public:
     LightManager();
@@ -22,40 +108,136 @@ public:
     // Force immediate update regardless of interval (for WiFi connection event)
     void forceUpdate();
 
-    // Recalculate active states based on current time (without API call)
+    // Recalculate active states based on current time (without API call).
+    // Cheap to call every second - does nothing until the next slot start/end.
+    // At local midnight tomorrow's cached schedule becomes today's.
     void updateActiveStates();
 
+    // Clock was set or corrected (SNTP or HTTP Date): re-evaluate slots, and
+    // fetch again if the last response arrived while the time was unknown
+    void handleClockSet();
+
+    // Restore the last saved schedule (call before WiFi starts); shown as cached until refreshed
+    void restoreState();
+
+    // Push the current schedule to the light section of the UI
+    void refreshUI();
+
+    // Format a range as "HH:MM-HH:MM" (buf must hold LIGHT_RANGE_TEXT_LEN)
+    static void formatRange(const OutageRange& range, char* buf, size_t len);
+
+    // Compare a day's schedule before/after a fetch (is_active is ignored)
+    static ScheduleDiff diffSchedules(const std::vector<OutageRange>& before, const std::vector<OutageRange>& after);
+
     // Get debug info
     String getLastCallTime();
     int getLastHTTPCode();
     String getLastError();
     String getLastResponse();
-    bool isEmergencyShutdown();
-    bool isCurrentlyOutage();
-    String getQueue();
+    unsigned long getNextCheckIn();  // milliseconds
+    uint8_t getFailureCount();
+    bool isStateStale();             // restored schedule, not confirmed by the API yet
+    uint32_t getStateSavedAt();      // epoch of the restored schedule, 0 if unknown
+    String getLastChange();          // summary of the last schedule change, empty if none
+    String getLastChangeTime();
+
+    // Per queue (0 = configured address, then the extra queues)
+    uint8_t getQueueCount();
+    String getQueue(uint8_t queue = 0);
+    bool isEmergencyShutdown(uint8_t queue = 0);
+    bool isTomorrowKnown(uint8_t queue = 0);     // tomorrow's schedule published (or emergency announced)
+    bool isTomorrowEmergency(uint8_t queue = 0);
+    bool isCurrentlyOutage(uint8_t queue = 0);
 
-    // Get outage ranges (for dynamic UI display)
-    const std::vector<OutageRange>& getOutageRanges() const;
+    // Get outage ranges (day 0 = today, 1 = tomorrow)
+    const std::vector<OutageRange>& getOutageRanges(uint8_t day = 0, uint8_t queue = 0) const;
+
+    // Merged over all queues - power is off at any of the tracked addresses
+    bool isAnyOutage();
+    bool isAnyEmergency();
+
+    // Look-ahead over the merged quarter-hour bitmap (O(1) queries)
+    bool isOutageIn(int minutesAhead);        // false if unknown
+    bool hasOutageWithin(int minutes);        // any outage from now until now + minutes
+    int getMinutesUntilChange();              // until power goes off / returns, -1 if unknown
 
 private:
-    unsigned long lastCheckTime;
+    PollScheduler scheduler;
     unsigned long lastSuccessTime;
     String lastCallTimeStr;
     int lastHTTPCode;
     String lastError;
     String lastResponseData;
-    bool emergencyShutdown;
-    bool currentOutage;
-    bool previousOutageState;  // Track previous state for RGB notifications
-    String queueName;
+    bool previousOutageState;  // Track previous merged state for RGB notifications
+    bool scheduleKnown;        // Until then "no outage" only means "no data"
+
+    // Configured queues, filled from one response; day 0 of every queue is bitmapYday
+    LightQueue queues[LIGHT_MAX_QUEUES];
+    uint8_t queueCount;
+    OutageBitmap mergedBitmap;
+
+    // Queue shown in the light section
+    uint8_t displayIndex;
+    unsigned long lastDisplaySwitch;
+
+    // Next slot start/end of any queue (epoch seconds), 0 = recalculate on next call
+    time_t nextTransition;
 
-    // Outage ranges for display
-    std::vector<OutageRange> outageRanges;
+    int bitmapYday;
+    int scheduleYear;   // tm_year of day 0, -1 if the clock was not set
 
+    // Last user-visible schedule change (for the web page)
+    String lastChangeSummary;
+    String lastChangeTimeStr;
+
+    // Warm start
+    LightStateBlob persistedState;
+    bool stateStale;
+    uint32_t stateSavedAt;
+    void persistState();
+
+    // Copy the reader-facing state into deviceState
+    void publishState();
+    static void packDay(LightStateDay& out, const LightQueue& queue, uint8_t day);
+    static void unpackDay(const LightStateDay& in, LightQueue& queue, uint8_t day);
+    void refreshSlotsUI(const LightQueue& queue);
+    String getDisplayQueue(const LightQueue& queue);
+
+    // Rebuild the queue list from config; true (and all schedules forgotten) if it changed
+    bool syncQueues();
+    static void resetQueue(LightQueue& queue);
+    static uint32_t hashQueue(const LightQueue& queue);   // What the light section shows
+    void rebuildMergedBitmap();
+
+    unsigned long getPollInterval();
+
+    // Fetch on the network core, result handled from update()
+    QueueHandle_t fetchQueue;
+    bool fetchInFlight;
     void checkSchedule();
+    void pollFetch();
+    void handleFetchResult(const UpstreamResult& result);
+    static void fetchTask(void* param);
+
+    // Compare each day against the previous fetch; true if the visible plan moved
+    bool detectScheduleChange();
+    static String describeDiff(const char* day, const ScheduleDiff& diff);
+
     bool parseResponse(const String& json);
-    String formatTime(int minutes);
-    void determineOutageStatus(JsonObject& todayData);
+    void parseDay(JsonObject& dayData, LightQueue& queue, uint8_t day);
+    static void beginDay(LightQueue& queue, uint8_t day);
+    void notifyOutageChange(bool wasInOutage);
+
+    // Local midnight passed since the schedule was fetched
+    void rolloverDay(const struct tm& timeinfo);
+    static bool isFollowingDay(int year, int yday, const struct tm& timeinfo);
+
+    // Minutes since midnight of the bitmap's "today", -1 if clock/data not usable
+    int bitmapMinuteNow();
+
+    // Mark active ranges of all queues for currentMinutes; returns true if any flag changed
+    bool applyActiveStates(int currentMinutes);
+    void armNextTransition(const struct tm& timeinfo, int currentMinutes);
 };
 
 extern LightManager lightManager;
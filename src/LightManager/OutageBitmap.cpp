@@ -0,0 +1,144 @@
+#include "OutageBitmap.h"
+
+OutageBitmap::OutageBitmap() {
+    clear();
+}
+
+void OutageBitmap::clear() {
+    memset(words, 0, sizeof(words));
+    memset(known, 0, sizeof(known));
+}
+
+void OutageBitmap::clearDay(uint8_t day) {
+    if (day >= OUTAGE_DAYS) {
+        return;
+    }
+    int from = day * OUTAGE_SLOTS_PER_DAY;
+    int to = from + OUTAGE_SLOTS_PER_DAY;
+    for (int i = 0; i < OUTAGE_BITMAP_WORDS; i++) {
+        words[i] &= ~wordMask(i, from, to);
+    }
+    known[day] = false;
+}
+
+void OutageBitmap::shiftDay() {
+    // A day is a whole number of words, so this is a plain word move
+    static_assert(OUTAGE_SLOTS_PER_DAY % 32 == 0, "day must be word aligned");
+    const int dayWords = OUTAGE_SLOTS_PER_DAY / 32;
+    for (int i = 0; i < OUTAGE_BITMAP_WORDS; i++) {
+        words[i] = (i + dayWords < OUTAGE_BITMAP_WORDS) ? words[i + dayWords] : 0;
+    }
+    for (int d = 0; d < OUTAGE_DAYS; d++) {
+        known[d] = (d + 1 < OUTAGE_DAYS) ? known[d + 1] : false;
+    }
+}
+
+void OutageBitmap::merge(const OutageBitmap& other) {
+    for (int i = 0; i < OUTAGE_BITMAP_WORDS; i++) {
+        words[i] |= other.words[i];
+    }
+    for (int d = 0; d < OUTAGE_DAYS; d++) {
+        known[d] = known[d] && other.known[d];
+    }
+}
+
+void OutageBitmap::markRange(uint8_t day, int startMin, int endMin) {
+    if (day >= OUTAGE_DAYS || endMin <= startMin) {
+        return;
+    }
+    int from = startMin / OUTAGE_SLOT_MINUTES;
+    int to = (endMin + OUTAGE_SLOT_MINUTES - 1) / OUTAGE_SLOT_MINUTES;
+    from = constrain(from, 0, OUTAGE_SLOTS_PER_DAY);
+    to = constrain(to, 0, OUTAGE_SLOTS_PER_DAY);
+
+    int base = day * OUTAGE_SLOTS_PER_DAY;
+    setBits(base + from, base + to);
+    known[day] = true;
+}
+
+void OutageBitmap::setKnown(uint8_t day) {
+    if (day < OUTAGE_DAYS) {
+        known[day] = true;
+    }
+}
+
+bool OutageBitmap::isKnown(uint8_t day) const {
+    return day < OUTAGE_DAYS && known[day];
+}
+
+int OutageBitmap::getHorizon() const {
+    // Tomorrow is only usable if today is known as well
+    int days = 0;
+    while (days < OUTAGE_DAYS && known[days]) {
+        days++;
+    }
+    return days * 24 * 60;
+}
+
+bool OutageBitmap::isOutage(int minute) const {
+    if (minute < 0 || minute >= getHorizon()) {
+        return false;
+    }
+    return testBit(minute / OUTAGE_SLOT_MINUTES);
+}
+
+bool OutageBitmap::hasOutageBetween(int fromMinute, int toMinute) const {
+    int horizon = getHorizon();
+    fromMinute = constrain(fromMinute, 0, horizon);
+    toMinute = constrain(toMinute, 0, horizon);
+    if (toMinute <= fromMinute) {
+        return false;
+    }
+
+    int from = fromMinute / OUTAGE_SLOT_MINUTES;
+    int to = (toMinute + OUTAGE_SLOT_MINUTES - 1) / OUTAGE_SLOT_MINUTES;
+    for (int i = from / 32; i <= (to - 1) / 32; i++) {
+        if (words[i] & wordMask(i, from, to)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int OutageBitmap::nextChange(int fromMinute) const {
+    int horizon = getHorizon();
+    if (fromMinute < 0 || fromMinute >= horizon) {
+        return -1;
+    }
+
+    int from = fromMinute / OUTAGE_SLOT_MINUTES;
+    int to = horizon / OUTAGE_SLOT_MINUTES;
+    bool state = testBit(from);
+
+    // First bit after 'from' that differs from the current state
+    for (int i = from / 32; i <= (to - 1) / 32; i++) {
+        uint32_t diff = state ? ~words[i] : words[i];
+        diff &= wordMask(i, from + 1, to);
+        if (diff != 0) {
+            return (i * 32 + __builtin_ctz(diff)) * OUTAGE_SLOT_MINUTES;
+        }
+    }
+    return -1;
+}
+
+bool OutageBitmap::testBit(int bit) const {
+    return (words[bit / 32] >> (bit % 32)) & 1;
+}
+
+void OutageBitmap::setBits(int fromBit, int toBit) {
+    for (int i = fromBit / 32; i < OUTAGE_BITMAP_WORDS && i * 32 < toBit; i++) {
+        words[i] |= wordMask(i, fromBit, toBit);
+    }
+}
+
+uint32_t OutageBitmap::wordMask(int word, int fromBit, int toBit) {
+    // Bits of [fromBit, toBit) that fall into this word
+    int lo = max(fromBit - word * 32, 0);
+    int hi = min(toBit - word * 32, 32);
+    if (hi <= lo) {
+        return 0;
+    }
+    uint32_t upper = (hi == 32) ? 0xFFFFFFFFu : ((1u << hi) - 1);
+    uint32_t lower = (1u << lo) - 1;
+    return upper & ~lower;
+}
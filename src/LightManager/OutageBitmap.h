@@ -0,0 +1,58 @@
+#ifndef OUTAGEBITMAP_H
+#define OUTAGEBITMAP_H
+
+#include <Arduino.h>
+
+// Quarter-hour occupancy for today and tomorrow: one bit per 15 minutes,
+// set when power is scheduled to be off. Minutes are counted from today's
+// local midnight, so tomorrow continues at 1440.
+#define OUTAGE_SLOT_MINUTES     15
+#define OUTAGE_SLOTS_PER_DAY    (24 * 60 / OUTAGE_SLOT_MINUTES)   // 96
+#define OUTAGE_DAYS             2                                  // today, tomorrow
+#define OUTAGE_BITMAP_WORDS     ((OUTAGE_SLOTS_PER_DAY * OUTAGE_DAYS + 31) / 32)
+
+class OutageBitmap {
+public:
+    OutageBitmap();
+
+    // Forget everything (both days unknown)
+    void clear();
+
+    // Forget one day (0 = today, 1 = tomorrow)
+    void clearDay(uint8_t day);
+
+    // Local midnight: tomorrow becomes today, tomorrow unknown
+    void shiftDay();
+
+    // OR in another bitmap (e.g. another queue). A day stays known only
+    // if both are known - an unknown queue must not read as "no outage".
+    void merge(const OutageBitmap& other);
+
+    // Mark [startMin, endMin) of a day as outage and the day as known.
+    // Partial quarters are rounded outward - never under-report an outage.
+    void markRange(uint8_t day, int startMin, int endMin);
+    void setKnown(uint8_t day);
+    bool isKnown(uint8_t day) const;
+
+    // Minutes from today's midnight covered by known data (0, 1440 or 2880)
+    int getHorizon() const;
+
+    // Point query, false outside the known horizon
+    bool isOutage(int minute) const;
+
+    // Any outage in [fromMinute, toMinute)
+    bool hasOutageBetween(int fromMinute, int toMinute) const;
+
+    // Minute at which the on/off state next flips, -1 if not within the horizon
+    int nextChange(int fromMinute) const;
+
+private:
+    uint32_t words[OUTAGE_BITMAP_WORDS];
+    bool known[OUTAGE_DAYS];
+
+    bool testBit(int bit) const;
+    void setBits(int fromBit, int toBit);
+    static uint32_t wordMask(int word, int fromBit, int toBit);
+};
+
+#endif // OUTAGEBITMAP_H
@@ -0,0 +1,263 @@
+#include "LoopScheduler.h"
+
+LoopScheduler loopScheduler;
+
+LoopScheduler::LoopScheduler() {
+    taskCount = 0;
+    for (int i = 0; i < LOOP_WHEEL_SLOTS; i++) {
+        wheel[i] = LOOP_TASK_NONE;
+    }
+    wheelPos = 0;
+    wheelTime = 0;
+    postedMask = 0;
+    loopTask = NULL;
+    runningTask = LOOP_TASK_NONE;
+    wakeups = 0;
+    busyMicros = 0;
+    loadWindowStart = 0;
+}
+
+void LoopScheduler::begin() {
+    loopTask = xTaskGetCurrentTaskHandle();
+    wheelTime = millis();
+    rehash();   // Tasks added before begin() were bucketed against time 0
+    loadWindowStart = micros();
+    printf("Loop scheduler started (%d tasks)\n", taskCount);
+}
+
+int8_t LoopScheduler::every(const char* name, uint32_t periodMs, LoopTaskFn fn, uint32_t firstDelayMs) {
+    return addTask(name, periodMs > 0 ? periodMs : LOOP_TICK_MS, fn, firstDelayMs);
+}
+
+int8_t LoopScheduler::after(const char* name, uint32_t delayMs, LoopTaskFn fn) {
+    return addTask(name, 0, fn, delayMs);
+}
+
+int8_t LoopScheduler::addTask(const char* name, uint32_t periodMs, LoopTaskFn fn, uint32_t delayMs) {
+    if (fn == NULL || taskCount >= LOOP_MAX_TASKS) {
+        printf("Loop scheduler: cannot add task %s\n", name);
+        return LOOP_TASK_NONE;
+    }
+    int8_t id = taskCount++;
+    Task& task = tasks[id];
+    task.name = name;
+    task.fn = fn;
+    task.periodMs = periodMs;
+    task.active = false;
+    task.rearmed = false;
+    task.next = LOOP_TASK_NONE;
+    task.bucket = 0;
+    task.runCount = 0;
+    task.totalMicros = 0;
+    task.maxMicros = 0;
+    arm(id, millis() + delayMs);
+    return id;
+}
+
+void LoopScheduler::runIn(int8_t id, uint32_t delayMs) {
+    if (id < 0 || id >= taskCount) {
+        return;
+    }
+    arm(id, millis() + delayMs);
+    if (id == runningTask) {
+        tasks[id].rearmed = true;
+    }
+}
+
+void LoopScheduler::cancel(int8_t id) {
+    if (id < 0 || id >= taskCount) {
+        return;
+    }
+    unlink(id);
+    if (id == runningTask) {
+        tasks[id].rearmed = true;   // Keeps execute() from re-arming it
+    }
+}
+
+void LoopScheduler::post(int8_t id) {
+    if (id < 0 || id >= taskCount) {
+        return;
+    }
+    __atomic_fetch_or(&postedMask, 1UL << id, __ATOMIC_SEQ_CST);
+    if (loopTask != NULL) {
+        xTaskNotifyGive(loopTask);
+    }
+}
+
+void LoopScheduler::arm(int8_t id, unsigned long deadline) {
+    unlink(id);
+
+    // Buckets are relative to the wheel position; anything more than one
+    // revolution ahead shares a bucket and is told apart by its deadline
+    long offset = (long)(deadline - wheelTime);
+    if (offset < 0) {
+        offset = 0;
+    }
+    uint16_t bucket = (wheelPos + offset / LOOP_TICK_MS) % LOOP_WHEEL_SLOTS;
+
+    Task& task = tasks[id];
+    task.deadline = deadline;
+    task.bucket = bucket;
+    task.next = wheel[bucket];
+    task.active = true;
+    wheel[bucket] = id;
+}
+
+void LoopScheduler::unlink(int8_t id) {
+    Task& task = tasks[id];
+    if (!task.active) {
+        return;
+    }
+    int8_t* link = &wheel[task.bucket];
+    while (*link != LOOP_TASK_NONE) {
+        if (*link == id) {
+            *link = task.next;
+            break;
+        }
+        link = &tasks[*link].next;
+    }
+    task.next = LOOP_TASK_NONE;
+    task.active = false;
+}
+
+void LoopScheduler::advance(unsigned long now, int8_t* due, uint8_t& dueCount) {
+    uint16_t steps = 0;
+    while (true) {
+        // Collect what is due in the current bucket
+        int8_t id = wheel[wheelPos];
+        while (id != LOOP_TASK_NONE) {
+            int8_t next = tasks[id].next;
+            if ((long)(now - tasks[id].deadline) >= 0) {
+                unlink(id);
+                due[dueCount++] = id;
+            }
+            id = next;
+        }
+
+        if ((long)(now - wheelTime) < LOOP_TICK_MS) {
+            break;
+        }
+        if (++steps >= LOOP_WHEEL_SLOTS) {
+            // Slept longer than a revolution - every bucket has been checked,
+            // restart the wheel at now
+            wheelTime = now;
+            rehash();
+            break;
+        }
+        wheelTime += LOOP_TICK_MS;
+        wheelPos = (wheelPos + 1) % LOOP_WHEEL_SLOTS;
+    }
+}
+
+void LoopScheduler::rehash() {
+    for (int8_t id = 0; id < taskCount; id++) {
+        if (tasks[id].active) {
+            arm(id, tasks[id].deadline);
+        }
+    }
+}
+
+void LoopScheduler::execute(int8_t id, bool fromWheel) {
+    Task& task = tasks[id];
+
+    runningTask = id;
+    task.rearmed = false;
+    unsigned long start = micros();
+    task.fn();
+    uint32_t elapsed = micros() - start;
+    runningTask = LOOP_TASK_NONE;
+
+    task.runCount++;
+    task.totalMicros += elapsed;
+    if (elapsed > task.maxMicros) {
+        task.maxMicros = elapsed;
+    }
+
+    // A posted run leaves the timer as it was
+    if (!fromWheel || task.rearmed || task.periodMs == 0) {
+        return;
+    }
+
+    // Keep the period's phase; if we fell behind, skip the missed runs
+    unsigned long now = millis();
+    unsigned long next = task.deadline + task.periodMs;
+    if ((long)(now - next) >= 0) {
+        next = now + task.periodMs;
+    }
+    arm(id, next);
+}
+
+unsigned long LoopScheduler::nextDeadline(unsigned long now) {
+    // A handful of tasks - a linear scan beats walking up to 256 buckets
+    long wait = LOOP_MAX_SLEEP_MS;
+    for (int8_t id = 0; id < taskCount; id++) {
+        if (tasks[id].active) {
+            long left = (long)(tasks[id].deadline - now);
+            if (left < wait) {
+                wait = left;
+            }
+        }
+    }
+    return wait > 0 ? wait : 0;
+}
+
+void LoopScheduler::run() {
+    unsigned long start = micros();
+    unsigned long now = millis();
+
+    int8_t due[LOOP_MAX_TASKS];
+    uint8_t dueCount = 0;
+    advance(now, due, dueCount);
+
+    uint32_t posted = __atomic_exchange_n(&postedMask, 0, __ATOMIC_SEQ_CST);
+    for (uint8_t i = 0; i < dueCount; i++) {
+        posted &= ~(1UL << due[i]);
+        execute(due[i], true);
+    }
+    for (int8_t id = 0; posted != 0 && id < taskCount; id++) {
+        if (posted & (1UL << id)) {
+            posted &= ~(1UL << id);
+            execute(id, false);
+        }
+    }
+
+    busyMicros += micros() - start;
+
+    // Sleep until the next deadline; post() ends the wait early.
+    // At least one tick, so the idle task on this core always gets to run.
+    TickType_t ticks = pdMS_TO_TICKS(nextDeadline(millis()));
+    ulTaskNotifyTake(pdTRUE, ticks > 0 ? ticks : 1);
+    wakeups++;
+}
+
+uint8_t LoopScheduler::getTaskCount() {
+    return taskCount;
+}
+
+LoopTaskInfo LoopScheduler::getTaskInfo(uint8_t id) {
+    LoopTaskInfo info;
+    memset(&info, 0, sizeof(info));
+    if (id < taskCount) {
+        const Task& task = tasks[id];
+        info.name = task.name;
+        info.periodMs = task.periodMs;
+        info.active = task.active;
+        info.runCount = task.runCount;
+        info.totalMicros = task.totalMicros;
+        info.maxMicros = task.maxMicros;
+    }
+    return info;
+}
+
+uint8_t LoopScheduler::getLoadPercent() {
+    unsigned long now = micros();
+    unsigned long window = now - loadWindowStart;
+    uint8_t percent = window > 0 ? (uint8_t)min((uint64_t)100, busyMicros * 100 / window) : 0;
+    busyMicros = 0;
+    loadWindowStart = now;
+    return percent;
+}
+
+uint32_t LoopScheduler::getWakeups() {
+    return wakeups;
+}
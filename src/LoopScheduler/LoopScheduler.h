@@ -0,0 +1,105 @@
+#ifndef LOOPSCHEDULER_H
+#define LOOPSCHEDULER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define LOOP_MAX_TASKS          16
+#define LOOP_TICK_MS            5       // Wheel resolution
+#define LOOP_WHEEL_SLOTS        256     // One revolution = 1.28 s, longer than a sleep
+#define LOOP_MAX_SLEEP_MS       1000    // Upper bound even with nothing due
+
+#define LOOP_TASK_NONE          -1
+
+typedef void (*LoopTaskFn)();
+
+// Per-task accounting, shown on the status page
+struct LoopTaskInfo {
+    const char* name;
+    uint32_t periodMs;          // 0 = one-shot
+    bool active;                // Armed on the wheel
+    uint32_t runCount;
+    uint64_t totalMicros;
+    uint32_t maxMicros;
+};
+
+// Cooperative scheduler for everything loop() used to poll with
+// millis() checks. Tasks live on a hashed timer wheel keyed by their
+// deadline; run() executes whatever is due and then blocks the loop task
+// until the earliest deadline or until post() wakes it.
+//
+// All tasks run on the loop task. Only post() may be called from other
+// tasks (e.g. a network callback that wants its handler run now).
+class LoopScheduler {
+public:
+    LoopScheduler();
+
+    // Capture the loop task handle (call from setup())
+    void begin();
+
+    // Periodic task, first run after firstDelayMs; returns the id or LOOP_TASK_NONE
+    int8_t every(const char* name, uint32_t periodMs, LoopTaskFn fn, uint32_t firstDelayMs = 0);
+
+    // One-shot task; re-arm it with runIn()
+    int8_t after(const char* name, uint32_t delayMs, LoopTaskFn fn);
+
+    // Move the next run of a task (also from inside its own callback)
+    void runIn(int8_t id, uint32_t delayMs);
+
+    // Disarm a task; its slot stays reserved so the id remains valid
+    void cancel(int8_t id);
+
+    // Run the task on the next pass regardless of its deadline (any task context)
+    void post(int8_t id);
+
+    // Run due and posted tasks, then sleep until the next deadline (call from loop())
+    void run();
+
+    // Accounting
+    uint8_t getTaskCount();
+    LoopTaskInfo getTaskInfo(uint8_t id);
+    uint8_t getLoadPercent();   // Busy share of the loop task since the last call
+    uint32_t getWakeups();
+
+private:
+    struct Task {
+        const char* name;
+        LoopTaskFn fn;
+        uint32_t periodMs;
+        unsigned long deadline;     // millis()
+        bool active;
+        bool rearmed;               // runIn() called while running
+        int8_t next;                // Bucket chain
+        uint16_t bucket;
+        uint32_t runCount;
+        uint64_t totalMicros;
+        uint32_t maxMicros;
+    };
+
+    Task tasks[LOOP_MAX_TASKS];
+    uint8_t taskCount;
+    int8_t wheel[LOOP_WHEEL_SLOTS];     // Head of each bucket chain
+    uint16_t wheelPos;                  // Bucket for wheelTime
+    unsigned long wheelTime;            // millis() the wheel has advanced to
+
+    volatile uint32_t postedMask;
+    TaskHandle_t loopTask;
+    int8_t runningTask;
+
+    uint32_t wakeups;
+    uint64_t busyMicros;
+    unsigned long loadWindowStart;      // micros()
+
+    int8_t addTask(const char* name, uint32_t periodMs, LoopTaskFn fn, uint32_t delayMs);
+    void arm(int8_t id, unsigned long deadline);
+    void unlink(int8_t id);
+    void advance(unsigned long now, int8_t* due, uint8_t& dueCount);
+    void execute(int8_t id, bool fromWheel);
+    void rehash();
+    unsigned long nextDeadline(unsigned long now);
+};
+
+extern LoopScheduler loopScheduler;
+
+#endif // LOOPSCHEDULER_H
@@ -0,0 +1,69 @@
+#include "PollScheduler.h"
+
+PollScheduler::PollScheduler(const char* name) : name(name) {
+    scheduledAt = 0;
+    delayMs = 0;  // First poll is due immediately
+    consecutiveFailures = 0;
+}
+
+bool PollScheduler::isDue() {
+    return millis() - scheduledAt >= delayMs;
+}
+
+void PollScheduler::reportSuccess(unsigned long intervalMs) {
+    if (consecutiveFailures > 0) {
+        printf("[%s] Recovered after %d failure(s)\n", name, consecutiveFailures);
+    }
+    consecutiveFailures = 0;
+    scheduleIn(withJitter(intervalMs, POLL_JITTER_PERCENT));
+}
+
+void PollScheduler::reportFailure() {
+    if (consecutiveFailures < 255) {
+        consecutiveFailures++;
+    }
+
+    // Exponential backoff: min << (failures - 1), capped
+    unsigned long backoff = POLL_BACKOFF_MAX_MS;
+    if (consecutiveFailures <= 16) {
+        backoff = POLL_BACKOFF_MIN_MS << (consecutiveFailures - 1);
+        if (backoff > POLL_BACKOFF_MAX_MS) {
+            backoff = POLL_BACKOFF_MAX_MS;
+        }
+    }
+
+    backoff = withJitter(backoff, POLL_BACKOFF_JITTER_PERCENT);
+    printf("[%s] Poll failed (%d in a row), retry in %lu ms\n", name, consecutiveFailures, backoff);
+    scheduleIn(backoff);
+}
+
+void PollScheduler::triggerSoon(unsigned long minDelayMs, unsigned long maxDelayMs) {
+    unsigned long span = maxDelayMs > minDelayMs ? maxDelayMs - minDelayMs : 0;
+    unsigned long ms = minDelayMs + (span > 0 ? esp_random() % (span + 1) : 0);
+    consecutiveFailures = 0;
+    scheduleIn(ms);
+}
+
+unsigned long PollScheduler::getMillisUntilDue() {
+    unsigned long elapsed = millis() - scheduledAt;
+    return elapsed >= delayMs ? 0 : delayMs - elapsed;
+}
+
+uint8_t PollScheduler::getFailureCount() {
+    return consecutiveFailures;
+}
+
+void PollScheduler::scheduleIn(unsigned long ms) {
+    scheduledAt = millis();
+    delayMs = ms;
+}
+
+unsigned long PollScheduler::withJitter(unsigned long ms, uint8_t percent) {
+    unsigned long range = ms * percent / 100;
+    if (range == 0) {
+        return ms;
+    }
+    // Uniform in [ms - range, ms + range]
+    unsigned long offset = esp_random() % (2 * range + 1);
+    return ms - range + offset;
+}
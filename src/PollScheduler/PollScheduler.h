@@ -0,0 +1,45 @@
+#ifndef POLLSCHEDULER_H
+#define POLLSCHEDULER_H
+
+#include <Arduino.h>
+
+// Retry backoff on HTTP/connection errors: 5s, 10s, 20s ... capped at 10 minutes
+#define POLL_BACKOFF_MIN_MS     5000UL
+#define POLL_BACKOFF_MAX_MS     600000UL
+
+// Jitter applied to every scheduled poll (percent of the delay, +/-)
+#define POLL_JITTER_PERCENT     10
+#define POLL_BACKOFF_JITTER_PERCENT 25
+
+// Decides when the next upstream API poll is due.
+// Owners report each outcome; the scheduler handles backoff and jitter
+// so a fleet of devices does not hit the API in lockstep.
+class PollScheduler {
+public:
+    PollScheduler(const char* name);
+
+    // True when the next poll is due
+    bool isDue();
+
+    // Report poll outcome and schedule the next one
+    void reportSuccess(unsigned long intervalMs);
+    void reportFailure();
+
+    // Schedule a poll within the next maxDelayMs (random, for WiFi connect events)
+    void triggerSoon(unsigned long minDelayMs, unsigned long maxDelayMs);
+
+    // Debug info
+    unsigned long getMillisUntilDue();
+    uint8_t getFailureCount();
+
+private:
+    const char* name;
+    unsigned long scheduledAt;   // millis() when the current delay was set
+    unsigned long delayMs;       // delay from scheduledAt until the next poll
+    uint8_t consecutiveFailures;
+
+    void scheduleIn(unsigned long ms);
+    static unsigned long withJitter(unsigned long ms, uint8_t percent);
+};
+
+#endif // POLLSCHEDULER_H
@@ -1,7 +1,6 @@
 #include "RGBManager.h"
-#include "../AlertManager/AlertManager.h"
-#include "../LightManager/LightManager.h"
-#include "../RGB_Lamp/RGB_lamp.h"
+#include "../DeviceState/DeviceState.h"
+#include "../LedEffects/LedEffects.h"
 
 RGBManager rgbManager;
 
@@ -10,28 +9,30 @@ RGBManager::RGBManager() {
     previousOutageState = false;
     currentMode = MODE_AMBIENT;
     blinkStartTime = 0;
-    lastBlinkToggle = 0;
-    blinkState = false;
+    blinkDurationMs = 0;
     testMode = false;
+    queueCount = 0;
 }
 
 void RGBManager::begin() {
+    ledEffects.begin();
+    ledEffects.setPixelCount(configManager.getConfig().led_count);
+    ledEffects.setColorOrder(configManager.getConfig().led_color_order);
     printf("RGB Manager initialized\n");
     currentMode = MODE_AMBIENT;
 }
 
 void RGBManager::update() {
-    // In test mode, don't auto-timeout blinks (user controls when to exit)
-    if (!testMode) {
-        // Check for blink timeout in normal mode
-        if (currentMode != MODE_AMBIENT) {
-            AlertLightConfig& cfg = configManager.getConfig();
-            unsigned long blinkDuration = cfg.blink_total_duration * 1000; // Convert to ms
-
-            if (millis() - blinkStartTime >= blinkDuration) {
-                printf("Blink completed, returning to ambient mode\n");
-                currentMode = MODE_AMBIENT;
-            }
+    // The effect engine ends blinks on its own; once the window has passed,
+    // stop() makes sure the strip is back on the base layer even if that
+    // last frame was missed. Test mode plays them until the user leaves it.
+    if (!testMode && isBlinking() && millis() - blinkStartTime >= blinkDurationMs) {
+        ledEffects.stop();
+    }
+    if (!testMode && isBlinking() && !ledEffects.isRunning()) {
+        if (!playNextQueued()) {
+            printf("Blink completed, returning to ambient mode\n");
+            currentMode = MODE_AMBIENT;
         }
     }
 
@@ -44,7 +45,10 @@ void RGBManager::update() {
         case MODE_BLINK_ALERT_DISMISS:
         case MODE_BLINK_OUTAGE_START:
         case MODE_BLINK_RESTORE:
-            updateBlink();
+        case MODE_BLINK_SCHEDULE_CHANGE:
+            // Frames come from the effect timer; keep the base layer under
+            // it current (visible beside the effect in the split layout)
+            updateAmbient();
             break;
         case MODE_TEST:
             // Test mode with no active pattern - keep current color
@@ -84,67 +88,234 @@ void RGBManager::notifyPowerRestored() {
     startBlink(MODE_BLINK_RESTORE);
 }
 
+void RGBManager::notifyScheduleChanged() {
+    if (testMode) {
+        return;
+    }
+    startBlink(MODE_BLINK_SCHEDULE_CHANGE);
+}
+
 void RGBManager::startBlink(RGBMode mode) {
-    printf("[RGBManager] startBlink() called with mode=%d\n", mode);
+    RGBPriority newPriority = getPriority(mode);
+    RGBPriority currentPriority = getPriority(currentMode);
+    uint32_t durationMs = getEventDuration(mode);
+
+    printf("[RGBManager] startBlink() mode=%d, priority new=%d current=%d\n", mode, newPriority, currentPriority);
+
+    // The opposite event still waiting is outdated now (e.g. a queued
+    // "alert started" when the alert has already been dismissed)
+    removeQueued(getOpposite(mode));
+
+    if (!isBlinking() || mode == currentMode || currentMode == getOpposite(mode)) {
+        // Idle, the same event again, or the end of what is showing now
+        removeQueued(mode);
+        playNow(mode, durationMs);
+    } else if (newPriority > currentPriority) {
+        // Pre-empt; the interrupted blink resumes later with what it had left
+        uint32_t elapsed = millis() - blinkStartTime;
+        RGBMode interrupted = currentMode;
+        if (blinkDurationMs > elapsed && blinkDurationMs - elapsed >= RGB_REQUEUE_MIN_MS) {
+            enqueue(interrupted, blinkDurationMs - elapsed);
+        }
+        removeQueued(mode);
+        playNow(mode, durationMs);
+    } else {
+        printf("[RGBManager] Queued behind the current blink\n");
+        enqueue(mode, durationMs);
+    }
+}
 
-    // Priority check - only interrupt if new event has higher priority
-    RGBPriority newPriority;
-    RGBPriority currentPriority;
+void RGBManager::playNow(RGBMode mode, uint32_t durationMs) {
+    printf("[RGBManager] Starting blink! Setting mode to %d for %lu ms\n", mode, (unsigned long)durationMs);
+    currentMode = mode;
+    blinkStartTime = millis();
+    blinkDurationMs = durationMs;
+    playEffect(mode, durationMs);
+}
 
-    switch (mode) {
-        case MODE_BLINK_ALERT_START: newPriority = PRIORITY_ALERT_START; break;
-        case MODE_BLINK_ALERT_DISMISS: newPriority = PRIORITY_ALERT_DISMISS; break;
-        case MODE_BLINK_OUTAGE_START: newPriority = PRIORITY_OUTAGE_START; break;
-        case MODE_BLINK_RESTORE: newPriority = PRIORITY_RESTORE; break;
-        default: return;
+void RGBManager::enqueue(RGBMode mode, uint32_t durationMs) {
+    // Coalesce: one entry per event, keeping the longer duration
+    for (uint8_t i = 0; i < queueCount; i++) {
+        if (queue[i].mode == mode) {
+            if (durationMs > queue[i].durationMs) {
+                queue[i].durationMs = durationMs;
+            }
+            return;
+        }
     }
 
-    switch (currentMode) {
-        case MODE_BLINK_ALERT_START: currentPriority = PRIORITY_ALERT_START; break;
-        case MODE_BLINK_ALERT_DISMISS: currentPriority = PRIORITY_ALERT_DISMISS; break;
-        case MODE_BLINK_OUTAGE_START: currentPriority = PRIORITY_OUTAGE_START; break;
-        case MODE_BLINK_RESTORE: currentPriority = PRIORITY_RESTORE; break;
-        default: currentPriority = PRIORITY_AMBIENT; break;
+    if (queueCount == RGB_QUEUE_SIZE) {
+        // Full - make room by dropping the least important entry, if it is
+        // less important than the new one
+        uint8_t lowest = 0;
+        for (uint8_t i = 1; i < queueCount; i++) {
+            if (getPriority(queue[i].mode) < getPriority(queue[lowest].mode)) {
+                lowest = i;
+            }
+        }
+        if (getPriority(queue[lowest].mode) >= getPriority(mode)) {
+            printf("[RGBManager] Queue full, dropping mode %d\n", mode);
+            return;
+        }
+        printf("[RGBManager] Queue full, dropping queued mode %d\n", queue[lowest].mode);
+        queue[lowest] = queue[--queueCount];
     }
 
-    printf("[RGBManager] Priority check: new=%d, current=%d, currentMode=%d\n", newPriority, currentPriority, currentMode);
+    queue[queueCount].mode = mode;
+    queue[queueCount].durationMs = durationMs;
+    queueCount++;
+}
 
-    if (newPriority >= currentPriority) {
-        printf("[RGBManager] Starting blink! Setting mode to %d\n", mode);
-        currentMode = mode;
-        blinkStartTime = millis();
-        lastBlinkToggle = millis();
-        blinkState = true;
-    } else {
-        printf("[RGBManager] Blink blocked by higher priority current mode\n");
+void RGBManager::removeQueued(RGBMode mode) {
+    for (uint8_t i = 0; i < queueCount; i++) {
+        if (queue[i].mode == mode) {
+            // Keep arrival order for equal priorities
+            memmove(&queue[i], &queue[i + 1], (queueCount - i - 1) * sizeof(RGBNotification));
+            queueCount--;
+            return;
+        }
+    }
+}
+
+bool RGBManager::playNextQueued() {
+    if (queueCount == 0) {
+        return false;
+    }
+    // Highest priority first, earliest arrival among equals
+    uint8_t next = 0;
+    for (uint8_t i = 1; i < queueCount; i++) {
+        if (getPriority(queue[i].mode) > getPriority(queue[next].mode)) {
+            next = i;
+        }
     }
+    RGBNotification item = queue[next];
+    removeQueued(item.mode);
+    printf("[RGBManager] Playing queued mode %d (%d left)\n", item.mode, queueCount);
+    playNow(item.mode, item.durationMs);
+    return true;
 }
 
-void RGBManager::updateBlink() {
+RGBPriority RGBManager::getPriority(RGBMode mode) {
+    switch (mode) {
+        case MODE_BLINK_ALERT_START: return PRIORITY_ALERT_START;
+        case MODE_BLINK_ALERT_DISMISS: return PRIORITY_ALERT_DISMISS;
+        case MODE_BLINK_OUTAGE_START: return PRIORITY_OUTAGE_START;
+        case MODE_BLINK_RESTORE: return PRIORITY_RESTORE;
+        case MODE_BLINK_SCHEDULE_CHANGE: return PRIORITY_SCHEDULE_CHANGE;
+        default: return PRIORITY_AMBIENT;
+    }
+}
+
+RGBMode RGBManager::getOpposite(RGBMode mode) {
+    switch (mode) {
+        case MODE_BLINK_ALERT_START: return MODE_BLINK_ALERT_DISMISS;
+        case MODE_BLINK_ALERT_DISMISS: return MODE_BLINK_ALERT_START;
+        case MODE_BLINK_OUTAGE_START: return MODE_BLINK_RESTORE;
+        case MODE_BLINK_RESTORE: return MODE_BLINK_OUTAGE_START;
+        default: return MODE_AMBIENT;   // Never queued
+    }
+}
+
+uint32_t RGBManager::getEventDuration(RGBMode mode) {
     AlertLightConfig& cfg = configManager.getConfig();
-    unsigned long now = millis();
-    unsigned long blinkInterval = blinkState ? cfg.blink_on_duration : cfg.blink_off_duration;
+    switch (mode) {
+        case MODE_BLINK_ALERT_START:
+        case MODE_BLINK_OUTAGE_START:
+            return cfg.blink_total_duration * 1000UL;
+        default:
+            // All-clear and schedule news - worth a look, not a long one
+            return cfg.blink_info_duration * 1000UL;
+    }
+}
+
+void RGBManager::playEffect(RGBMode mode, uint32_t durationMs) {
+    AlertLightConfig& cfg = configManager.getConfig();
+    ledEffects.play(getEffect(mode), getBlinkColor(mode), cfg.blink_on_duration, cfg.blink_off_duration,
+                    durationMs, getEffectSegment(mode));
+}
 
-    if (now - lastBlinkToggle >= blinkInterval) {
-        lastBlinkToggle = now;
-        blinkState = !blinkState;
+LedEffect RGBManager::getEffect(RGBMode mode) {
+    switch (mode) {
+        case MODE_BLINK_ALERT_START:
+        case MODE_BLINK_SCHEDULE_CHANGE:
+            return LED_EFFECT_PULSE_TRAIN;  // Attention
+        case MODE_BLINK_OUTAGE_START:
+            return LED_EFFECT_BREATHE;
+        case MODE_BLINK_ALERT_DISMISS:
+        case MODE_BLINK_RESTORE:
+            return LED_EFFECT_FADE;         // All clear - calm
+        default:
+            return LED_EFFECT_NONE;
     }
+}
 
-    if (blinkState) {
-        uint32_t color = getBlinkColor(currentMode);
-        setRGBColor(color, 255); // Full brightness for blink
-    } else {
-        setRGBColor(0x000000, 0); // Off
+uint8_t RGBManager::getEffectSegment(RGBMode mode) {
+    if (!isSplitLayout()) {
+        return LED_SEGMENT_ALL;
+    }
+    switch (mode) {
+        case MODE_BLINK_ALERT_START:
+        case MODE_BLINK_ALERT_DISMISS:
+            return 0;   // Alert half
+        default:
+            return 1;   // Outage half
     }
 }
 
 void RGBManager::updateAmbient() {
+    // Picks up a changed strip length or colour order straight from the config
+    ledEffects.setPixelCount(configManager.getConfig().led_count);
+    ledEffects.setColorOrder(configManager.getConfig().led_color_order);
+
+    if (isSplitLayout()) {
+        LedSegment segments[2];
+        getSplitSegments(segments);
+        ledEffects.showSegments(segments, 2);
+        return;
+    }
+
     uint32_t color;
     uint8_t brightness;
     getRGBAmbientColor(color, brightness);
     setRGBColor(color, brightness);
 }
 
+bool RGBManager::isSplitLayout() {
+    AlertLightConfig& cfg = configManager.getConfig();
+    return cfg.led_layout == LED_LAYOUT_SPLIT && cfg.led_count >= 2;
+}
+
+void RGBManager::getSplitSegments(LedSegment* segments) {
+    AlertLightConfig& cfg = configManager.getConfig();
+    uint8_t brightness = map(cfg.ambient_brightness, 0, 100, 0, 255);
+    DeviceSnapshot state = deviceState.read();
+
+    // Left half: alert status of the watched regions
+    uint16_t left = cfg.led_count / 2;
+    segments[0].first = 0;
+    segments[0].count = left;
+    segments[0].brightness = brightness;
+    if (state.alert.active) {
+        segments[0].color = cfg.color_alert;
+    } else if (state.alert.known) {
+        segments[0].color = cfg.color_no_alert;
+    } else {
+        segments[0].color = cfg.color_no_status;
+    }
+
+    // Right half: power, merged over all tracked queues
+    segments[1].first = left;
+    segments[1].count = cfg.led_count - left;
+    segments[1].brightness = brightness;
+    if (state.light.anyOutage || state.light.anyEmergency) {
+        segments[1].color = cfg.color_outage;
+    } else if (state.light.known) {
+        segments[1].color = cfg.color_no_alert;
+    } else {
+        segments[1].color = cfg.color_no_status;
+    }
+}
+
 uint32_t RGBManager::getBlinkColor(RGBMode mode) {
     AlertLightConfig& cfg = configManager.getConfig();
     switch (mode) {
@@ -156,6 +327,8 @@ uint32_t RGBManager::getBlinkColor(RGBMode mode) {
             return cfg.color_blink_outage;
         case MODE_BLINK_RESTORE:
             return cfg.color_blink_restore;
+        case MODE_BLINK_SCHEDULE_CHANGE:
+            return cfg.color_blink_schedule;
         default:
             return 0x000000;
     }
@@ -165,17 +338,21 @@ void RGBManager::getRGBAmbientColor(uint32_t& color, uint8_t& brightness) {
     AlertLightConfig& cfg = configManager.getConfig();
     brightness = map(cfg.ambient_brightness, 0, 100, 0, 255);
 
+    // Published state, never the managers' live members
+    DeviceSnapshot state = deviceState.read();
+
     // Priority: Alert > Outage > No Alert
-    bool isAlert = alertManager.isAlertActive();
-    bool isOutage = lightManager.isCurrentlyOutage();
-    bool isEmergency = lightManager.isEmergencyShutdown();
+    bool isAlert = state.alert.active;
+    // Merged over all tracked queues (addresses)
+    bool isOutage = state.light.anyOutage;
+    bool isEmergency = state.light.anyEmergency;
 
     if (isAlert) {
         color = cfg.color_alert;
     } else if (isEmergency || isOutage) {
         color = cfg.color_outage;
-    } else if (alertManager.getLastHTTPCode() == 200) {
-        // Connected and no alert
+    } else if (state.alert.known) {
+        // No alert (fresh, or restored from the last run until the API answers)
         color = cfg.color_no_alert;
     } else {
         // No status (not connected to API)
@@ -184,17 +361,7 @@ void RGBManager::getRGBAmbientColor(uint32_t& color, uint8_t& brightness) {
 }
 
 void RGBManager::setRGBColor(uint32_t color, uint8_t brightness) {
-    uint8_t r = (color >> 16) & 0xFF;
-    uint8_t g = (color >> 8) & 0xFF;
-    uint8_t b = color & 0xFF;
-
-    // Apply brightness
-    r = (r * brightness) / 255;
-    g = (g * brightness) / 255;
-    b = (b * brightness) / 255;
-
-    // WS2812B LEDs use GRB order, not RGB
-    RGB_Lamp_SetColor(g, r, b);
+    ledEffects.showSolid(color, brightness);
 }
 
 uint32_t RGBManager::getCurrentColor() {
@@ -212,13 +379,32 @@ bool RGBManager::isBlinking() {
     return currentMode != MODE_AMBIENT && currentMode != MODE_TEST;
 }
 
+String RGBManager::getQueueSummary() {
+    if (queueCount == 0) {
+        return "empty";
+    }
+    String summary;
+    for (uint8_t i = 0; i < queueCount; i++) {
+        if (i > 0) {
+            summary += ", ";
+        }
+        summary += getModeName(queue[i].mode) + " " + String(queue[i].durationMs / 1000) + "s";
+    }
+    return summary;
+}
+
 String RGBManager::getCurrentMode() {
-    switch (currentMode) {
+    return getModeName(currentMode);
+}
+
+String RGBManager::getModeName(RGBMode mode) {
+    switch (mode) {
         case MODE_AMBIENT: return "Ambient";
         case MODE_BLINK_ALERT_START: return "Alert Started (Red)";
         case MODE_BLINK_ALERT_DISMISS: return "Alert Dismissed (Green)";
         case MODE_BLINK_OUTAGE_START: return "Outage Started (Blue)";
         case MODE_BLINK_RESTORE: return "Power Restored (Yellow)";
+        case MODE_BLINK_SCHEDULE_CHANGE: return "Schedule Changed (Magenta)";
         case MODE_TEST: return "Test Mode";
         default: return "Unknown";
     }
@@ -227,6 +413,8 @@ String RGBManager::getCurrentMode() {
 // Test mode functions
 void RGBManager::setTestMode(bool enabled) {
     testMode = enabled;
+    queueCount = 0;
+    ledEffects.stop();
     if (enabled) {
         printf("RGB Test Mode: ENABLED\n");
         currentMode = MODE_TEST;
@@ -239,41 +427,41 @@ void RGBManager::setTestMode(bool enabled) {
 void RGBManager::testBlinkAlertStart() {
     if (!testMode) setTestMode(true);
     currentMode = MODE_BLINK_ALERT_START;
-    blinkStartTime = millis();
-    lastBlinkToggle = millis();
-    blinkState = true;
+    playEffect(currentMode, 0);  // Until the user leaves test mode
     printf("TEST: Alert Start blink (RED)\n");
 }
 
 void RGBManager::testBlinkAlertDismiss() {
     if (!testMode) setTestMode(true);
     currentMode = MODE_BLINK_ALERT_DISMISS;
-    blinkStartTime = millis();
-    lastBlinkToggle = millis();
-    blinkState = true;
+    playEffect(currentMode, 0);  // Until the user leaves test mode
     printf("TEST: Alert Dismiss blink (GREEN)\n");
 }
 
 void RGBManager::testBlinkOutageStart() {
     if (!testMode) setTestMode(true);
     currentMode = MODE_BLINK_OUTAGE_START;
-    blinkStartTime = millis();
-    lastBlinkToggle = millis();
-    blinkState = true;
+    playEffect(currentMode, 0);  // Until the user leaves test mode
     printf("TEST: Outage Start blink (BLUE)\n");
 }
 
 void RGBManager::testBlinkRestore() {
     if (!testMode) setTestMode(true);
     currentMode = MODE_BLINK_RESTORE;
-    blinkStartTime = millis();
-    lastBlinkToggle = millis();
-    blinkState = true;
+    playEffect(currentMode, 0);  // Until the user leaves test mode
     printf("TEST: Power Restore blink (YELLOW)\n");
 }
 
+void RGBManager::testBlinkScheduleChange() {
+    if (!testMode) setTestMode(true);
+    currentMode = MODE_BLINK_SCHEDULE_CHANGE;
+    playEffect(currentMode, 0);  // Until the user leaves test mode
+    printf("TEST: Schedule Change blink (MAGENTA)\n");
+}
+
 void RGBManager::testAmbient() {
     if (!testMode) setTestMode(true);
     currentMode = MODE_AMBIENT;
+    ledEffects.stop();
     printf("TEST: Ambient mode\n");
 }
@@ -3,14 +3,19 @@
 
 #include <Arduino.h>
 #include "../Config/Config.h"
+#include "../LedEffects/LedEffects.h"
+
+#define RGB_QUEUE_SIZE          4       // Pending notifications besides the one playing
+#define RGB_REQUEUE_MIN_MS      3000    // A pre-empted blink with less left than this is dropped
 
 // RGB state priorities (higher = more important)
 enum RGBPriority {
     PRIORITY_AMBIENT = 0,      // Normal ambient status display
-    PRIORITY_RESTORE = 1,      // Power restoration (yellow)
-    PRIORITY_OUTAGE_START = 2, // Power outage starting (blue)
-    PRIORITY_ALERT_DISMISS = 3,// Alert dismissed (green)
-    PRIORITY_ALERT_START = 4   // Alert started (red) - highest priority
+    PRIORITY_SCHEDULE_CHANGE = 1, // Outage schedule moved (magenta)
+    PRIORITY_RESTORE = 2,      // Power restoration (yellow)
+    PRIORITY_OUTAGE_START = 3, // Power outage starting (blue)
+    PRIORITY_ALERT_DISMISS = 4,// Alert dismissed (green)
+    PRIORITY_ALERT_START = 5   // Alert started (red) - highest priority
 };
 
 // RGB modes
@@ -20,9 +25,16 @@ enum RGBMode {
     MODE_BLINK_ALERT_DISMISS,  // Blink green - alert dismissed
     MODE_BLINK_OUTAGE_START,   // Blink blue - outage started
     MODE_BLINK_RESTORE,        // Blink yellow - power restored
+    MODE_BLINK_SCHEDULE_CHANGE,// Blink magenta - outage schedule changed
     MODE_TEST                  // Test mode (manual control)
 };
 
+// A notification waiting for the LED
+struct RGBNotification {
+    RGBMode mode;
+    uint32_t durationMs;
+};
+
 class RGBManager {
 public:
     RGBManager();
@@ -34,6 +46,7 @@ public:
     void notifyAlertDismissed();
     void notifyOutageStarted();
     void notifyPowerRestored();
+    void notifyScheduleChanged();
 
     // Test mode control (for web interface)
     void setTestMode(bool enabled);
@@ -41,13 +54,16 @@ public:
     void testBlinkAlertDismiss();
     void testBlinkOutageStart();
     void testBlinkRestore();
+    void testBlinkScheduleChange();
     void testAmbient();
     bool isInTestMode() { return testMode; }
     String getCurrentMode();
+    static String getModeName(RGBMode mode);
 
     // Get current state for web interface
     uint32_t getCurrentColor();
     bool isBlinking();
+    String getQueueSummary();
 
 private:
     // State tracking
@@ -55,15 +71,32 @@ private:
     bool previousOutageState;
     RGBMode currentMode;
     unsigned long blinkStartTime;
-    unsigned long lastBlinkToggle;
-    bool blinkState;
+    uint32_t blinkDurationMs;
     bool testMode;
 
-    // Blink control
+    // Pending notifications, played highest priority first once the
+    // current blink ends
+    RGBNotification queue[RGB_QUEUE_SIZE];
+    uint8_t queueCount;
+
+    // Blink control - the pattern itself is rendered by ledEffects
     void startBlink(RGBMode mode);
-    void updateBlink();
+    void playNow(RGBMode mode, uint32_t durationMs);
+    void enqueue(RGBMode mode, uint32_t durationMs);
+    void removeQueued(RGBMode mode);
+    bool playNextQueued();
+    static RGBPriority getPriority(RGBMode mode);
+    static RGBMode getOpposite(RGBMode mode);
+    uint32_t getEventDuration(RGBMode mode);
+    void playEffect(RGBMode mode, uint32_t durationMs);
+    static LedEffect getEffect(RGBMode mode);
+    uint8_t getEffectSegment(RGBMode mode);
     void updateAmbient();
 
+    // Strip layout
+    bool isSplitLayout();
+    void getSplitSegments(LedSegment* segments);
+
     // RGB output
     void setRGBColor(uint32_t color, uint8_t brightness);
     void getRGBAmbientColor(uint32_t& color, uint8_t& brightness);
@@ -30,10 +30,115 @@ uint8_t RGB_Data[192][3] = {
   {49, 0, 16}, {50, 0, 15}, {51, 0, 14}, {52, 0, 13}, {53, 0, 12}, {54, 0, 11}, {55, 0, 10}, {56, 0, 9},
   {57, 0, 8},  {58, 0, 7},  {59, 0, 6},  {60, 0, 5},  {61, 0, 4},  {62, 0, 3},  {63, 0, 2},  {64, 0, 1}
 };
+// One persistent RMT channel for the strip; a WS2812 pixel is 24 bits and the
+// whole strip goes out as one asynchronous transaction, so the caller never
+// waits for the wire. The symbol buffer grows with the strip.
+static bool Rmt_Ready = false;
+static uint8_t *Last_Frame = NULL;                                      // GRB as sent
+static uint16_t Last_Count = 0;                                         // Pixels in Last_Frame, 0 = nothing sent
+static rmt_data_t *Frame_Bits = NULL;                                   // Must outlive the async write
+static uint16_t Frame_Capacity = 0;                                     // Pixels the buffers can hold
+static uint32_t Frames_Sent = 0;
+static uint32_t Frames_Skipped = 0;
+
+static void Encode_Frame(const uint8_t *grb, uint16_t count)
+{
+  // WS2812 timing at 10 MHz: 0 = 0.4 us high / 0.8 us low, 1 = 0.8 us high / 0.4 us low
+  rmt_data_t *bit = Frame_Bits;
+  for (uint32_t i = 0; i < (uint32_t)count * 3; i++) {
+    for (uint8_t mask = 0x80; mask != 0; mask >>= 1) {
+      bool one = grb[i] & mask;
+      bit->level0 = 1;
+      bit->duration0 = one ? 8 : 4;
+      bit->level1 = 0;
+      bit->duration1 = one ? 4 : 8;
+      bit++;
+    }
+  }
+}
+
+static bool Reserve_Frame(uint16_t count)
+{
+  if (count <= Frame_Capacity) {
+    return true;
+  }
+  uint8_t *frame = (uint8_t *)malloc((size_t)count * 3);
+  rmt_data_t *bits = (rmt_data_t *)malloc((size_t)count * 24 * sizeof(rmt_data_t));
+  if (frame == NULL || bits == NULL) {
+    printf("RGB lamp: no memory for %u pixels\n", count);
+    free(frame);
+    free(bits);
+    return false;
+  }
+  if (Last_Frame != NULL) {
+    memcpy(frame, Last_Frame, (size_t)Last_Count * 3);
+  }
+  free(Last_Frame);
+  free(Frame_Bits);
+  Last_Frame = frame;
+  Frame_Bits = bits;
+  Frame_Capacity = count;
+  return true;
+}
+
+bool RGB_Lamp_Write(const uint8_t *grb, uint16_t count)
+{
+  if (count == 0) {
+    return false;
+  }
+  if (count == Last_Count && memcmp(grb, Last_Frame, (size_t)count * 3) == 0) {
+    Frames_Skipped++;
+    return true;
+  }
+
+  if (!Rmt_Ready) {
+    Rmt_Ready = rmtInit(PIN_NEOPIXEL, RMT_TX_MODE, RMT_MEM_NUM_BLOCKS_1, RGB_LAMP_RMT_HZ);
+    if (!Rmt_Ready) {
+      printf("RGB lamp: RMT init failed, falling back to neopixelWrite\n");
+      neopixelWrite(PIN_NEOPIXEL, grb[1], grb[0], grb[2]);
+      return true;                                                      // First pixel sent, nothing to retry
+    }
+  }
+
+  // Previous frame still on the wire (its buffer is in use) - leave Last_Frame
+  // alone so the next call retries
+  if (Frames_Sent > 0 && !rmtTransmitCompleted(PIN_NEOPIXEL)) {
+    return false;
+  }
+
+  // A shorter strip than last time: blank the pixels that drop out once
+  uint16_t wireCount = count < Last_Count ? Last_Count : count;
+  if (!Reserve_Frame(wireCount)) {
+    return false;
+  }
+  memcpy(Last_Frame, grb, (size_t)count * 3);
+  memset(Last_Frame + (size_t)count * 3, 0, (size_t)(wireCount - count) * 3);
+  Encode_Frame(Last_Frame, wireCount);
+  if (!rmtWriteAsync(PIN_NEOPIXEL, Frame_Bits, (size_t)wireCount * 24)) {
+    Last_Count = 0;                                                     // Unknown on the wire - resend next time
+    return false;
+  }
+  Last_Count = count;
+  Frames_Sent++;
+  return true;
+}
+
 // data range -> Red:0~255  Green:0~255  Blue:0~255
 void Set_Color(uint8_t Red,uint8_t Green,uint8_t Blue)                                            // Set RGB bead color
 {
-  neopixelWrite(PIN_NEOPIXEL, Red, Green, Blue);  
+  // Same byte order neopixelWrite() used: green first
+  uint8_t grb[3] = {Green, Red, Blue};
+  RGB_Lamp_Write(grb, 1);
+}
+
+uint32_t RGB_Lamp_GetFramesSent(void)
+{
+  return Frames_Sent;
+}
+
+uint32_t RGB_Lamp_GetFramesSkipped(void)
+{
+  return Frames_Skipped;
 }
 void RGB_Lamp_Loop(uint16_t Waiting)
 { 
@@ -3,6 +3,11 @@
 
 #define PIN_NEOPIXEL 38
 
-void Set_Color(uint8_t Red,uint8_t Green,uint8_t Blue);                 // Set RGB bead color
+#define RGB_LAMP_RMT_HZ 10000000                                       // 0.1 us per RMT tick
+
+void Set_Color(uint8_t Red,uint8_t Green,uint8_t Blue);                 // Set RGB bead color (skipped if unchanged)
+bool RGB_Lamp_Write(const uint8_t *grb, uint16_t count);               // Send a strip frame, 3 bytes per pixel in wire order (skipped if unchanged)
+uint32_t RGB_Lamp_GetFramesSent(void);                                  // Frames actually put on the wire
+uint32_t RGB_Lamp_GetFramesSkipped(void);                               // Writes dropped as identical to the last frame
 void RGB_Lamp_Loop(uint16_t Waiting);                                   // The lamp beads change color in cycles
 inline void RGB_Lamp_SetColor(uint8_t r, uint8_t g, uint8_t b) { Set_Color(r, g, b); }  // Wrapper for consistency
\ No newline at end of file
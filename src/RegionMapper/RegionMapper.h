@@ -60,6 +60,16 @@ public:
         return "Region " + String(regionId);
     }
 
+    // Get untrimmed region name by ID (as used by name-keyed APIs), NULL if not found
+    static const char* getFullRegionName(uint16_t regionId) {
+        for (int i = 0; i < REGIONS_COUNT; i++) {
+            if (REGIONS[i].id == regionId) {
+                return REGIONS[i].name;
+            }
+        }
+        return NULL;
+    }
+
     // Get region ID by name, returns 0 if not found
     static uint16_t getRegionId(const String& regionName) {
         for (int i = 0; i < REGIONS_COUNT; i++) {
@@ -0,0 +1,77 @@
+#include "StateStore.h"
+#include <time.h>
+
+StateStore stateStore;
+
+StateStore::StateStore() {
+    ready = false;
+}
+
+void StateStore::begin() {
+    ready = preferences.begin("alertlight_st", false);
+    if (!ready) {
+        printf("[StateStore] Failed to open NVS namespace\n");
+    }
+}
+
+bool StateStore::save(const char* key, const void* data, size_t len) {
+    if (!ready) {
+        return false;
+    }
+
+    time_t now = time(nullptr);
+    RecordHeader header;
+    header.savedAt = (now >= 1000000000) ? (uint32_t)now : 0;
+
+    size_t recordLen = sizeof(header) + len;
+    uint8_t* record = (uint8_t*)malloc(recordLen);
+    if (record == NULL) {
+        return false;
+    }
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), data, len);
+    bool ok = preferences.putBytes(key, record, recordLen) == recordLen;
+    free(record);
+
+    // Once per key after an update from the two-entry layout
+    char tkey[16];
+    timeKey(key, tkey, sizeof(tkey));
+    if (ok && preferences.isKey(tkey)) {
+        preferences.remove(tkey);
+    }
+
+    printf("[StateStore] Saved %s (%d bytes)%s\n", key, recordLen, ok ? "" : " - FAILED");
+    return ok;
+}
+
+bool StateStore::load(const char* key, void* data, size_t len, uint32_t& savedAt) {
+    if (!ready || !preferences.isKey(key)) {
+        return false;
+    }
+
+    // Blob layout changed (firmware update, or a record without the
+    // timestamp header from older firmware) - ignore it
+    size_t recordLen = sizeof(RecordHeader) + len;
+    if (preferences.getBytesLength(key) != recordLen) {
+        printf("[StateStore] %s has a different size, ignored\n", key);
+        return false;
+    }
+
+    uint8_t* record = (uint8_t*)malloc(recordLen);
+    if (record == NULL) {
+        return false;
+    }
+    bool ok = preferences.getBytes(key, record, recordLen) == recordLen;
+    if (ok) {
+        RecordHeader header;
+        memcpy(&header, record, sizeof(header));
+        savedAt = header.savedAt;
+        memcpy(data, record + sizeof(header), len);
+    }
+    free(record);
+    return ok;
+}
+
+void StateStore::timeKey(const char* key, char* out, size_t len) {
+    snprintf(out, len, "%s_t", key);
+}
@@ -0,0 +1,40 @@
+#ifndef STATESTORE_H
+#define STATESTORE_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Last known alert/schedule state, kept in NVS so the screen and LED are
+// right within a second of power-on instead of after the first API round.
+// Separate namespace from the config, so a config reset leaves it alone
+// and frequent state writes never touch the config keys.
+class StateStore {
+public:
+    StateStore();
+
+    void begin();
+
+    // Save a blob under key, with the current epoch time (0 if the clock is not set)
+    // in the same record - one NVS write and commit. Callers only save when the
+    // content actually changed.
+    bool save(const char* key, const void* data, size_t len);
+
+    // Load a blob saved with the same size; savedAt is the epoch time it was saved
+    bool load(const char* key, void* data, size_t len, uint32_t& savedAt);
+
+private:
+    Preferences preferences;
+    bool ready;
+
+    // Stored in front of the caller's blob
+    struct RecordHeader {
+        uint32_t savedAt;
+    };
+
+    // Older firmware kept the timestamp under a separate "<key>_t"
+    static void timeKey(const char* key, char* out, size_t len);
+};
+
+extern StateStore stateStore;
+
+#endif // STATESTORE_H
@@ -0,0 +1,209 @@
+#include "TimeService.h"
+#include <esp_sntp.h>
+#include <sys/time.h>
+
+TimeService timeService;
+
+TimeService::TimeService() {
+    subscriberCount = 0;
+    epoch = 0;
+    memset(&local, 0, sizeof(local));
+    valid = false;
+    lastMinute = -1;
+    lastYday = -1;
+    syncSource = TIME_SYNC_NONE;
+    lastSyncMillis = 0;
+    sntpSynced = false;
+    seedPending = false;
+}
+
+void TimeService::begin() {
+    // The RTC keeps running across a software restart - only the TZ is lost
+    setenv("TZ", TIME_TZ_KYIV, 1);
+    tzset();
+    refresh();
+    lastMinute = getMinuteOfDay();
+    lastYday = valid ? local.tm_yday : -1;
+    syncSource = valid ? TIME_SYNC_RTC : TIME_SYNC_NONE;
+    printf("Time service: TZ %s, clock %s\n", TIME_TZ_KYIV, valid ? "set" : "not set");
+}
+
+void TimeService::startSync() {
+    // Non-blocking: SNTP runs in the lwIP task and calls back when the clock is set
+    sntp_set_time_sync_notification_cb(onSntpSync);
+    sntp_set_sync_interval(TIME_RESYNC_MS);
+    configTzTime(TIME_TZ_KYIV, TIME_NTP_SERVER_1, TIME_NTP_SERVER_2);
+    printf("Time service: SNTP started\n");
+}
+
+void TimeService::onSntpSync(struct timeval* tv) {
+    // lwIP task context - only flag it, update() does the rest
+    timeService.sntpSynced = true;
+}
+
+bool TimeService::seedFromHttpDate(const String& date) {
+    if (date.length() == 0) {
+        return false;
+    }
+    if (valid && !(syncSource == TIME_SYNC_HTTP_DATE && millis() - lastSyncMillis >= TIME_RESYNC_MS)) {
+        return false;
+    }
+
+    time_t t;
+    if (!parseHttpDate(date, t)) {
+        printf("Time service: unusable Date header '%s'\n", date.c_str());
+        return false;
+    }
+
+    struct timeval tv;
+    tv.tv_sec = t;
+    tv.tv_usec = 0;
+    settimeofday(&tv, NULL);
+
+    syncSource = TIME_SYNC_HTTP_DATE;
+    lastSyncMillis = millis();
+    seedPending = true;
+
+    // Callers parse the response right after this - give them the new time now
+    refresh();
+    printf("Time service: clock seeded from HTTP Date (%s)\n", date.c_str());
+    return true;
+}
+
+bool TimeService::parseHttpDate(const String& date, time_t& out) {
+    static const char* months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+    char monthName[4] = {0};
+    int day, year, hour, minute, second;
+    if (sscanf(date.c_str(), "%*3s, %d %3s %d %d:%d:%d", &day, monthName, &year, &hour, &minute, &second) != 6) {
+        return false;
+    }
+    const char* found = strstr(months, monthName);
+    if (found == NULL || strlen(monthName) != 3 || (found - months) % 3 != 0) {
+        return false;
+    }
+    int month = (found - months) / 3 + 1;
+    if (year < TIME_MIN_VALID_YEAR || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return false;
+    }
+
+    // Days since 1970-01-01 for a proleptic Gregorian date (UTC, no TZ involved)
+    int y = year - (month <= 2 ? 1 : 0);
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    long days = (long)era * 146097 + doe - 719468;
+
+    out = (time_t)days * 86400 + hour * 3600 + minute * 60 + second;
+    return true;
+}
+
+bool TimeService::refresh() {
+    time_t t = time(nullptr);
+    if (t == epoch) {
+        return false;
+    }
+    epoch = t;
+    localtime_r(&epoch, &local);
+    valid = local.tm_year + 1900 >= TIME_MIN_VALID_YEAR;
+    return true;
+}
+
+void TimeService::update() {
+    bool synced = seedPending;
+    seedPending = false;
+    if (sntpSynced) {
+        sntpSynced = false;
+        syncSource = TIME_SYNC_NTP;
+        lastSyncMillis = millis();
+        synced = true;
+        printf("Time service: SNTP sync complete\n");
+    }
+
+    if (!refresh() && !synced) {
+        return;
+    }
+
+    // Day first, so minute subscribers already see the new day handled
+    if (valid) {
+        if (lastYday >= 0 && local.tm_yday != lastYday) {
+            dispatch(TIME_EVENT_MIDNIGHT);
+        }
+        lastYday = local.tm_yday;
+    }
+
+    int minute = getMinuteOfDay();
+    if (minute != lastMinute) {
+        lastMinute = minute;
+        dispatch(TIME_EVENT_MINUTE);
+    }
+
+    dispatch(TIME_EVENT_SECOND);
+
+    if (synced) {
+        dispatch(TIME_EVENT_SYNCED);
+    }
+}
+
+bool TimeService::subscribe(TimeEvent event, TimeCallback callback) {
+    if (callback == NULL || subscriberCount >= TIME_MAX_SUBSCRIBERS) {
+        printf("Time service: subscriber table full\n");
+        return false;
+    }
+    subscribers[subscriberCount].event = event;
+    subscribers[subscriberCount].callback = callback;
+    subscriberCount++;
+    return true;
+}
+
+void TimeService::dispatch(TimeEvent event) {
+    for (uint8_t i = 0; i < subscriberCount; i++) {
+        if (subscribers[i].event == event) {
+            subscribers[i].callback(local);
+        }
+    }
+}
+
+bool TimeService::isValid() {
+    return valid;
+}
+
+time_t TimeService::now() {
+    return epoch;
+}
+
+const struct tm& TimeService::getLocalTime() {
+    return local;
+}
+
+int TimeService::getMinuteOfDay() {
+    return valid ? local.tm_hour * 60 + local.tm_min : -1;
+}
+
+uint32_t TimeService::getMillisToNextSecond() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return 1000 - tv.tv_usec / 1000;
+}
+
+const char* TimeService::getTimezone() {
+    return TIME_TZ_KYIV;
+}
+
+TimeSyncSource TimeService::getSyncSource() {
+    return syncSource;
+}
+
+const char* TimeService::syncSourceToString(TimeSyncSource source) {
+    switch (source) {
+        case TIME_SYNC_RTC: return "RTC (kept across restart)";
+        case TIME_SYNC_HTTP_DATE: return "HTTP Date header";
+        case TIME_SYNC_NTP: return "NTP";
+        default: return "None";
+    }
+}
+
+unsigned long TimeService::getMillisSinceSync() {
+    return lastSyncMillis == 0 ? 0 : millis() - lastSyncMillis;
+}
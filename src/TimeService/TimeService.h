@@ -0,0 +1,105 @@
+#ifndef TIMESERVICE_H
+#define TIMESERVICE_H
+
+#include <Arduino.h>
+#include <time.h>
+
+// Europe/Kyiv: EET (UTC+2), EEST (UTC+3) from the last Sunday of March 03:00
+// to the last Sunday of October 04:00 local time
+#define TIME_TZ_KYIV            "EET-2EEST,M3.5.0/3,M10.5.0/4"
+
+#define TIME_NTP_SERVER_1       "pool.ntp.org"
+#define TIME_NTP_SERVER_2       "time.nist.gov"
+
+// SNTP keeps re-syncing in the background at this interval. A clock seeded
+// from an HTTP Date header (NTP blocked or not answered yet) is re-seeded
+// from responses after the same interval.
+#define TIME_RESYNC_MS          (3UL * 3600UL * 1000UL)
+
+// Anything earlier means the clock was never set (boots at 1970)
+#define TIME_MIN_VALID_YEAR     2020
+
+#define TIME_MAX_SUBSCRIBERS    8
+
+enum TimeEvent {
+    TIME_EVENT_SECOND = 0,  // every new second (also while the clock is not set)
+    TIME_EVENT_MINUTE,      // new local minute, including clock jumps (NTP sync, DST)
+    TIME_EVENT_MIDNIGHT,    // new local day; only between two valid readings
+    TIME_EVENT_SYNCED       // clock set by SNTP or from an HTTP Date header
+};
+
+enum TimeSyncSource {
+    TIME_SYNC_NONE = 0,
+    TIME_SYNC_RTC,          // still running from before a software restart
+    TIME_SYNC_HTTP_DATE,    // seeded from an upstream response
+    TIME_SYNC_NTP
+};
+
+typedef void (*TimeCallback)(const struct tm& now);
+
+// Owns the timezone and the wall clock. The epoch is converted to local
+// time once per second and cached, so callers read a struct tm instead of
+// each running localtime_r with the TZ rules.
+class TimeService {
+public:
+    TimeService();
+
+    // Apply the TZ rule and take the first reading (call before anything reads the time)
+    void begin();
+
+    // Call from loop(); converts and dispatches events when the second changes
+    void update();
+
+    // Register for an event; callbacks run from update() in registration order
+    bool subscribe(TimeEvent event, TimeCallback callback);
+
+    // Start SNTP with the TZ rule; returns at once, TIME_EVENT_SYNCED follows
+    void startSync();
+
+    // Bootstrap from an RFC 7231 Date header ("Sun, 06 Nov 1994 08:49:37 GMT").
+    // Only used while the clock is not set or was itself seeded long ago.
+    bool seedFromHttpDate(const String& date);
+
+    TimeSyncSource getSyncSource();
+    static const char* syncSourceToString(TimeSyncSource source);
+    unsigned long getMillisSinceSync();     // 0 if never synced
+
+    // Cached reading from the last update()
+    bool isValid();
+    time_t now();
+    const struct tm& getLocalTime();
+    int getMinuteOfDay();           // 0..1439, -1 if the clock is not set
+    uint32_t getMillisToNextSecond();   // For waking up right after the second flips
+    const char* getTimezone();
+
+private:
+    struct Subscriber {
+        TimeEvent event;
+        TimeCallback callback;
+    };
+
+    Subscriber subscribers[TIME_MAX_SUBSCRIBERS];
+    uint8_t subscriberCount;
+
+    time_t epoch;
+    struct tm local;
+    bool valid;
+    int lastMinute;     // minute of day at the previous tick, -1 = none
+    int lastYday;       // tm_yday at the previous valid tick, -1 = none
+
+    TimeSyncSource syncSource;
+    unsigned long lastSyncMillis;
+    volatile bool sntpSynced;   // set from the SNTP callback (lwIP task)
+    bool seedPending;           // seeded since the last update()
+
+    // Returns true if the second changed
+    bool refresh();
+    void dispatch(TimeEvent event);
+
+    static void onSntpSync(struct timeval* tv);
+    static bool parseHttpDate(const String& date, time_t& out);
+};
+
+extern TimeService timeService;
+
+#endif // TIMESERVICE_H
@@ -0,0 +1,235 @@
+#include "UpstreamClient.h"
+#include <WiFi.h>
+
+UpstreamClient upstreamClient;
+
+UpstreamClient::UpstreamClient() {
+    hostCount = 0;
+    mutex = xSemaphoreCreateMutex();
+}
+
+UpstreamResult UpstreamClient::get(const String& url, const UpstreamHeader* headers, size_t headerCount) {
+    UpstreamResult result;
+    result.error = UPSTREAM_OK;
+    result.httpCode = 0;
+
+    if (WiFi.status() != WL_CONNECTED) {
+        result.error = UPSTREAM_NO_WIFI;
+        return result;
+    }
+
+    String hostName = hostFromUrl(url);
+
+    // Fail fast while the breaker is open - no DNS, no TCP, no TLS
+    lock();
+    UpstreamHost* host = findHost(hostName);
+    bool allowed = allowRequest(host);
+    if (allowed) {
+        host->requestCount++;
+    } else {
+        host->shortCircuitCount++;
+    }
+    unlock();
+
+    if (!allowed) {
+        result.error = UPSTREAM_CIRCUIT_OPEN;
+        return result;
+    }
+
+    HTTPClient http;
+    http.begin(url);
+    http.setConnectTimeout(UPSTREAM_CONNECT_TIMEOUT_MS);
+    http.setTimeout(UPSTREAM_READ_TIMEOUT_MS);
+    for (size_t i = 0; i < headerCount; i++) {
+        http.addHeader(headers[i].name, headers[i].value);
+    }
+
+    // Lets the time service bootstrap the clock before NTP answers
+    const char* collect[] = {"Date"};
+    http.collectHeaders(collect, 1);
+
+    result.httpCode = http.GET();
+    result.error = classify(result.httpCode);
+
+    // HTTPClient reports a failed lookup as a refused connection; lwIP
+    // answers this from its own DNS cache when the name did resolve
+    IPAddress address;
+    if (result.httpCode == HTTPC_ERROR_CONNECTION_REFUSED && !WiFi.hostByName(hostName.c_str(), address)) {
+        printf("[Upstream] DNS lookup failed for %s\n", hostName.c_str());
+        result.error = UPSTREAM_DNS_FAILED;
+    }
+
+    if (result.error == UPSTREAM_OK) {
+        result.body = http.getString();
+        result.date = http.header("Date");
+    }
+    http.end();
+
+    // 4xx means the host is up and answering - only server/transport errors trip the breaker.
+    // Looked up again: another task may have recycled the slot while this one was unlocked.
+    lock();
+    host = findHost(hostName);
+    if (result.error == UPSTREAM_OK || (result.error == UPSTREAM_HTTP_ERROR && result.httpCode < 500)) {
+        recordSuccess(host);
+    } else {
+        recordFailure(host);
+    }
+    unlock();
+
+    return result;
+}
+
+String UpstreamClient::describe(const UpstreamResult& result) {
+    switch (result.error) {
+        case UPSTREAM_OK:
+            return "";
+        case UPSTREAM_HTTP_ERROR:
+            return "HTTP error " + String(result.httpCode) + ": " + HTTPClient::errorToString(result.httpCode);
+        case UPSTREAM_CONNECT_FAILED:
+        case UPSTREAM_TIMEOUT:
+            return String(errorToString(result.error)) + ": " + HTTPClient::errorToString(result.httpCode);
+        default:
+            return String(errorToString(result.error));
+    }
+}
+
+const char* UpstreamClient::errorToString(UpstreamError error) {
+    switch (error) {
+        case UPSTREAM_OK: return "OK";
+        case UPSTREAM_HTTP_ERROR: return "HTTP error";
+        case UPSTREAM_CONNECT_FAILED: return "Connection failed";
+        case UPSTREAM_TIMEOUT: return "Timeout";
+        case UPSTREAM_DNS_FAILED: return "DNS lookup failed";
+        case UPSTREAM_NO_WIFI: return "WiFi not connected";
+        case UPSTREAM_CIRCUIT_OPEN: return "Circuit open (host unreachable, skipped)";
+        default: return "Unknown";
+    }
+}
+
+const char* UpstreamClient::stateToString(BreakerState state) {
+    switch (state) {
+        case BREAKER_CLOSED: return "Closed";
+        case BREAKER_OPEN: return "Open";
+        case BREAKER_HALF_OPEN: return "Half-open";
+        default: return "Unknown";
+    }
+}
+
+int UpstreamClient::getHostCount() {
+    return hostCount;
+}
+
+const UpstreamHost& UpstreamClient::getHost(int index) {
+    return hosts[index];
+}
+
+UpstreamHost* UpstreamClient::findHost(const String& name) {
+    for (int i = 0; i < hostCount; i++) {
+        if (strcmp(hosts[i].name, name.c_str()) == 0) {
+            return &hosts[i];
+        }
+    }
+
+    // New host - take a free slot, or recycle the least used one
+    int slot = hostCount;
+    if (hostCount < UPSTREAM_MAX_HOSTS) {
+        hostCount++;
+    } else {
+        slot = 0;
+        for (int i = 1; i < hostCount; i++) {
+            if (hosts[i].requestCount < hosts[slot].requestCount) {
+                slot = i;
+            }
+        }
+    }
+
+    UpstreamHost* host = &hosts[slot];
+    *host = UpstreamHost();
+    strncpy(host->name, name.c_str(), sizeof(host->name) - 1);
+    host->state = BREAKER_CLOSED;
+    host->openDuration = UPSTREAM_OPEN_MIN_MS;
+    return host;
+}
+
+bool UpstreamClient::allowRequest(UpstreamHost* host) {
+    switch (host->state) {
+        case BREAKER_CLOSED:
+            return true;
+        case BREAKER_OPEN:
+            if (millis() - host->openedAt >= host->openDuration) {
+                // Cool-down over - let a single probe through
+                printf("[Upstream] %s: breaker half-open, probing\n", host->name);
+                host->state = BREAKER_HALF_OPEN;
+                return true;
+            }
+            return false;
+        case BREAKER_HALF_OPEN:
+            // A probe is already in flight
+            return false;
+    }
+    return false;
+}
+
+void UpstreamClient::recordSuccess(UpstreamHost* host) {
+    if (host->state != BREAKER_CLOSED) {
+        printf("[Upstream] %s: probe succeeded, breaker closed\n", host->name);
+    }
+    host->state = BREAKER_CLOSED;
+    host->consecutiveFailures = 0;
+    host->openDuration = UPSTREAM_OPEN_MIN_MS;
+}
+
+void UpstreamClient::recordFailure(UpstreamHost* host) {
+    host->failureCount++;
+    if (host->consecutiveFailures < 255) {
+        host->consecutiveFailures++;
+    }
+
+    if (host->state == BREAKER_HALF_OPEN) {
+        // Probe failed - reopen with a longer cool-down
+        host->openDuration *= 2;
+        if (host->openDuration > UPSTREAM_OPEN_MAX_MS) {
+            host->openDuration = UPSTREAM_OPEN_MAX_MS;
+        }
+        host->state = BREAKER_OPEN;
+        host->openedAt = millis();
+        printf("[Upstream] %s: probe failed, breaker open for %lu ms\n", host->name, host->openDuration);
+    } else if (host->state == BREAKER_CLOSED && host->consecutiveFailures >= UPSTREAM_FAILURE_THRESHOLD) {
+        host->state = BREAKER_OPEN;
+        host->openedAt = millis();
+        printf("[Upstream] %s: %d failures, breaker open for %lu ms\n", host->name,
+               host->consecutiveFailures, host->openDuration);
+    }
+}
+
+void UpstreamClient::lock() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+}
+
+void UpstreamClient::unlock() {
+    xSemaphoreGive(mutex);
+}
+
+String UpstreamClient::hostFromUrl(const String& url) {
+    int start = url.indexOf("://");
+    start = (start < 0) ? 0 : start + 3;
+
+    int end = start;
+    while (end < (int)url.length() && url[end] != '/' && url[end] != ':' && url[end] != '?') {
+        end++;
+    }
+    return url.substring(start, end);
+}
+
+UpstreamError UpstreamClient::classify(int httpCode) {
+    if (httpCode == HTTP_CODE_OK) {
+        return UPSTREAM_OK;
+    }
+    if (httpCode > 0) {
+        return UPSTREAM_HTTP_ERROR;
+    }
+    if (httpCode == HTTPC_ERROR_READ_TIMEOUT) {
+        return UPSTREAM_TIMEOUT;
+    }
+    return UPSTREAM_CONNECT_FAILED;
+}
@@ -0,0 +1,99 @@
+#ifndef UPSTREAMCLIENT_H
+#define UPSTREAMCLIENT_H
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Shared timeouts for all outbound HTTP
+#define UPSTREAM_CONNECT_TIMEOUT_MS 5000
+#define UPSTREAM_READ_TIMEOUT_MS    8000
+
+// Circuit breaker: open after N consecutive failures, probe after a cool-down
+// that doubles on every failed probe
+#define UPSTREAM_MAX_HOSTS          4
+#define UPSTREAM_FAILURE_THRESHOLD  3
+#define UPSTREAM_OPEN_MIN_MS        15000UL
+#define UPSTREAM_OPEN_MAX_MS        300000UL  // 5 minutes
+
+// Uniform error classification for every upstream call
+enum UpstreamError {
+    UPSTREAM_OK = 0,
+    UPSTREAM_HTTP_ERROR,       // Server answered with a non-200 status
+    UPSTREAM_CONNECT_FAILED,   // TCP/TLS connect failed or connection lost
+    UPSTREAM_TIMEOUT,          // Server did not answer in time
+    UPSTREAM_DNS_FAILED,       // Host name could not be resolved
+    UPSTREAM_NO_WIFI,          // Station not connected
+    UPSTREAM_CIRCUIT_OPEN      // Skipped - host breaker is open
+};
+
+enum BreakerState {
+    BREAKER_CLOSED,
+    BREAKER_OPEN,
+    BREAKER_HALF_OPEN
+};
+
+struct UpstreamHeader {
+    const char* name;
+    const char* value;
+};
+
+struct UpstreamResult {
+    UpstreamError error;
+    int httpCode;              // HTTP status, HTTPClient error (<0) or 0 if not sent
+    String body;
+    String date;               // Date response header, empty if not sent
+
+    bool ok() const { return error == UPSTREAM_OK; }
+};
+
+// Per-host breaker entry (guarded by the client mutex)
+struct UpstreamHost {
+    char name[48];
+    BreakerState state;
+    uint8_t consecutiveFailures;
+    unsigned long openedAt;
+    unsigned long openDuration;
+    uint32_t requestCount;
+    uint32_t failureCount;
+    uint32_t shortCircuitCount;    // Calls rejected while open
+};
+
+class UpstreamClient {
+public:
+    UpstreamClient();
+
+    // Perform a GET request through the host's circuit breaker.
+    // Safe to call from several tasks at once (hedged alert fetches).
+    UpstreamResult get(const String& url, const UpstreamHeader* headers = nullptr, size_t headerCount = 0);
+
+    // Human readable error for debug pages
+    String describe(const UpstreamResult& result);
+    static const char* errorToString(UpstreamError error);
+    static const char* stateToString(BreakerState state);
+
+    // Host table for the status page
+    int getHostCount();
+    const UpstreamHost& getHost(int index);
+
+private:
+    UpstreamHost hosts[UPSTREAM_MAX_HOSTS];
+    int hostCount;
+    SemaphoreHandle_t mutex;
+
+    void lock();
+    void unlock();
+
+    UpstreamHost* findHost(const String& name);
+    bool allowRequest(UpstreamHost* host);
+    void recordSuccess(UpstreamHost* host);
+    void recordFailure(UpstreamHost* host);
+
+    static String hostFromUrl(const String& url);
+    static UpstreamError classify(int httpCode);
+};
+
+extern UpstreamClient upstreamClient;
+
+#endif // UPSTREAMCLIENT_H
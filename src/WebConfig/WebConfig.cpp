@@ -2,13 +2,47 @@
 #include "../AlertLight_UI/AlertLight_UI.h"
 #include "../LightManager/LightManager.h"
 #include "../RGBManager/RGBManager.h"
+#include "../RGB_Lamp/RGB_lamp.h"
+#include "../Upstream/UpstreamClient.h"
+#include "../TimeService/TimeService.h"
+#include "../LoopScheduler/LoopScheduler.h"
+#include "../StateStore/StateStore.h"
+#include "../WiFiScan/WiFiScan.h"
 #include <time.h>
 
 WebConfigManager webConfig;
 
+static void onTimeSynced(const struct tm& now) {
+    webConfig.logTimeSynced(now);
+}
+
+static void onNetworkConfigChanged(uint64_t changed) {
+    webConfig.onConfigChanged(changed);
+}
+
+static void onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    webConfig.handleWiFiEvent(event, info);
+}
+
+// pendingEvents bits
+#define WIFI_EVENT_GOT_IP       0x01
+#define WIFI_EVENT_DISCONNECTED 0x02
+#define WIFI_EVENT_LOST_IP      0x04
+
+// Fields that need the station link rebuilt
+#define WEB_NETWORK_FIELDS  (CFG_BIT(CFG_WIFI_SSID) | CFG_BIT(CFG_WIFI_PASSWORD) | CFG_BIT(CFG_USE_STATIC_IP) | \
+                             CFG_BIT(CFG_STATIC_IP) | CFG_BIT(CFG_STATIC_GATEWAY) | CFG_BIT(CFG_STATIC_SUBNET))
+
 WebConfigManager::WebConfigManager() : server(8080), apMode(false), wifiConnected(false),
-    lastWiFiCheck(0), wifiCheckInterval(5000), lastScanAttempt(0), scanRetryInterval(60000) {
+    lastScanAttempt(0), networkChangePending(false), portChangePending(false),
+    linkState(WIFI_LINK_OFF), stateSince(0), attemptDeadline(0), retryAt(0), retryDelayMs(WIFI_RETRY_MIN_MS),
+    downSince(0), attemptStarted(0), attemptFast(false), timeSyncStarted(false), candidateCount(0),
+    candidateIndex(0), scanGeneration(0), pendingEvents(0), lastDisconnectReason(0),
+    leaveExpected(false), leaseBorrowed(false), leaseRenewPending(false), linkUpAt(0), lastConnectMs(0),
+    lastConnectFast(false) {
     statusLog = "";
+    memset(&linkCache, 0, sizeof(linkCache));
+    memset(&savedLinkCache, 0, sizeof(savedLinkCache));
 }
 
 void WebConfigManager::begin() {
@@ -18,22 +52,39 @@ void WebConfigManager::begin() {
     apSSID = "AlertLight-" + String(mac[4], HEX) + String(mac[5], HEX);
     apSSID.toUpperCase();
 
-    // Try to connect to saved WiFi
-    AlertLightConfig& cfg = configManager.getConfig();
+    timeService.subscribe(TIME_EVENT_SYNCED, onTimeSynced);
+    configManager.subscribe(WEB_NETWORK_FIELDS | CFG_BIT(CFG_WEB_PORT), onNetworkConfigChanged);
+
+    // Access points and lease from the last good connection
+    uint32_t savedAt = 0;
+    if (stateStore.load("wifi", &linkCache, sizeof(linkCache), savedAt) && linkCache.version == WIFI_CACHE_VERSION) {
+        linkCache.ssid[sizeof(linkCache.ssid) - 1] = '\0';
+        if (linkCache.apCount > WIFI_CACHE_APS) {
+            linkCache.apCount = 0;
+        }
+        savedLinkCache = linkCache;
+    } else {
+        memset(&linkCache, 0, sizeof(linkCache));
+    }
 
     addLog("System started");
 
+    // The station is driven by checkWiFiStatus(); nothing here waits for it
+    WiFi.onEvent(onWiFiEvent);
+    WiFi.persistent(false);  // Avoid flash wear
+    WiFi.setAutoReconnect(false);  // Reconnects are ours, with the cached access point first
+    WiFi.mode(WIFI_STA);
+
+    // CRITICAL: Configure WiFi for maximum reliability
+    WiFi.setSleep(false);  // Disable sleep mode for better scanning
+    WiFi.setTxPower(WIFI_POWER_19_5dBm);  // Maximum transmit power
+    esp_wifi_set_ps(WIFI_PS_NONE);  // Disable power saving
+
+    AlertLightConfig& cfg = configManager.getConfig();
+    downSince = millis();
     if (strlen(cfg.wifi_ssid) > 0) {
         addLog("Trying to connect to WiFi: " + String(cfg.wifi_ssid));
-        if (connectToWiFi(15000)) {
-            wifiConnected = true;
-            apMode = false;
-            addLog("Connected! IP: " + WiFi.localIP().toString());
-            syncNTPTime();  // Synchronize time with NTP server
-        } else {
-            addLog("Failed to connect, starting AP mode");
-            startAPMode();
-        }
+        startConnect();
     } else {
         addLog("No WiFi credentials, starting AP mode");
         startAPMode();
@@ -51,6 +102,9 @@ void WebConfigManager::begin() {
     server.on("/save_light", [this]() { this->handleSaveLight(); });
     server.on("/save_rgb", [this]() { this->handleSaveRGB(); });
     server.on("/restart", [this]() { this->handleRestart(); });
+    server.on("/backup", [this]() { this->handleBackup(); });
+    server.on("/api/config", [this]() { this->handleExportConfig(); });
+    server.on("/import_config", [this]() { this->handleImportConfig(); });
     server.on("/scan", [this]() { this->handleScan(); });
     server.on("/test_alert", [this]() { this->handleTestAlert(); });
     server.on("/api/test_light", [this]() { this->handleTestLight(); });
@@ -62,7 +116,7 @@ void WebConfigManager::begin() {
     server.on("/api/yasno/group", [this]() { this->handleYasnoGroup(); });
     server.onNotFound([this]() { this->handleNotFound(); });
 
-    server.begin();
+    server.begin(cfg.web_port);
     printf("Web server started on port %d\n", cfg.web_port);
 }
 
@@ -72,205 +126,459 @@ void WebConfigManager::handleClient() {
     }
     server.handleClient();
 
-    // Check WiFi status periodically
-    unsigned long now = millis();
-    if (now - lastWiFiCheck >= wifiCheckInterval) {
-        lastWiFiCheck = now;
-        checkWiFiStatus();
+    // After the handler that saved them has sent its page
+    if (networkChangePending || portChangePending) {
+        applyPendingChanges();
+    }
+}
+
+void WebConfigManager::onConfigChanged(uint64_t changed) {
+    if (changed & WEB_NETWORK_FIELDS) {
+        networkChangePending = true;
+    }
+    if (changed & CFG_BIT(CFG_WEB_PORT)) {
+        portChangePending = true;
     }
 }
 
+void WebConfigManager::applyPendingChanges() {
+    AlertLightConfig& cfg = configManager.getConfig();
+
+    if (portChangePending) {
+        portChangePending = false;
+        server.stop();
+        server.begin(cfg.web_port);
+        addLog("Web server moved to port " + String(cfg.web_port));
+    }
+
+    if (!networkChangePending) {
+        return;
+    }
+    networkChangePending = false;
+
+    // Whatever the link is doing, start over with the new settings. A new
+    // SSID has no cached access point and scans; a new password or IP
+    // setup goes straight back to the known one.
+    disconnectStation();
+    wifiConnected = false;
+    leaseBorrowed = false;
+    leaseRenewPending = false;
+    attemptStarted = 0;
+    retryDelayMs = WIFI_RETRY_MIN_MS;
+    downSince = millis();
+
+    if (strlen(cfg.wifi_ssid) == 0) {
+        addLog("WiFi credentials cleared");
+        setLinkState(WIFI_LINK_OFF);  // checkWiFiStatus() brings the AP up
+        return;
+    }
+    addLog("WiFi settings changed, connecting to " + String(cfg.wifi_ssid));
+    startConnect();
+}
+
 bool WebConfigManager::isConnected() {
     return wifiConnected && WiFi.status() == WL_CONNECTED;
 }
 
 String WebConfigManager::getIPAddress() {
-    if (apMode) {
-        return WiFi.softAPIP().toString();
-    } else {
+    if (isConnected() || !apMode) {
         return WiFi.localIP().toString();
     }
+    return WiFi.softAPIP().toString();
 }
 
 String WebConfigManager::getSSID() {
-    if (apMode) {
-        return apSSID;
-    } else {
+    if (isConnected() || !apMode) {
         return WiFi.SSID();
     }
+    return apSSID;
 }
 
 void WebConfigManager::startAPMode() {
-    WiFi.mode(WIFI_AP);
+    // AP next to the station: the portal stays reachable while the station
+    // keeps trying in the background
+    WiFi.mode(WIFI_AP_STA);
     WiFi.softAP(apSSID.c_str());
 
     // Start DNS server for captive portal
     dnsServer.start(53, "*", WiFi.softAPIP());
 
     apMode = true;
-    wifiConnected = false;
 
     printf("AP Mode started\n");
     printf("SSID: %s\n", apSSID.c_str());
     printf("IP: %s\n", WiFi.softAPIP().toString().c_str());
 }
 
-bool WebConfigManager::connectToWiFi(unsigned long timeout_ms) {
-    AlertLightConfig& cfg = configManager.getConfig();
+void WebConfigManager::stopAPMode() {
+    dnsServer.stop();
+    WiFi.softAPdisconnect(true);  // Back to station only
+    apMode = false;
+    addLog("Setup AP stopped");
+}
 
-    // Disconnect and clean up first
-    WiFi.disconnect(true);
-    delay(100);
-    WiFi.mode(WIFI_STA);
-    WiFi.setAutoReconnect(true);
-    WiFi.persistent(false);  // Avoid flash wear
+void WebConfigManager::disconnectStation() {
+    // Set before the call: the event can beat WiFi.disconnect() back. Without
+    // an association there is no event and the flag is dropped on GOT_IP.
+    __atomic_store_n(&leaveExpected, true, __ATOMIC_RELEASE);
+    WiFi.disconnect();
+}
 
-    // CRITICAL: Configure WiFi for maximum reliability
-    WiFi.setSleep(false);  // Disable sleep mode for better scanning
-    WiFi.setTxPower(WIFI_POWER_19_5dBm);  // Maximum transmit power
-    esp_wifi_set_ps(WIFI_PS_NONE);  // Disable power saving
+void WebConfigManager::handleWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    // WiFi event task: record only, checkWiFiStatus() acts on it from the loop
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            __atomic_store_n(&leaveExpected, false, __ATOMIC_RELAXED);
+            __atomic_fetch_or(&pendingEvents, WIFI_EVENT_GOT_IP, __ATOMIC_RELEASE);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+            // Only the leave our own disconnect() caused is not a failure;
+            // an ASSOC_LEAVE nobody asked for takes the link down
+            if (info.wifi_sta_disconnected.reason == WIFI_REASON_ASSOC_LEAVE &&
+                __atomic_exchange_n(&leaveExpected, false, __ATOMIC_ACQ_REL)) {
+                break;
+            }
+            __atomic_store_n(&lastDisconnectReason, info.wifi_sta_disconnected.reason, __ATOMIC_RELAXED);
+            __atomic_fetch_or(&pendingEvents, WIFI_EVENT_DISCONNECTED, __ATOMIC_RELEASE);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            __atomic_fetch_or(&pendingEvents, WIFI_EVENT_LOST_IP, __ATOMIC_RELEASE);
+            break;
+        default:
+            break;
+    }
+}
 
-    // Configure static IP if enabled, otherwise use DHCP
-    if (cfg.use_static_ip) {
-        IPAddress ip, gateway, subnet;
-        ip.fromString(cfg.static_ip);
-        gateway.fromString(cfg.static_gateway);
-        subnet.fromString(cfg.static_subnet);
-        WiFi.config(ip, gateway, subnet);
-        addLog("Using static IP: " + String(cfg.static_ip));
-    } else {
-        // Reset to DHCP
-        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
-        addLog("Using DHCP");
+WiFiLinkState WebConfigManager::getLinkState() {
+    return linkState;
+}
+
+const char* WebConfigManager::linkStateToString(WiFiLinkState state) {
+    switch (state) {
+        case WIFI_LINK_OFF: return "Off";
+        case WIFI_LINK_SCANNING: return "Scanning";
+        case WIFI_LINK_JOINING: return "Joining";
+        case WIFI_LINK_UP: return "Connected";
+        case WIFI_LINK_WAITING: return "Waiting to retry";
+        default: return "Unknown";
     }
+}
 
-    // Scan for networks to verify SSID is available
-    addLog("Scanning for networks...");
-    delay(300);  // Give time to see the message
+void WebConfigManager::setLinkState(WiFiLinkState state) {
+    linkState = state;
+    stateSince = millis();
+    // A scan would knock the station off the channel it is associating on
+    wifiScan.setPaused(state == WIFI_LINK_JOINING);
+}
+
+void WebConfigManager::startConnect() {
+    AlertLightConfig& cfg = configManager.getConfig();
+
+    if (strlen(cfg.wifi_ssid) == 0) {
+        setLinkState(WIFI_LINK_OFF);
+        return;
+    }
+    if (attemptStarted == 0) {
+        attemptStarted = millis();
+    }
+
+    // Fast path: straight to the access point we were last on, without a scan
+    if (linkCache.apCount > 0 && strcmp(linkCache.ssid, cfg.wifi_ssid) == 0) {
+        candidates[0] = linkCache.aps[0];
+        candidateCount = 1;
+        candidateIndex = 0;
+        addLog("Reconnecting to last access point (channel " + String(candidates[0].channel) + ")");
+        joinCandidate(true);
+        return;
+    }
+    startScan();
+}
+
+void WebConfigManager::startScan() {
+    disconnectStation();
 
     // Extended scan time for environments with many networks (52+)
     // 2000ms per channel ensures thorough discovery of all networks
-    // IMPORTANT: show_hidden=true to find hidden SSIDs
-    int networks = WiFi.scanNetworks(false, true, false, 2000); // async=false, show_hidden=true, passive=false, max_ms_per_chan=2000
-
+    // (hidden SSIDs included). Runs in the scan service: the web server
+    // and the setup AP stay up meanwhile.
+    wifiScan.setTarget(configManager.getConfig().wifi_ssid);
+    wifiScan.request(2000, false);
+    scanGeneration = wifiScan.getGeneration();
     lastScanAttempt = millis();
+    addLog("Scanning for networks...");
+    setLinkState(WIFI_LINK_SCANNING);
+}
 
-    if (networks < 0) {
-        addLog("Scan failed!");
-        delay(500);
-        return false;
+void WebConfigManager::collectAccessPoints() {
+    AlertLightConfig& cfg = configManager.getConfig();
+
+    // Every access point broadcasting our SSID, strongest first. The scan
+    // service ranks them over all results, not just the ones it keeps.
+    candidateCount = 0;
+    candidateIndex = 0;
+    while (candidateCount < wifiScan.getTargetCount() && candidateCount < WIFI_CACHE_APS) {
+        const WiFiScanEntry& entry = wifiScan.getTarget(candidateCount);
+        WiFiAccessPoint& ap = candidates[candidateCount++];
+        memcpy(ap.bssid, entry.bssid, sizeof(ap.bssid));
+        ap.channel = entry.channel;
+        ap.rssi = entry.rssi;
     }
 
     char buf[64];
-    snprintf(buf, sizeof(buf), "Found %d networks", networks);
+    snprintf(buf, sizeof(buf), "Found %u networks", wifiScan.getCount());
     addLog(buf);
-    delay(1500);  // Give time to see the result
+    if (candidateCount == 0) {
+        snprintf(buf, sizeof(buf), "SSID '%s' not found in scan (may be hidden network)", cfg.wifi_ssid);
+        addLog(buf);
+        return;
+    }
 
-    bool ssidFound = false;
-    int8_t targetRSSI = 0;
-    const char* targetEncryption = "";
+    for (uint8_t i = 0; i < candidateCount; i++) {
+        snprintf(buf, sizeof(buf), ">>> Found: %s (channel %u, %d dBm)", cfg.wifi_ssid, candidates[i].channel,
+                 candidates[i].rssi);
+        addLog(buf);
+    }
 
-    // Check ALL networks to ensure we find the target SSID
-    // Previous limit of 50 was causing networks to be missed in dense WiFi environments
-    int maxCheck = networks;
+    // Remember the ranking even if the attempts fail
+    if (strcmp(linkCache.ssid, cfg.wifi_ssid) != 0) {
+        memset(&linkCache, 0, sizeof(linkCache));  // Lease of another network
+        linkCache.version = WIFI_CACHE_VERSION;
+        strncpy(linkCache.ssid, cfg.wifi_ssid, sizeof(linkCache.ssid) - 1);
+    }
+    memcpy(linkCache.aps, candidates, candidateCount * sizeof(WiFiAccessPoint));
+    linkCache.apCount = candidateCount;
+}
 
-    addLog("Checking networks...");
-    delay(300);
+void WebConfigManager::joinCandidate(bool fast) {
+    AlertLightConfig& cfg = configManager.getConfig();
 
-    for (int i = 0; i < maxCheck; i++) {
-        String ssid = WiFi.SSID(i);
-        int8_t rssi = WiFi.RSSI(i);
+    disconnectStation();
+    applyIPConfig(fast);
+    __atomic_store_n(&pendingEvents, 0, __ATOMIC_RELAXED);
 
-        // Log first 5 networks for debugging
-        if (i < 5 && ssid.length() > 0) {
-            snprintf(buf, sizeof(buf), "  %s (%d dBm)", ssid.c_str(), rssi);
-            addLog(buf);
-            delay(200);  // Delay between each network for visibility
-        }
+    unsigned long budget = WIFI_JOIN_TIMEOUT_MS;
+    if (fast) {
+        budget = WIFI_FAST_CONNECT_MS;
+    } else if (candidateIndex + 1 < candidateCount) {
+        budget = WIFI_AP_CONNECT_MS;  // Others are left to try
+    }
 
-        // Check if this is our target SSID
-        if (ssid == String(cfg.wifi_ssid)) {
-            ssidFound = true;
-            targetRSSI = rssi;
-
-            switch (WiFi.encryptionType(i)) {
-                case WIFI_AUTH_OPEN: targetEncryption = "OPEN"; break;
-                case WIFI_AUTH_WEP: targetEncryption = "WEP"; break;
-                case WIFI_AUTH_WPA_PSK: targetEncryption = "WPA"; break;
-                case WIFI_AUTH_WPA2_PSK: targetEncryption = "WPA2"; break;
-                case WIFI_AUTH_WPA_WPA2_PSK: targetEncryption = "WPA/WPA2"; break;
-                case WIFI_AUTH_WPA2_ENTERPRISE: targetEncryption = "WPA2-Enterprise"; break;
-                default: targetEncryption = "Unknown"; break;
-            }
+    addLog("Connecting to: " + String(cfg.wifi_ssid));
+    if (candidateIndex < candidateCount) {
+        const WiFiAccessPoint& ap = candidates[candidateIndex];
+        WiFi.begin(cfg.wifi_ssid, cfg.wifi_password, ap.channel, ap.bssid);
+    } else {
+        // Hidden networks won't appear in scan but WiFi.begin() can still connect to them
+        WiFi.begin(cfg.wifi_ssid, cfg.wifi_password);
+    }
+    attemptFast = fast;
+    attemptDeadline = millis() + budget;
+    setLinkState(WIFI_LINK_JOINING);
+}
+
+void WebConfigManager::attemptFailed(const char* why) {
+    addLog("WiFi connection failed - " + String(why));
+    leaseBorrowed = false;
 
-            snprintf(buf, sizeof(buf), ">>> Found: %s (%s, %d dBm)", cfg.wifi_ssid, targetEncryption, targetRSSI);
-            addLog(buf);
-            delay(500);
-            break; // Found it, stop searching
+    if (attemptFast) {
+        // Cached access point gone (router rebooting, channel changed):
+        // look around, unless that was done a moment ago
+        if (lastScanAttempt == 0 || millis() - lastScanAttempt >= WIFI_RESCAN_MS) {
+            startScan();
+        } else {
+            scheduleRetry();
         }
+        return;
     }
 
-    WiFi.scanDelete();
+    candidateIndex++;
+    if (candidateIndex < candidateCount) {
+        joinCandidate(false);
+        return;
+    }
+    scheduleRetry();
+}
 
-    if (!ssidFound) {
-        snprintf(buf, sizeof(buf), "SSID '%s' not found in scan (may be hidden network)", cfg.wifi_ssid, maxCheck);
-        addLog(buf);
-        addLog("Attempting connection anyway...");
-        // Don't return false here - hidden networks won't appear in scan
-        // but WiFi.begin() can still connect to them
+void WebConfigManager::scheduleRetry() {
+    disconnectStation();
+    retryAt = millis() + retryDelayMs;
+
+    char buf[48];
+    snprintf(buf, sizeof(buf), "Retrying in %lu s", (retryDelayMs + 999) / 1000);
+    addLog(buf);
+
+    retryDelayMs = retryDelayMs * 2 > WIFI_RETRY_MAX_MS ? WIFI_RETRY_MAX_MS : retryDelayMs * 2;
+    setLinkState(WIFI_LINK_WAITING);
+}
+
+void WebConfigManager::linkUp() {
+    lastConnectMs = millis() - attemptStarted;
+    lastConnectFast = attemptFast;
+    linkUpAt = millis();
+    attemptStarted = 0;
+    retryDelayMs = WIFI_RETRY_MIN_MS;
+    wifiConnected = true;
+    setLinkState(WIFI_LINK_UP);
+
+    addLog("WiFi connected - IP: " + WiFi.localIP().toString() + (leaseBorrowed ? " (cached lease)" : ""));
+    addLog("Gateway: " + WiFi.gatewayIP().toString());
+    addLog("DNS: " + WiFi.dnsIP().toString());
+    addLog("RSSI: " + String(WiFi.RSSI()) + " dBm");
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "Link up in %lu ms (%s)", lastConnectMs,
+             lastConnectFast ? "cached access point" : "after scan");
+    addLog(buf);
+
+    rememberLink();
+
+    if (!timeSyncStarted) {
+        timeSyncStarted = true;
+        syncNTPTime();  // Synchronize time with NTP server
     }
+}
 
-    addLog("Connecting to: " + String(cfg.wifi_ssid));
-    WiFi.begin(cfg.wifi_ssid, cfg.wifi_password);
+void WebConfigManager::linkDown(const char* why) {
+    wifiConnected = false;
+    leaseBorrowed = false;
+    leaseRenewPending = false;
+    downSince = millis();
+    addLog("WiFi connection lost - " + String(why));
+
+    // Most drops are short (router reboot, roaming): the cached access
+    // point straight away, the back-off only after that fails
+    startConnect();
+}
+
+void WebConfigManager::checkWiFiStatus() {
+    uint8_t events = __atomic_exchange_n(&pendingEvents, 0, __ATOMIC_ACQUIRE);
+    unsigned long now = millis();
+
+    switch (linkState) {
+        case WIFI_LINK_OFF:
+            break;
+
+        case WIFI_LINK_SCANNING:
+            if (wifiScan.getGeneration() == scanGeneration) {
+                break;  // Still running (the service times it out)
+            }
+            if (!wifiScan.lastScanOk()) {
+                addLog("Scan failed!");
+                scheduleRetry();
+                break;
+            }
+            collectAccessPoints();
+            joinCandidate(false);
+            break;
+
+        case WIFI_LINK_JOINING:
+            if ((events & WIFI_EVENT_GOT_IP) || (WiFi.status() == WL_CONNECTED && WiFi.localIP() != INADDR_NONE)) {
+                linkUp();
+            } else if (events & WIFI_EVENT_DISCONNECTED) {
+                char why[32];
+                snprintf(why, sizeof(why), "reason %u", __atomic_load_n(&lastDisconnectReason, __ATOMIC_RELAXED));
+                attemptFailed(why);
+            } else if ((long)(now - attemptDeadline) >= 0) {
+                attemptFailed(WiFi.status() == WL_CONNECTED ? "no IP address (DHCP failed)" : "timeout");
+            }
+            break;
+
+        case WIFI_LINK_UP:
+            if (events & WIFI_EVENT_DISCONNECTED) {
+                char why[32];
+                snprintf(why, sizeof(why), "reason %u", __atomic_load_n(&lastDisconnectReason, __ATOMIC_RELAXED));
+                linkDown(why);
+                break;
+            }
+            if ((events & WIFI_EVENT_LOST_IP) && !leaseRenewPending) {
+                linkDown("IP address lost");  // Expected while a reused lease is handed back
+                break;
+            }
+            if (!leaseRenewPending && WiFi.status() != WL_CONNECTED) {
+                linkDown("station not connected");  // Missed or swallowed event
+                break;
+            }
+            if (leaseBorrowed && now - linkUpAt >= WIFI_LEASE_HANDBACK_MS) {
+                // Confirm (or replace) the reused address with the DHCP server
+                addLog("Renewing reused lease via DHCP");
+                WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+                leaseBorrowed = false;
+                leaseRenewPending = true;
+            } else if (leaseRenewPending && (events & WIFI_EVENT_GOT_IP)) {
+                leaseRenewPending = false;
+                rememberLink();
+            }
+            // Setup AP no longer needed once its last client has left
+            if (apMode && WiFi.softAPgetStationNum() == 0) {
+                stopAPMode();
+            }
+            break;
 
-    unsigned long start = millis();
-    wl_status_t status;
+        case WIFI_LINK_WAITING:
+            if ((long)(now - retryAt) >= 0) {
+                startConnect();
+            }
+            break;
+    }
 
-    // Wait for connection
-    while ((status = WiFi.status()) != WL_CONNECTED && millis() - start < timeout_ms) {
-        delay(500);
-        printf(".");
+    // Setup AP next to the retrying station: no credentials, or down too long
+    if (!apMode && linkState != WIFI_LINK_UP &&
+        (linkState == WIFI_LINK_OFF || now - downSince >= WIFI_AP_FALLBACK_MS)) {
+        addLog(linkState == WIFI_LINK_OFF ? "No WiFi credentials, starting AP mode"
+                                          : "WiFi still down, starting AP mode");
+        startAPMode();
     }
-    printf("\n");
+}
 
-    if (status == WL_CONNECTED) {
-        // Wait for IP address (important for DHCP)
-        unsigned long ipWaitStart = millis();
-        while (WiFi.localIP().toString() == "0.0.0.0" && millis() - ipWaitStart < 5000) {
-            delay(100);
-            printf("*");
-        }
-        printf("\n");
-
-        IPAddress ip = WiFi.localIP();
-        if (ip.toString() != "0.0.0.0") {
-            addLog("WiFi connected - IP: " + ip.toString());
-            addLog("Gateway: " + WiFi.gatewayIP().toString());
-            addLog("DNS: " + WiFi.dnsIP().toString());
-            addLog("RSSI: " + String(WiFi.RSSI()) + " dBm");
-            return true;
-        } else {
-            addLog("WiFi connected but no IP address (DHCP failed)");
-            WiFi.disconnect(true);
-            return false;
-        }
+void WebConfigManager::rememberLink() {
+    AlertLightConfig& cfg = configManager.getConfig();
+
+    if (strcmp(linkCache.ssid, cfg.wifi_ssid) != 0) {
+        memset(&linkCache, 0, sizeof(linkCache));
+        strncpy(linkCache.ssid, cfg.wifi_ssid, sizeof(linkCache.ssid) - 1);
+    }
+    linkCache.version = WIFI_CACHE_VERSION;
+
+    // The access point we are on moves to the front, keeping its scan RSSI
+    WiFiAccessPoint current;
+    memcpy(current.bssid, WiFi.BSSID(), sizeof(current.bssid));
+    current.channel = WiFi.channel();
+    current.rssi = WiFi.RSSI();
+    uint8_t at = 0;
+    while (at < linkCache.apCount && memcmp(linkCache.aps[at].bssid, current.bssid, sizeof(current.bssid)) != 0) {
+        at++;
+    }
+    if (at < linkCache.apCount) {
+        current.rssi = linkCache.aps[at].rssi;
+    } else if (linkCache.apCount < WIFI_CACHE_APS) {
+        linkCache.apCount++;
     } else {
-        String statusMsg = "Status: " + String(status);
-        switch (status) {
-            case WL_NO_SSID_AVAIL: statusMsg += " (SSID not found)"; break;
-            case WL_CONNECT_FAILED: statusMsg += " (Connection failed)"; break;
-            case WL_CONNECTION_LOST: statusMsg += " (Connection lost)"; break;
-            case WL_DISCONNECTED: statusMsg += " (Disconnected)"; break;
-            default: break;
-        }
-        addLog("WiFi connection failed - " + statusMsg);
+        at = WIFI_CACHE_APS - 1;
+    }
+    memmove(&linkCache.aps[1], &linkCache.aps[0], at * sizeof(WiFiAccessPoint));
+    linkCache.aps[0] = current;
+
+    // A lease we got from DHCP ourselves (not a borrowed or static one)
+    if (!cfg.use_static_ip && !leaseBorrowed) {
+        linkCache.ip = WiFi.localIP();
+        linkCache.gateway = WiFi.gatewayIP();
+        linkCache.subnet = WiFi.subnetMask();
+        linkCache.dns = WiFi.dnsIP();
+        linkCache.leaseTime = timeService.isValid() ? (uint32_t)timeService.now() : 0;
+    }
 
-        // Clean up - disconnect to ensure WiFi is in known state
-        WiFi.disconnect(true);
-        delay(100);
+    if (memcmp(&linkCache, &savedLinkCache, sizeof(linkCache)) != 0 &&
+        stateStore.save("wifi", &linkCache, sizeof(linkCache))) {
+        savedLinkCache = linkCache;
+    }
+}
 
-        return false;
+bool WebConfigManager::leaseUsable() {
+    if (linkCache.ip == 0 || linkCache.leaseTime == 0 || !timeService.isValid()) {
+        return false;  // No lease, or no clock to tell its age
     }
+    uint32_t now = (uint32_t)timeService.now();
+    return now >= linkCache.leaseTime && now - linkCache.leaseTime < WIFI_LEASE_REUSE_S;
 }
 
 // HTML Helper Functions
@@ -326,6 +634,7 @@ String WebConfigManager::generateNavigation() {
     nav += "<a href='/rgb'>RGB LED</a>";
     nav += "<a href='/ntp'>Time/NTP</a>";
     nav += "<a href='/status'>Status</a>";
+    nav += "<a href='/backup'>Backup</a>";
     nav += "<a href='/restart'>Restart</a>";
     nav += "</div>";
     return nav;
@@ -351,10 +660,10 @@ void WebConfigManager::handleRoot() {
     String html = generateHeader("Home");
     html += "<h2>Status</h2>";
     html += "<div class='status'>";
-    html += "<p><strong>WiFi Mode:</strong> " + String(apMode ? "Access Point" : "Station") + "</p>";
+    html += "<p><strong>WiFi Mode:</strong> " + String(apMode ? "Access Point + Station" : "Station") + "</p>";
     html += "<p><strong>SSID:</strong> " + getSSID() + "</p>";
     html += "<p><strong>IP Address:</strong> " + getIPAddress() + "</p>";
-    html += "<p><strong>Connection:</strong> " + String(isConnected() ? "Connected" : "Not Connected") + "</p>";
+    html += "<p><strong>Connection:</strong> " + String(linkStateToString(linkState)) + "</p>";
     html += "</div>";
 
     html += "<h2>Quick Settings</h2>";
@@ -375,7 +684,7 @@ void WebConfigManager::handleWiFiConfig() {
     // Add network scanner section
     html += "<h2>Available Networks</h2>";
     html += "<div class='form-group'>";
-    html += "<button type='button' onclick='scanNetworks()' id='scanBtn'>Scan for Networks</button>";
+    html += "<button type='button' onclick='scanNetworks(true)' id='scanBtn'>Scan for Networks</button>";
     html += "<div id='scanStatus' style='margin-top: 10px; color: #00aaff;'></div>";
     html += "</div>";
     html += "<div id='networkList' style='max-height: 300px; overflow-y: auto; margin-bottom: 20px;'></div>";
@@ -431,15 +740,13 @@ void WebConfigManager::handleWiFiConfig() {
     html += "  document.getElementById('ssid').value = ssid;";
     html += "  document.getElementById('ssid').focus();";
     html += "}";
-    html += "function scanNetworks() {";
+    html += "function scanNetworks(refresh) {";
     html += "  const btn = document.getElementById('scanBtn');";
     html += "  const status = document.getElementById('scanStatus');";
     html += "  const list = document.getElementById('networkList');";
     html += "  btn.disabled = true;";
-    html += "  status.textContent = 'Scanning for networks (this may take 20-30 seconds)...';";
-    html += "  list.innerHTML = '';";
-    html += "  fetch('/scan').then(r => r.json()).then(data => {";
-    html += "    status.textContent = 'Found ' + data.count + ' networks';";
+    html += "  fetch('/scan' + (refresh ? '?refresh=1' : '')).then(r => r.json()).then(data => {";
+    html += "    let text = data.age_ms >= 0 ? 'Found ' + data.count + ' networks (' + Math.round(data.age_ms / 1000) + ' s ago)' : 'No scan results yet';";
     html += "    if (data.networks && data.networks.length > 0) {";
     html += "      let html = '<div style=\"background:#2a2a2a; border-radius:5px;\">';";
     html += "      data.networks.forEach(net => {";
@@ -456,13 +763,20 @@ void WebConfigManager::handleWiFiConfig() {
     html += "      html += '</div>';";
     html += "      list.innerHTML = html;";
     html += "    }";
-    html += "    btn.disabled = false;";
+    // The scan runs on the device; poll until it has finished
+    html += "    if (data.scanning) {";
+    html += "      text += ' - scanning...';";
+    html += "      setTimeout(() => scanNetworks(false), 2000);";
+    html += "    } else {";
+    html += "      btn.disabled = false;";
+    html += "    }";
+    html += "    status.textContent = text;";
     html += "  }).catch(err => {";
     html += "    status.textContent = 'Scan failed: ' + err;";
     html += "    btn.disabled = false;";
     html += "  });";
     html += "}";
-    html += "window.onload = function() { scanNetworks(); };";
+    html += "window.onload = function() { scanNetworks(false); };";
     html += "</script>";
 
     html += generateFooter();
@@ -473,13 +787,14 @@ void WebConfigManager::handleAlertConfig() {
     AlertLightConfig& cfg = configManager.getConfig();
 
     String html = generateHeader("Alert Configuration");
+    const AlertStateView alert = deviceState.read().alert;
 
     // Debug info section
     html += "<h2>API Debug Info</h2>";
     html += "<div class='status'>";
-    html += "<p><strong>Last Check:</strong> " + alertManager.getLastCallTime() + "</p>";
+    html += "<p><strong>Last Check:</strong> " + String(alert.lastCall) + "</p>";
     html += "<p><strong>HTTP Status:</strong> ";
-    int httpCode = alertManager.getLastHTTPCode();
+    int httpCode = alert.httpCode;
     if (httpCode == 200) {
         html += "<span class='success'>" + String(httpCode) + " OK</span>";
     } else if (httpCode > 0) {
@@ -488,16 +803,50 @@ void WebConfigManager::handleAlertConfig() {
         html += "Not checked yet";
     }
     html += "</p>";
-    html += "<p><strong>Region:</strong> " + alertManager.getRegionName() + "</p>";
+    html += "<p><strong>Next Check:</strong> in " + String(alertManager.getNextCheckIn() / 1000) + "s";
+    if (alertManager.getFailureCount() > 0) {
+        html += " <span class='error'>(backoff after " + String(alertManager.getFailureCount()) + " failures)</span>";
+    }
+    html += "</p>";
+    if (alert.source[0] != '\0') {
+        html += "<p><strong>Last Source:</strong> " + String(alert.source) + "</p>";
+    }
+    html += "<p><strong>Push Relay:</strong> ";
+    if (alertManager.isPushHealthy()) {
+        html += "<span class='success'>" + alertManager.getPushStatus() + "</span>";
+    } else {
+        html += alertManager.getPushStatus();
+    }
+    html += "</p>";
+    if (alert.stale) {
+        html += "<p><strong>State:</strong> <span class='error'>cached from last run, waiting for API</span></p>";
+    }
+    html += "<p><strong>Region:</strong> " + String(alert.region) + "</p>";
     html += "<p><strong>Alert Status:</strong> ";
-    if (alertManager.isAlertActive()) {
+    if (alert.active) {
         html += "<span class='error'>ACTIVE ALERT</span>";
     } else {
         html += "<span class='success'>No Alert</span>";
     }
     html += "</p>";
-    if (alertManager.getLastError().length() > 0) {
-        html += "<p><strong>Last Error:</strong> <span class='error'>" + alertManager.getLastError() + "</span></p>";
+    if (alert.watchedCount > 1) {
+        html += "<p><strong>Watched Regions:</strong></p><ul style='margin: 5px 0;'>";
+        for (uint8_t i = 0; i < alert.watchedCount; i++) {
+            html += "<li>" + RegionMapper::getRegionName(alert.watchedIds[i]);
+            if (i == 0) {
+                html += " (home)";
+            }
+            if (alert.mask & (1 << i)) {
+                html += " - <span class='error'>ALERT</span>";
+            } else {
+                html += " - <span class='success'>No Alert</span>";
+            }
+            html += "</li>";
+        }
+        html += "</ul>";
+    }
+    if (alert.lastError[0] != '\0') {
+        html += "<p><strong>Last Error:</strong> <span class='error'>" + String(alert.lastError) + "</span></p>";
     }
     html += "<p><strong>Response Data:</strong></p>";
     html += "<div style='font-family: monospace; font-size: 11px; background: #000; color: #0f0; padding: 10px; ";
@@ -529,14 +878,57 @@ void WebConfigManager::handleAlertConfig() {
     }
 
     html += "</select>";
-    html += "<small style='color: #aaa;'>API URL: https://air-save.ops.ajax.systems/api/mobile/status/regions/v2?regions={regionId}</small>";
     html += "</div>";
 
+    // Additional watched regions (fetched in the same request as the home region)
+    for (int slot = 0; slot < ALERT_MAX_REGIONS - 1; slot++) {
+        int selectedId = (slot < cfg.alert_extra_count) ? cfg.alert_extra_regions[slot] : -1;
+
+        html += "<div class='form-group'>";
+        html += "<label>Also watch region " + String(slot + 1) + ":</label>";
+        html += "<select name='extra_region_" + String(slot) + "'>";
+        html += "<option value='-1'" + String(selectedId < 0 ? " selected" : "") + ">-- none --</option>";
+        for (int i = 0; i < RegionMapper::getRegionCount(); i++) {
+            const RegionInfo& region = RegionMapper::getRegion(i);
+            html += "<option value='" + String(region.id) + "'";
+            if (region.id == selectedId) {
+                html += " selected";
+            }
+            html += ">" + String(region.name) + "</option>";
+        }
+        html += "</select>";
+        html += "</div>";
+    }
+
     html += "<div class='form-group'>";
     html += "<label>Check Interval (seconds):</label>";
     html += "<input type='number' name='interval' value='" + String(cfg.alert_check_interval) + "' required>";
     html += "</div>";
 
+    html += "<div class='form-group'>";
+    html += "<label>Primary API URL (Ajax):</label>";
+    html += "<input type='text' name='api_url' value='" + String(cfg.alert_api_url) + "' required>";
+    html += "<small style='color: #aaa;'>Region IDs are appended, e.g. ...regions/v2?regions={regionId}</small>";
+    html += "</div>";
+
+    html += "<div class='form-group'>";
+    html += "<label>Fallback API URL (Ubilling):</label>";
+    html += "<input type='text' name='fallback_url' value='" + String(cfg.alert_fallback_url) + "'>";
+    html += "<small style='color: #aaa;'>Leave empty to use only the primary source</small>";
+    html += "</div>";
+
+    html += "<div class='form-group'>";
+    html += "<label>Fallback Delay (ms):</label>";
+    html += "<input type='number' name='hedge_ms' min='0' max='10000' value='" + String(cfg.alert_hedge_ms) + "'>";
+    html += "<small style='color: #aaa;'>Fallback is queried if the primary has not answered within this time</small>";
+    html += "</div>";
+
+    html += "<div class='form-group'>";
+    html += "<label>Push Relay URL (optional):</label>";
+    html += "<input type='text' name='push_url' value='" + String(cfg.alert_push_url) + "'>";
+    html += "<small style='color: #aaa;'>Server-Sent Events stream in Ajax format, region IDs are appended, e.g. http://relay.local:8090/alerts?regions= . Polling slows down while it streams and takes over when it goes silent.</small>";
+    html += "</div>";
+
     html += "<button type='submit'>Save Alert Settings</button>";
     html += "</form>";
 
@@ -558,13 +950,14 @@ void WebConfigManager::handleLightConfig() {
     AlertLightConfig& cfg = configManager.getConfig();
 
     String html = generateHeader("Light Outage Configuration");
+    const LightStateView light = deviceState.read().light;
 
     // Debug info section
     html += "<h2>API Debug Info</h2>";
     html += "<div class='status'>";
-    html += "<p><strong>Last Check:</strong> " + lightManager.getLastCallTime() + "</p>";
+    html += "<p><strong>Last Check:</strong> " + String(light.lastCall) + "</p>";
     html += "<p><strong>HTTP Status:</strong> ";
-    int httpCode = lightManager.getLastHTTPCode();
+    int httpCode = light.httpCode;
     if (httpCode == 200) {
         html += "<span class='success'>" + String(httpCode) + " OK</span>";
     } else if (httpCode > 0) {
@@ -573,39 +966,101 @@ void WebConfigManager::handleLightConfig() {
         html += "Not checked yet";
     }
     html += "</p>";
-    html += "<p><strong>Queue:</strong> " + lightManager.getQueue() + "</p>";
+    html += "<p><strong>Next Check:</strong> in " + String(lightManager.getNextCheckIn() / 1000) + "s";
+    if (lightManager.getFailureCount() > 0) {
+        html += " <span class='error'>(backoff after " + String(lightManager.getFailureCount()) + " failures)</span>";
+    }
+    html += "</p>";
+    uint8_t queueCount = light.queueCount;
+    html += "<p><strong>Queue" + String(queueCount > 1 ? "s" : "") + ":</strong> ";
+    for (uint8_t q = 0; q < queueCount; q++) {
+        if (q > 0) {
+            html += ", ";
+        }
+        html += light.queues[q].name;
+    }
+    html += "</p>";
+    if (light.stale) {
+        html += "<p><strong>Schedule:</strong> <span class='error'>cached from last run, waiting for API</span></p>";
+    }
+    if (light.lastChange[0] != '\0') {
+        html += "<p><strong>Last Schedule Change:</strong> " + String(light.lastChange) +
+                " (at " + String(light.lastChangeTime) + ")</p>";
+    }
 
-    if (lightManager.isEmergencyShutdown()) {
-        html += "<p><strong>Status:</strong> <span class='error'>EMERGENCY SHUTDOWNS</span></p>";
-    } else {
-        html += "<p><strong>Currently in Outage:</strong> ";
-        if (lightManager.isCurrentlyOutage()) {
-            html += "<span class='error'>YES</span>";
-        } else {
-            html += "<span class='success'>NO</span>";
+    for (uint8_t q = 0; q < queueCount; q++) {
+        const LightQueueView& queue = light.queues[q];
+        if (queueCount > 1) {
+            html += "<h3>Queue " + String(queue.name) + (q == 0 ? " (address)" : "") + "</h3>";
         }
-        html += "</p>";
 
-        // Display outage ranges dynamically
-        const std::vector<OutageRange>& ranges = lightManager.getOutageRanges();
-        if (ranges.size() > 0) {
-            html += "<p><strong>Outages Today:</strong></p><ul style='margin: 5px 0;'>";
-            for (size_t i = 0; i < ranges.size(); i++) {
-                html += "<li>" + ranges[i].time_range;
-                if (ranges[i].is_active) {
-                    html += " <strong style='color: #ffff00;'>(ACTIVE NOW)</strong>";
+        if (queue.emergency) {
+            html += "<p><strong>Status:</strong> <span class='error'>EMERGENCY SHUTDOWNS</span></p>";
+        } else {
+            html += "<p><strong>Currently in Outage:</strong> ";
+            if (queue.outage) {
+                html += "<span class='error'>YES</span>";
+            } else {
+                html += "<span class='success'>NO</span>";
+            }
+            html += "</p>";
+
+            // Display outage ranges dynamically
+            const std::vector<OutageRange>& ranges = lightManager.getOutageRanges(0, q);
+            if (ranges.size() > 0) {
+                html += "<p><strong>Outages Today:</strong></p><ul style='margin: 5px 0;'>";
+                for (size_t i = 0; i < ranges.size(); i++) {
+                    char rangeText[LIGHT_RANGE_TEXT_LEN];
+                    LightManager::formatRange(ranges[i], rangeText, sizeof(rangeText));
+                    html += "<li>" + String(rangeText);
+                    if (ranges[i].is_active) {
+                        html += " <strong style='color: #ffff00;'>(ACTIVE NOW)</strong>";
+                    }
+                    html += "</li>";
                 }
-                html += "</li>";
+                html += "</ul>";
+            } else {
+                html += "<p><strong>Outages Today:</strong> None</p>";
             }
-            html += "</ul>";
+        }
+
+        // Tomorrow's schedule, cached for the midnight rollover
+        if (!queue.tomorrowKnown) {
+            html += "<p><strong>Outages Tomorrow:</strong> not published yet</p>";
+        } else if (queue.tomorrowEmergency) {
+            html += "<p><strong>Outages Tomorrow:</strong> <span class='error'>EMERGENCY SHUTDOWNS</span></p>";
         } else {
-            html += "<p><strong>Outages Today:</strong> None</p>";
+            const std::vector<OutageRange>& tomorrow = lightManager.getOutageRanges(1, q);
+            if (tomorrow.size() > 0) {
+                html += "<p><strong>Outages Tomorrow:</strong></p><ul style='margin: 5px 0;'>";
+                for (size_t i = 0; i < tomorrow.size(); i++) {
+                    char rangeText[LIGHT_RANGE_TEXT_LEN];
+                    LightManager::formatRange(tomorrow[i], rangeText, sizeof(rangeText));
+                    html += "<li>" + String(rangeText) + "</li>";
+                }
+                html += "</ul>";
+            } else {
+                html += "<p><strong>Outages Tomorrow:</strong> None</p>";
+            }
         }
     }
 
-    String lastError = lightManager.getLastError();
-    if (lastError.length() > 0) {
-        html += "<p><strong>Last Error:</strong> <span class='error'>" + lastError + "</span></p>";
+    // Look-ahead from the merged quarter-hour bitmap (power off at any address)
+    if (queueCount > 1) {
+        html += "<h3>Any address</h3>";
+    }
+    int untilChange = lightManager.getMinutesUntilChange();
+    if (untilChange >= 0) {
+        html += "<p><strong>";
+        html += lightManager.isOutageIn(0) ? "Power Returns:" : "Next Outage:";
+        html += "</strong> in " + String(untilChange / 60) + "h " + String(untilChange % 60) + "m</p>";
+    }
+    if (!lightManager.isOutageIn(0) && lightManager.hasOutageWithin(30)) {
+        html += "<p><span class='error'>Outage starts within 30 minutes</span></p>";
+    }
+
+    if (light.lastError[0] != '\0') {
+        html += "<p><strong>Last Error:</strong> <span class='error'>" + String(light.lastError) + "</span></p>";
     }
 
     String response = lightManager.getLastResponse();
@@ -675,6 +1130,15 @@ void WebConfigManager::handleLightConfig() {
     html += "<input type='text' name='queue' id='queue_input' value='" + String(cfg.light_queue) + "' required pattern='[0-9]+\\.[0-9]+'>";
     html += "</div>";
 
+    // Other addresses - same schedule response, no extra requests
+    for (uint8_t slot = 0; slot < LIGHT_MAX_QUEUES - 1; slot++) {
+        String value = (slot < cfg.light_extra_count) ? String(cfg.light_extra_queues[slot]) : String("");
+        html += "<div class='form-group'>";
+        html += "<label>Extra queue " + String(slot + 1) + " (other address, optional):</label>";
+        html += "<input type='text' name='extra_queue_" + String(slot) + "' value='" + value + "' pattern='[0-9]+\\.[0-9]+'>";
+        html += "</div>";
+    }
+
     html += "<div class='form-group'>";
     html += "<label>Light Outage API URL:</label>";
     html += "<input type='text' name='api_url' value='" + String(cfg.light_api_url) + "' required>";
@@ -800,6 +1264,29 @@ void WebConfigManager::handleRGBConfig() {
     html += "<input type='color' name='color_no_status' value='" + colorToHex(cfg.color_no_status) + "'>";
     html += "</div>";
 
+    html += "<h3>LED Strip</h3>";
+
+    html += "<div class='form-group'>";
+    html += "<label>Strip Length (pixels, 1 = onboard LED):</label>";
+    html += "<input type='number' name='led_count' min='1' max='" + String(LED_MAX_PIXELS) + "' value='" + String(cfg.led_count) + "' required>";
+    html += "</div>";
+
+    html += "<div class='form-group'>";
+    html += "<label>Layout:</label>";
+    html += "<select name='led_layout'>";
+    html += "<option value='" + String(LED_LAYOUT_WHOLE) + "'" + String(cfg.led_layout == LED_LAYOUT_WHOLE ? " selected" : "") + ">Whole strip - ambient status</option>";
+    html += "<option value='" + String(LED_LAYOUT_SPLIT) + "'" + String(cfg.led_layout == LED_LAYOUT_SPLIT ? " selected" : "") + ">Split - alert left, outage right</option>";
+    html += "</select>";
+    html += "</div>";
+
+    html += "<div class='form-group'>";
+    html += "<label>Colour Order:</label>";
+    html += "<select name='led_order'>";
+    html += "<option value='" + String(LED_ORDER_RGB) + "'" + String(cfg.led_color_order == LED_ORDER_RGB ? " selected" : "") + ">RGB - onboard LED</option>";
+    html += "<option value='" + String(LED_ORDER_GRB) + "'" + String(cfg.led_color_order == LED_ORDER_GRB ? " selected" : "") + ">GRB - WS2812 strip</option>";
+    html += "</select>";
+    html += "</div>";
+
     html += "<h3>Blink Settings</h3>";
 
     html += "<div class='form-group'>";
@@ -813,8 +1300,13 @@ void WebConfigManager::handleRGBConfig() {
     html += "</div>";
 
     html += "<div class='form-group'>";
-    html += "<label>Total Blink Duration (seconds):</label>";
-    html += "<input type='number' name='blink_total' value='" + String(cfg.blink_total_duration) + "' required>";
+    html += "<label>Alert/Outage Start Duration (seconds):</label>";
+    html += "<input type='number' name='blink_total' min='1' value='" + String(cfg.blink_total_duration) + "' required>";
+    html += "</div>";
+
+    html += "<div class='form-group'>";
+    html += "<label>Dismiss/Restore/Schedule Duration (seconds):</label>";
+    html += "<input type='number' name='blink_info' min='1' value='" + String(cfg.blink_info_duration) + "' required>";
     html += "</div>";
 
     html += "<div class='form-group'>";
@@ -837,6 +1329,11 @@ void WebConfigManager::handleRGBConfig() {
     html += "<input type='color' name='blink_restore' value='" + colorToHex(cfg.color_blink_restore) + "'>";
     html += "</div>";
 
+    html += "<div class='form-group'>";
+    html += "<label>Schedule Changed Blink Color (Magenta):</label>";
+    html += "<input type='color' name='blink_schedule' value='" + colorToHex(cfg.color_blink_schedule) + "'>";
+    html += "</div>";
+
     html += "<button type='submit'>Save RGB Settings</button>";
     html += "</form>";
 
@@ -844,6 +1341,8 @@ void WebConfigManager::handleRGBConfig() {
     html += "<h2>RGB Test Controls</h2>";
     html += "<div class='status'>";
     html += "<p>Test RGB blink patterns and ambient modes in real-time.</p>";
+    html += "<p><strong>Now:</strong> " + rgbManager.getCurrentMode() + "</p>";
+    html += "<p><strong>Queued:</strong> " + rgbManager.getQueueSummary() + "</p>";
     html += "<div style='margin: 10px 0;'>";
     html += "<button type='button' onclick='testRGB(\"alert_start\")' style='background: #ff0000;'>Test Alert Start (Red)</button> ";
     html += "<button type='button' onclick='testRGB(\"alert_dismiss\")' style='background: #00ff00; color: #000;'>Test Alert Dismiss (Green)</button>";
@@ -853,6 +1352,9 @@ void WebConfigManager::handleRGBConfig() {
     html += "<button type='button' onclick='testRGB(\"restore\")' style='background: #ffff00; color: #000;'>Test Power Restore (Yellow)</button>";
     html += "</div>";
     html += "<div style='margin: 10px 0;'>";
+    html += "<button type='button' onclick='testRGB(\"schedule\")' style='background: #ff00ff;'>Test Schedule Changed (Magenta)</button>";
+    html += "</div>";
+    html += "<div style='margin: 10px 0;'>";
     html += "<button type='button' onclick='testRGB(\"ambient\")' style='background: #666;'>Test Ambient Mode</button> ";
     html += "<button type='button' onclick='testRGB(\"exit\")' style='background: #333;'>Exit Test Mode</button>";
     html += "</div>";
@@ -869,6 +1371,7 @@ void WebConfigManager::handleRGBConfig() {
     html += "    case 'alert_dismiss': msg = 'Testing Alert Dismiss (Green blink)...'; break;";
     html += "    case 'outage_start': msg = 'Testing Outage Start (Blue blink)...'; break;";
     html += "    case 'restore': msg = 'Testing Power Restore (Yellow blink)...'; break;";
+    html += "    case 'schedule': msg = 'Testing Schedule Changed (Magenta blink)...'; break;";
     html += "    case 'ambient': msg = 'Testing Ambient Mode...'; break;";
     html += "    case 'exit': msg = 'Exiting test mode...'; break;";
     html += "  }";
@@ -886,56 +1389,74 @@ void WebConfigManager::handleRGBConfig() {
 }
 
 void WebConfigManager::handleSaveWiFi() {
-    AlertLightConfig& cfg = configManager.getConfig();
-
     if (server.hasArg("ssid")) {
-        strncpy(cfg.wifi_ssid, server.arg("ssid").c_str(), sizeof(cfg.wifi_ssid) - 1);
+        configManager.setText(CFG_WIFI_SSID, server.arg("ssid").c_str());
     }
     if (server.hasArg("password")) {
-        strncpy(cfg.wifi_password, server.arg("password").c_str(), sizeof(cfg.wifi_password) - 1);
+        configManager.setText(CFG_WIFI_PASSWORD, server.arg("password").c_str());
     }
-    cfg.use_static_ip = server.hasArg("use_static");
+    configManager.setBool(CFG_USE_STATIC_IP, server.hasArg("use_static"));
     if (server.hasArg("static_ip")) {
-        strncpy(cfg.static_ip, server.arg("static_ip").c_str(), sizeof(cfg.static_ip) - 1);
+        configManager.setText(CFG_STATIC_IP, server.arg("static_ip").c_str());
     }
     if (server.hasArg("gateway")) {
-        strncpy(cfg.static_gateway, server.arg("gateway").c_str(), sizeof(cfg.static_gateway) - 1);
+        configManager.setText(CFG_STATIC_GATEWAY, server.arg("gateway").c_str());
     }
     if (server.hasArg("subnet")) {
-        strncpy(cfg.static_subnet, server.arg("subnet").c_str(), sizeof(cfg.static_subnet) - 1);
+        configManager.setText(CFG_STATIC_SUBNET, server.arg("subnet").c_str());
     }
 
     configManager.save();
 
     String html = generateHeader("Settings Saved");
     html += "<h2 class='success'>WiFi Settings Saved!</h2>";
-    html += "<p>The device will restart to apply the new settings.</p>";
+    if (networkChangePending) {
+        html += "<p>Reconnecting with the new settings - no restart needed. ";
+        html += "If the IP address changed, continue at the new address.</p>";
+    } else {
+        html += "<p>Nothing changed.</p>";
+    }
     html += "<p><a href='/'>Return to Home</a></p>";
     html += generateFooter();
 
     server.send(200, "text/html", html);
-
-    delay(2000);
-    ESP.restart();
 }
 
 void WebConfigManager::handleSaveAlert() {
-    AlertLightConfig& cfg = configManager.getConfig();
-
     if (server.hasArg("api_url")) {
-        strncpy(cfg.alert_api_url, server.arg("api_url").c_str(), sizeof(cfg.alert_api_url) - 1);
+        configManager.setText(CFG_ALERT_API_URL, server.arg("api_url").c_str());
+    }
+    if (server.hasArg("fallback_url")) {
+        configManager.setText(CFG_ALERT_FALLBACK_URL, server.arg("fallback_url").c_str());
+    }
+    if (server.hasArg("hedge_ms")) {
+        configManager.setU16(CFG_ALERT_HEDGE_MS, server.arg("hedge_ms").toInt());
+    }
+    if (server.hasArg("push_url")) {
+        configManager.setText(CFG_ALERT_PUSH_URL, server.arg("push_url").c_str());
     }
     if (server.hasArg("region_id")) {
-        cfg.alert_region_id = server.arg("region_id").toInt();
+        configManager.setU16(CFG_ALERT_REGION_ID, server.arg("region_id").toInt());
     }
     if (server.hasArg("interval")) {
-        cfg.alert_check_interval = server.arg("interval").toInt();
+        configManager.setU32(CFG_ALERT_CHECK_INTERVAL, server.arg("interval").toInt());
     }
 
-    configManager.save();
+    uint16_t extraRegions[ALERT_MAX_REGIONS - 1];
+    uint8_t extraCount = 0;
+    for (int slot = 0; slot < ALERT_MAX_REGIONS - 1; slot++) {
+        String argName = "extra_region_" + String(slot);
+        if (server.hasArg(argName.c_str())) {
+            int id = server.arg(argName.c_str()).toInt();
+            if (id >= 0) {
+                extraRegions[extraCount++] = (uint16_t)id;
+            }
+        }
+    }
+    configManager.setAlertExtraRegions(extraRegions, extraCount);
 
-    // Force immediate check to detect state change and trigger blink
-    alertManager.forceCheck();
+    // AlertManager reschedules its check when sources, regions or the interval changed
+    configManager.save();
 
     String html = generateHeader("Settings Saved");
     html += "<h2 class='success'>Alert Settings Saved!</h2>";
@@ -946,28 +1467,40 @@ void WebConfigManager::handleSaveAlert() {
 }
 
 void WebConfigManager::handleSaveLight() {
-    AlertLightConfig& cfg = configManager.getConfig();
-
     if (server.hasArg("api_url")) {
-        strncpy(cfg.light_api_url, server.arg("api_url").c_str(), sizeof(cfg.light_api_url) - 1);
+        configManager.setText(CFG_LIGHT_API_URL, server.arg("api_url").c_str());
     }
     if (server.hasArg("queue")) {
-        strncpy(cfg.light_queue, server.arg("queue").c_str(), sizeof(cfg.light_queue) - 1);
+        configManager.setText(CFG_LIGHT_QUEUE, server.arg("queue").c_str());
+    }
+
+    char extraQueues[LIGHT_MAX_QUEUES - 1][8];
+    uint8_t extraCount = 0;
+    for (uint8_t slot = 0; slot < LIGHT_MAX_QUEUES - 1; slot++) {
+        String argName = "extra_queue_" + String(slot);
+        if (server.hasArg(argName)) {
+            String queue = server.arg(argName);
+            queue.trim();
+            if (queue.length() > 0 && queue.length() < sizeof(extraQueues[0])) {
+                strcpy(extraQueues[extraCount++], queue.c_str());
+            }
+        }
     }
+    configManager.setLightExtraQueues(extraQueues, extraCount);
     if (server.hasArg("interval")) {
-        cfg.light_check_interval = server.arg("interval").toInt();
+        configManager.setU32(CFG_LIGHT_CHECK_INTERVAL, server.arg("interval").toInt());
     }
     if (server.hasArg("yasno_street_id")) {
-        cfg.yasno_street_id = server.arg("yasno_street_id").toInt();
+        configManager.setU32(CFG_YASNO_STREET_ID, server.arg("yasno_street_id").toInt());
     }
     if (server.hasArg("yasno_street_name")) {
-        strncpy(cfg.yasno_street_name, server.arg("yasno_street_name").c_str(), sizeof(cfg.yasno_street_name) - 1);
+        configManager.setText(CFG_YASNO_STREET_NAME, server.arg("yasno_street_name").c_str());
     }
     if (server.hasArg("yasno_house_id")) {
-        cfg.yasno_house_id = server.arg("yasno_house_id").toInt();
+        configManager.setU32(CFG_YASNO_HOUSE_ID, server.arg("yasno_house_id").toInt());
     }
     if (server.hasArg("yasno_house_name")) {
-        strncpy(cfg.yasno_house_name, server.arg("yasno_house_name").c_str(), sizeof(cfg.yasno_house_name) - 1);
+        configManager.setText(CFG_YASNO_HOUSE_NAME, server.arg("yasno_house_name").c_str());
     }
 
     configManager.save();
@@ -981,43 +1514,56 @@ void WebConfigManager::handleSaveLight() {
 }
 
 void WebConfigManager::handleSaveRGB() {
-    AlertLightConfig& cfg = configManager.getConfig();
-
     if (server.hasArg("ambient_brightness")) {
-        cfg.ambient_brightness = server.arg("ambient_brightness").toInt();
+        configManager.setU8(CFG_AMBIENT_BRIGHTNESS, server.arg("ambient_brightness").toInt());
     }
     if (server.hasArg("color_no_alert")) {
-        cfg.color_no_alert = hexToColor(server.arg("color_no_alert"));
+        configManager.setU32(CFG_COLOR_NO_ALERT, hexToColor(server.arg("color_no_alert")));
     }
     if (server.hasArg("color_alert")) {
-        cfg.color_alert = hexToColor(server.arg("color_alert"));
+        configManager.setU32(CFG_COLOR_ALERT, hexToColor(server.arg("color_alert")));
     }
     if (server.hasArg("color_outage")) {
-        cfg.color_outage = hexToColor(server.arg("color_outage"));
+        configManager.setU32(CFG_COLOR_OUTAGE, hexToColor(server.arg("color_outage")));
     }
     if (server.hasArg("color_no_status")) {
-        cfg.color_no_status = hexToColor(server.arg("color_no_status"));
+        configManager.setU32(CFG_COLOR_NO_STATUS, hexToColor(server.arg("color_no_status")));
+    }
+    if (server.hasArg("led_count")) {
+        configManager.setU16(CFG_LED_COUNT, constrain(server.arg("led_count").toInt(), 1, LED_MAX_PIXELS));
+    }
+    if (server.hasArg("led_layout")) {
+        configManager.setU8(CFG_LED_LAYOUT, server.arg("led_layout").toInt() == LED_LAYOUT_SPLIT ? LED_LAYOUT_SPLIT : LED_LAYOUT_WHOLE);
+    }
+    if (server.hasArg("led_order")) {
+        configManager.setU8(CFG_LED_COLOR_ORDER, server.arg("led_order").toInt() == LED_ORDER_GRB ? LED_ORDER_GRB : LED_ORDER_RGB);
     }
     if (server.hasArg("blink_on")) {
-        cfg.blink_on_duration = server.arg("blink_on").toInt();
+        configManager.setU16(CFG_BLINK_ON_DURATION, server.arg("blink_on").toInt());
     }
     if (server.hasArg("blink_off")) {
-        cfg.blink_off_duration = server.arg("blink_off").toInt();
+        configManager.setU16(CFG_BLINK_OFF_DURATION, server.arg("blink_off").toInt());
     }
     if (server.hasArg("blink_total")) {
-        cfg.blink_total_duration = server.arg("blink_total").toInt();
+        configManager.setU16(CFG_BLINK_TOTAL_DURATION, server.arg("blink_total").toInt());
+    }
+    if (server.hasArg("blink_info")) {
+        configManager.setU16(CFG_BLINK_INFO_DURATION, server.arg("blink_info").toInt());
     }
     if (server.hasArg("blink_alert")) {
-        cfg.color_blink_alert = hexToColor(server.arg("blink_alert"));
+        configManager.setU32(CFG_COLOR_BLINK_ALERT, hexToColor(server.arg("blink_alert")));
     }
     if (server.hasArg("blink_dismiss")) {
-        cfg.color_blink_alert_dismiss = hexToColor(server.arg("blink_dismiss"));
+        configManager.setU32(CFG_COLOR_BLINK_ALERT_DISMISS, hexToColor(server.arg("blink_dismiss")));
     }
     if (server.hasArg("blink_outage")) {
-        cfg.color_blink_outage = hexToColor(server.arg("blink_outage"));
+        configManager.setU32(CFG_COLOR_BLINK_OUTAGE, hexToColor(server.arg("blink_outage")));
     }
     if (server.hasArg("blink_restore")) {
-        cfg.color_blink_restore = hexToColor(server.arg("blink_restore"));
+        configManager.setU32(CFG_COLOR_BLINK_RESTORE, hexToColor(server.arg("blink_restore")));
+    }
+    if (server.hasArg("blink_schedule")) {
+        configManager.setU32(CFG_COLOR_BLINK_SCHEDULE, hexToColor(server.arg("blink_schedule")));
     }
 
     configManager.save();
@@ -1030,6 +1576,61 @@ void WebConfigManager::handleSaveRGB() {
     server.send(200, "text/html", html);
 }
 
+void WebConfigManager::handleBackup() {
+    String html = generateHeader("Configuration Backup");
+    html += "<h2>Export</h2>";
+    html += "<div class='status'>";
+    html += "<p>All settings as JSON. The WiFi password is left out unless included explicitly.</p>";
+    html += "<p><a href='/api/config'>Download settings</a> | ";
+    html += "<a href='/api/config?secrets=1'>Download with WiFi password</a></p>";
+    html += "<p><strong>Stored:</strong> " + String(ConfigManager::loadSourceToString(configManager.getLoadSource())) + "</p>";
+    html += "</div>";
+
+    html += "<h2>Import</h2>";
+    html += "<form action='/import_config' method='POST'>";
+    html += "<div class='form-group'>";
+    html += "<label>Settings JSON (fields not present keep their current value):</label>";
+    html += "<textarea name='config' rows='12' style='width: 100%; font-family: monospace;' required></textarea>";
+    html += "</div>";
+    html += "<button type='submit'>Import Settings</button>";
+    html += "</form>";
+    html += generateFooter();
+
+    server.send(200, "text/html", html);
+}
+
+void WebConfigManager::handleExportConfig() {
+    bool secrets = server.hasArg("secrets") && server.arg("secrets") == "1";
+    server.sendHeader("Content-Disposition", "attachment; filename=alertlight-config.json");
+    server.send(200, "application/json", configManager.exportJson(secrets));
+}
+
+void WebConfigManager::handleImportConfig() {
+    String error;
+    bool ok = server.hasArg("config") && configManager.importJson(server.arg("config"), error);
+    if (!server.hasArg("config")) {
+        error = "No settings received";
+    }
+    if (ok) {
+        configManager.save();
+        addLog("Configuration imported");
+    }
+
+    String html = generateHeader(ok ? "Settings Imported" : "Import Failed");
+    if (ok) {
+        html += "<h2 class='success'>Settings Imported!</h2>";
+        html += "<p>Settings are applied without a restart; network changes reconnect once this page is sent.</p>";
+    } else {
+        html += "<h2 class='error'>Import Failed</h2>";
+        html += "<p>" + error + "</p>";
+        html += "<p>Nothing was changed.</p>";
+    }
+    html += "<p><a href='/backup'>Back to Backup</a></p>";
+    html += generateFooter();
+
+    server.send(ok ? 200 : 400, "text/html", html);
+}
+
 void WebConfigManager::handleRestart() {
     String html = generateHeader("Restart");
     html += "<h2>Restarting Device...</h2>";
@@ -1086,72 +1687,29 @@ void WebConfigManager::addLog(const String& message) {
     }
 }
 
-void WebConfigManager::checkWiFiStatus() {
+void WebConfigManager::applyIPConfig(bool reuseLease) {
     AlertLightConfig& cfg = configManager.getConfig();
-    wl_status_t status = WiFi.status();
+    leaseBorrowed = false;
 
-    // Check if we're in AP mode and should try to reconnect to saved WiFi
-    if (apMode) {
-        // In AP mode, periodically try to reconnect to saved WiFi
-        if (strlen(cfg.wifi_ssid) > 0) {
-            unsigned long now = millis();
-
-            // Try to reconnect every 60 seconds
-            if (now - lastScanAttempt >= scanRetryInterval) {
-                addLog("Attempting to reconnect to WiFi...");
-
-                if (connectToWiFi(15000)) {
-                    // Success! Switch from AP mode to station mode
-                    addLog("WiFi reconnected! Switching to Station mode");
-
-                    WiFi.softAPdisconnect(true);  // Stop AP mode
-                    apMode = false;
-                    wifiConnected = true;
-
-                    // Update UI
-                    AlertLight_UI_Update_WiFi_Blink(false);  // Stop blinking
-                } else {
-                    addLog("Still not connected. Ensuring AP mode is active");
-
-                    // Ensure AP mode is still running after failed connection attempt
-                    if (WiFi.getMode() != WIFI_AP && WiFi.getMode() != WIFI_AP_STA) {
-                        addLog("AP mode was stopped, restarting...");
-                        startAPMode();
-                    }
-                }
-            }
-        }
-        return;
-    }
-
-    // Station mode - check connection status
-    if (status == WL_CONNECTED) {
-        if (!wifiConnected) {
-            wifiConnected = true;
-            addLog("WiFi reconnected - IP: " + WiFi.localIP().toString());
-        }
+    // Configure static IP if enabled, otherwise use DHCP
+    if (cfg.use_static_ip) {
+        IPAddress ip, gateway, subnet;
+        ip.fromString(cfg.static_ip);
+        gateway.fromString(cfg.static_gateway);
+        subnet.fromString(cfg.static_subnet);
+        WiFi.config(ip, gateway, subnet);
+        addLog("Using static IP: " + String(cfg.static_ip));
+    } else if (reuseLease && leaseUsable()) {
+        // Skip the DHCP exchange with the lease we held a moment ago;
+        // handed back to DHCP once the link has settled (checkWiFiStatus)
+        IPAddress ip(linkCache.ip);
+        WiFi.config(ip, IPAddress(linkCache.gateway), IPAddress(linkCache.subnet), IPAddress(linkCache.dns));
+        leaseBorrowed = true;
+        addLog("Reusing DHCP lease: " + ip.toString());
     } else {
-        if (wifiConnected) {
-            wifiConnected = false;
-            addLog("WiFi connection lost - Status: " + String(status));
-        }
-
-        // Periodic scan and reconnect attempt
-        if (strlen(cfg.wifi_ssid) > 0) {
-            unsigned long now = millis();
-
-            // Only attempt reconnect/scan every scanRetryInterval (60 seconds)
-            if (now - lastScanAttempt >= scanRetryInterval) {
-                addLog("Attempting to reconnect to WiFi...");
-
-                if (connectToWiFi(15000)) {
-                    wifiConnected = true;
-                    addLog("Successfully reconnected!");
-                } else {
-                    addLog("Reconnection failed. Will retry in 60s");
-                }
-            }
-        }
+        // Reset to DHCP
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+        addLog("Using DHCP");
     }
 }
 
@@ -1160,21 +1718,25 @@ void WebConfigManager::handleStatus() {
 
     html += "<h2>System Status</h2>";
     html += "<div class='status'>";
-    html += "<p><strong>Mode:</strong> " + String(apMode ? "Access Point" : "Station") + "</p>";
-    html += "<p><strong>WiFi Status:</strong> ";
+    html += "<p><strong>Mode:</strong> " + String(apMode ? "Access Point + Station" : "Station") + "</p>";
     if (apMode) {
-        html += "AP Mode - SSID: " + apSSID + "</p>";
-        html += "<p><strong>AP IP:</strong> " + WiFi.softAPIP().toString() + "</p>";
-        html += "<p><strong>Clients:</strong> " + String(WiFi.softAPgetStationNum()) + "</p>";
-    } else {
-        if (wifiConnected && WiFi.status() == WL_CONNECTED) {
-            html += "<span class='success'>Connected</span></p>";
-            html += "<p><strong>SSID:</strong> " + WiFi.SSID() + "</p>";
-            html += "<p><strong>IP Address:</strong> " + WiFi.localIP().toString() + "</p>";
-            html += "<p><strong>Signal:</strong> " + String(WiFi.RSSI()) + " dBm</p>";
-        } else {
-            html += "<span class='error'>Disconnected</span></p>";
+        html += "<p><strong>AP:</strong> " + apSSID + " - " + WiFi.softAPIP().toString() + ", ";
+        html += String(WiFi.softAPgetStationNum()) + " client(s)</p>";
+    }
+    html += "<p><strong>WiFi Status:</strong> ";
+    if (isConnected()) {
+        html += "<span class='success'>Connected</span></p>";
+        html += "<p><strong>SSID:</strong> " + WiFi.SSID() + "</p>";
+        html += "<p><strong>IP Address:</strong> " + WiFi.localIP().toString() + "</p>";
+        html += "<p><strong>Signal:</strong> " + String(WiFi.RSSI()) + " dBm</p>";
+        if (lastConnectMs > 0) {
+            html += "<p><strong>Last Connect:</strong> " + String(lastConnectMs) + " ms (";
+            html += String(lastConnectFast ? "cached access point" : "scan");
+            html += leaseBorrowed ? ", reused lease" : "";
+            html += ")</p>";
         }
+    } else {
+        html += "<span class='error'>Disconnected</span> (" + String(linkStateToString(linkState)) + ")</p>";
     }
     html += "<p><strong>Uptime:</strong> ";
     unsigned long uptime = millis() / 1000;
@@ -1185,6 +1747,44 @@ void WebConfigManager::handleStatus() {
     snprintf(uptimeStr, sizeof(uptimeStr), "%luh %lum %lus", hours, minutes, seconds);
     html += String(uptimeStr) + "</p>";
     html += "<p><strong>Free Heap:</strong> " + String(ESP.getFreeHeap()) + " bytes</p>";
+    html += "<p><strong>LED Frames:</strong> " + String(RGB_Lamp_GetFramesSent()) + " sent, " +
+            String(RGB_Lamp_GetFramesSkipped()) + " unchanged skipped (" +
+            String(ledEffects.getPixelCount()) + " pixel(s))</p>";
+    const ConfigWriteStats& writes = configManager.getWriteStats();
+    html += "<p><strong>Config:</strong> " + String(ConfigManager::loadSourceToString(configManager.getLoadSource())) + "</p>";
+    html += "<p><strong>Config Writes:</strong> " + String(writes.saves) + " saves (" +
+            String(writes.skippedSaves) + " unchanged), last " + String(writes.lastFields) + " field(s) changed / " +
+            String(writes.lastBytes) + " B written (whole blob), " + String(writes.totalBytes) + " B since first boot</p>";
+    html += "</div>";
+
+    html += "<h2>Upstream Hosts</h2>";
+    html += "<div class='status'>";
+    if (upstreamClient.getHostCount() == 0) {
+        html += "<p>No requests yet</p>";
+    }
+    for (int i = 0; i < upstreamClient.getHostCount(); i++) {
+        const UpstreamHost& host = upstreamClient.getHost(i);
+        html += "<p><strong>" + String(host.name) + ":</strong> ";
+        html += String(host.state == BREAKER_CLOSED ? "<span class='success'>" : "<span class='error'>");
+        html += String(UpstreamClient::stateToString(host.state)) + "</span>";
+        html += " | requests " + String(host.requestCount);
+        html += ", failures " + String(host.failureCount);
+        html += ", skipped " + String(host.shortCircuitCount) + "</p>";
+    }
+    html += "</div>";
+
+    html += "<h2>Loop Tasks</h2>";
+    html += "<div class='status'>";
+    html += "<p><strong>Loop load:</strong> " + String(loopScheduler.getLoadPercent()) + "% since last view";
+    html += " | wakeups " + String(loopScheduler.getWakeups()) + "</p>";
+    for (uint8_t i = 0; i < loopScheduler.getTaskCount(); i++) {
+        LoopTaskInfo task = loopScheduler.getTaskInfo(i);
+        html += "<p><strong>" + String(task.name) + ":</strong> ";
+        html += task.periodMs > 0 ? "every " + String(task.periodMs) + " ms" : String(task.active ? "armed" : "idle");
+        html += " | runs " + String(task.runCount);
+        html += ", avg " + String(task.runCount > 0 ? (uint32_t)(task.totalMicros / task.runCount) : 0) + " us";
+        html += ", max " + String(task.maxMicros) + " us</p>";
+    }
     html += "</div>";
 
     html += "<h2>System Logs</h2>";
@@ -1199,112 +1799,13 @@ void WebConfigManager::handleStatus() {
 }
 
 void WebConfigManager::handleScan() {
-    int16_t scanResult = WiFi.scanNetworks(true, true, true, 1500);
-
-    if (scanResult == WIFI_SCAN_FAILED) {
-        server.send(500, "application/json", "{\"error\":\"Scan failed to start\"}");
-        return;
-    }
-
-    unsigned long scanStart = millis();
-    int networks = 0;
-    while ((networks = WiFi.scanComplete()) == WIFI_SCAN_RUNNING) {
-        delay(500);
-        if (millis() - scanStart > 30000) {
-            WiFi.scanDelete();
-            server.send(500, "application/json", "{\"error\":\"Scan timeout\"}");
-            return;
-        }
-    }
-
-    if (networks < 0) {
-        server.send(500, "application/json", "{\"error\":\"Scan failed\"}");
-        return;
-    }
-
-    // Deduplicate networks by BSSID (combine hidden networks with same BSSID)
-    struct NetworkInfo {
-        String ssid;
-        String bssid;
-        int8_t rssi;
-        String encryption;
-    };
-
-    NetworkInfo uniqueNetworks[50];
-    int uniqueCount = 0;
-
-    for (int i = 0; i < networks && uniqueCount < 50; i++) {
-        String ssid = WiFi.SSID(i);
-        String bssid = WiFi.BSSIDstr(i);
-        int8_t rssi = WiFi.RSSI(i);
-        wifi_auth_mode_t encryption = WiFi.encryptionType(i);
-
-        // Find if BSSID already exists
-        int existingIndex = -1;
-        for (int j = 0; j < uniqueCount; j++) {
-            if (uniqueNetworks[j].bssid == bssid) {
-                existingIndex = j;
-                break;
-            }
-        }
-
-        const char* encType = "Unknown";
-        switch (encryption) {
-            case WIFI_AUTH_OPEN: encType = "Open"; break;
-            case WIFI_AUTH_WEP: encType = "WEP"; break;
-            case WIFI_AUTH_WPA_PSK: encType = "WPA"; break;
-            case WIFI_AUTH_WPA2_PSK: encType = "WPA2"; break;
-            case WIFI_AUTH_WPA_WPA2_PSK: encType = "WPA/WPA2"; break;
-            case WIFI_AUTH_WPA2_ENTERPRISE: encType = "WPA2-Enterprise"; break;
-            default: encType = "Unknown"; break;
-        }
-
-        if (existingIndex >= 0) {
-            // BSSID exists - update if this has better signal or non-empty SSID
-            if (rssi > uniqueNetworks[existingIndex].rssi ||
-                (ssid.length() > 0 && uniqueNetworks[existingIndex].ssid.length() == 0)) {
-                if (ssid.length() > 0) {
-                    uniqueNetworks[existingIndex].ssid = ssid;
-                }
-                uniqueNetworks[existingIndex].rssi = rssi;
-                uniqueNetworks[existingIndex].encryption = String(encType);
-            }
-        } else {
-            // New BSSID - add to list
-            if (ssid.length() == 0) {
-                ssid = "[Hidden Network]";
-            }
-            uniqueNetworks[uniqueCount].ssid = ssid;
-            uniqueNetworks[uniqueCount].bssid = bssid;
-            uniqueNetworks[uniqueCount].rssi = rssi;
-            uniqueNetworks[uniqueCount].encryption = String(encType);
-            uniqueCount++;
-        }
-    }
-
-    // Build JSON response from deduplicated list
-    String json = "{\"networks\":[";
-
-    for (int i = 0; i < uniqueCount; i++) {
-        if (i > 0) json += ",";
-
-        // Escape quotes in SSID
-        String ssid = uniqueNetworks[i].ssid;
-        ssid.replace("\"", "\\\"");
-
-        json += "{";
-        json += "\"ssid\":\"" + ssid + "\",";
-        json += "\"bssid\":\"" + uniqueNetworks[i].bssid + "\",";
-        json += "\"rssi\":" + String(uniqueNetworks[i].rssi) + ",";
-        json += "\"encryption\":\"" + uniqueNetworks[i].encryption + "\"";
-        json += "}";
+    // Cached results straight away; stale ones are refreshed in the
+    // background and the page polls while "scanning" is set
+    long age = wifiScan.getAgeMs();
+    if (server.hasArg("refresh") || age < 0 || age > WIFI_SCAN_MAX_AGE_MS) {
+        wifiScan.request(1500, true);  // passive, 1500 ms per channel
     }
-
-    json += "],\"count\":" + String(uniqueCount) + "}";
-
-    WiFi.scanDelete();
-
-    server.send(200, "application/json", json);
+    server.send(200, "application/json", wifiScan.toJson());
 }
 
 void WebConfigManager::handleTestAlert() {
@@ -1333,6 +1834,14 @@ static String urlEncode(const String& str) {
     return encoded;
 }
 
+// Headers the Yasno address API expects (mimics the official web widget)
+static const UpstreamHeader YASNO_HEADERS[] = {
+    {"Accept", "application/json"},
+    {"Origin", "https://static.yasno.ua"},
+    {"Referer", "https://static.yasno.ua/"}
+};
+static const size_t YASNO_HEADER_COUNT = sizeof(YASNO_HEADERS) / sizeof(UpstreamHeader);
+
 static void parseYasnoIds(const char* lightApiUrl, uint16_t& regionId, uint32_t& dsoId) {
     regionId = 25;
     dsoId = 902;
@@ -1354,16 +1863,8 @@ void WebConfigManager::handleYasnoStreets() {
     String url = "https://app.yasno.ua/api/blackout-service/public/shutdowns/addresses/v2/streets?regionId=";
     url += String(regionId) + "&query=" + urlEncode(server.arg("q")) + "&dsoId=" + String(dsoId);
 
-    HTTPClient http;
-    http.begin(url);
-    http.setTimeout(10000);
-    http.addHeader("Accept", "application/json");
-    http.addHeader("Origin", "https://static.yasno.ua");
-    http.addHeader("Referer", "https://static.yasno.ua/");
-    int code = http.GET();
-    String body = (code == 200) ? http.getString() : "[]";
-    http.end();
-    server.send(200, "application/json", body);
+    UpstreamResult result = upstreamClient.get(url, YASNO_HEADERS, YASNO_HEADER_COUNT);
+    server.send(200, "application/json", result.ok() ? result.body : String("[]"));
 }
 
 void WebConfigManager::handleYasnoHouses() {
@@ -1379,16 +1880,8 @@ void WebConfigManager::handleYasnoHouses() {
     String url = "https://app.yasno.ua/api/blackout-service/public/shutdowns/addresses/v2/houses?regionId=";
     url += String(regionId) + "&streetId=" + server.arg("streetId") + "&query=" + houseQuery + "&dsoId=" + String(dsoId);
 
-    HTTPClient http;
-    http.begin(url);
-    http.setTimeout(10000);
-    http.addHeader("Accept", "application/json");
-    http.addHeader("Origin", "https://static.yasno.ua");
-    http.addHeader("Referer", "https://static.yasno.ua/");
-    int code = http.GET();
-    String body = (code == 200) ? http.getString() : "[]";
-    http.end();
-    server.send(200, "application/json", body);
+    UpstreamResult result = upstreamClient.get(url, YASNO_HEADERS, YASNO_HEADER_COUNT);
+    server.send(200, "application/json", result.ok() ? result.body : String("[]"));
 }
 
 void WebConfigManager::handleYasnoGroup() {
@@ -1404,16 +1897,8 @@ void WebConfigManager::handleYasnoGroup() {
     url += String(regionId) + "&streetId=" + server.arg("streetId") +
            "&houseId=" + server.arg("houseId") + "&dsoId=" + String(dsoId);
 
-    HTTPClient http;
-    http.begin(url);
-    http.setTimeout(10000);
-    http.addHeader("Accept", "application/json");
-    http.addHeader("Origin", "https://static.yasno.ua");
-    http.addHeader("Referer", "https://static.yasno.ua/");
-    int code = http.GET();
-    String body = (code == 200) ? http.getString() : "{\"error\":\"API error\"}";
-    http.end();
-    server.send(200, "application/json", body);
+    UpstreamResult result = upstreamClient.get(url, YASNO_HEADERS, YASNO_HEADER_COUNT);
+    server.send(200, "application/json", result.ok() ? result.body : String("{\"error\":\"API error\"}"));
 }
 
 void WebConfigManager::handleTestRGB() {
@@ -1432,6 +1917,9 @@ void WebConfigManager::handleTestRGB() {
     } else if (mode == "restore") {
         rgbManager.testBlinkRestore();
         response = "Testing Power Restore (Yellow blink for 30s)";
+    } else if (mode == "schedule") {
+        rgbManager.testBlinkScheduleChange();
+        response = "Testing Schedule Changed (Magenta blink for 30s)";
     } else if (mode == "ambient") {
         rgbManager.testAmbient();
         response = "Testing Ambient Mode";
@@ -1451,24 +1939,27 @@ void WebConfigManager::handleNTP() {
     html += "<h2>Current Time</h2>";
     html += "<div class='status'>";
 
-    time_t now = time(nullptr);
-    struct tm timeinfo;
-    localtime_r(&now, &timeinfo);
+    time_t now = timeService.now();
+    const struct tm& timeinfo = timeService.getLocalTime();
 
     // Check if time is valid (not epoch 0)
-    if (now < 1000000000) {
+    if (!timeService.isValid()) {
         html += "<p><strong>Status:</strong> <span class='error'>Time not synchronized</span></p>";
         html += "<p><strong>Current Time:</strong> --:--:-- (invalid)</p>";
-        html += "<p class='error'>Please sync time with NTP server</p>";
+        html += "<p class='error'>Waiting for NTP or the first API response</p>";
     } else {
         html += "<p><strong>Status:</strong> <span class='success'>Time synchronized</span></p>";
 
         char timeStr[64];
-        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
+        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S %Z", &timeinfo);
         html += "<p><strong>Current Time:</strong> " + String(timeStr) + "</p>";
         html += "<p><strong>Unix Timestamp:</strong> " + String(now) + "</p>";
+        html += "<p><strong>Source:</strong> " + String(TimeService::syncSourceToString(timeService.getSyncSource()));
+        if (timeService.getMillisSinceSync() > 0) {
+            html += ", set " + String(timeService.getMillisSinceSync() / 60000) + " min ago";
+        }
+        html += "</p>";
 
-        // Calculate uptime since last sync
         unsigned long uptime = millis() / 1000;
         unsigned long hours = uptime / 3600;
         unsigned long minutes = (uptime % 3600) / 60;
@@ -1481,9 +1972,10 @@ void WebConfigManager::handleNTP() {
 
     html += "<h2>NTP Configuration</h2>";
     html += "<div class='form-group'>";
-    html += "<p><strong>NTP Servers:</strong> pool.ntp.org, time.nist.gov</p>";
-    html += "<p><strong>Timezone:</strong> UTC+2 (Kyiv/Eastern European Time)</p>";
-    html += "<p><strong>DST Offset:</strong> +1 hour (when active)</p>";
+    html += "<p><strong>NTP Servers:</strong> " + String(TIME_NTP_SERVER_1) + ", " + String(TIME_NTP_SERVER_2) + "</p>";
+    html += "<p><strong>Timezone:</strong> Europe/Kyiv (<code>" + String(timeService.getTimezone()) + "</code>)</p>";
+    html += "<p><strong>DST:</strong> automatic, last Sunday of March 03:00 to last Sunday of October 04:00</p>";
+    html += "<p><strong>Re-sync:</strong> every " + String(TIME_RESYNC_MS / 3600000UL) + " h in the background</p>";
     html += "</div>";
 
     html += "<div class='form-group'>";
@@ -1499,8 +1991,8 @@ void WebConfigManager::handleNTP() {
     html += "  btn.disabled = true;";
     html += "  status.innerHTML = '<span style=\"color: #00aaff;\">Syncing time...</span>';";
     html += "  fetch('/sync_ntp').then(r => r.text()).then(data => {";
-    html += "    status.innerHTML = '<span class=\"success\">Time synchronized! Reloading in 2 seconds...</span>';";
-    html += "    setTimeout(() => location.reload(), 2000);";
+    html += "    status.innerHTML = '<span class=\"success\">Sync started, reloading in 5 seconds...</span>';";
+    html += "    setTimeout(() => location.reload(), 5000);";
     html += "  }).catch(err => {";
     html += "    status.innerHTML = '<span class=\"error\">Sync failed: ' + err + '</span>';";
     html += "    btn.disabled = false;";
@@ -1514,35 +2006,19 @@ void WebConfigManager::handleNTP() {
 
 void WebConfigManager::handleSyncNTP() {
     syncNTPTime();
-    server.send(200, "text/plain", "NTP sync triggered");
+    server.send(200, "text/plain", "NTP sync started");
 }
 
 void WebConfigManager::syncNTPTime() {
-    printf("\n=== NTP Time Sync ===\n");
-    configTime(2 * 3600, 3600, "pool.ntp.org", "time.nist.gov");
-
-    int retry = 0;
-    const int retry_count = 20;
-    struct tm timeinfo;
-
-    while (!getLocalTime(&timeinfo) && retry < retry_count) {
-        delay(500);
-        retry++;
-    }
-
-    if (retry < retry_count) {
-        time_t now = time(nullptr);
-        printf("SUCCESS: Time synced: %02d:%02d:%02d (Unix: %ld)\n",
-               timeinfo.tm_hour, timeinfo.tm_min, timeinfo.tm_sec, now);
-        addLog("Time synchronized: " + String(timeinfo.tm_hour) + ":" +
-               String(timeinfo.tm_min));
+    // Returns at once - completion arrives as TIME_EVENT_SYNCED (onTimeSynced),
+    // and the light manager refetches itself if it parsed without a clock
+    timeService.startSync();
+    addLog("NTP sync started");
+}
 
-        // Force light manager to recheck schedule with correct time
-        lightManager.forceUpdate();
-        printf("Triggered light schedule update after NTP sync\n");
-    } else {
-        printf("FAILED: NTP sync timeout\n");
-        addLog("WARNING: NTP sync failed");
-    }
-    printf("=====================\n\n");
+void WebConfigManager::logTimeSynced(const struct tm& now) {
+    char timeStr[20];
+    strftime(timeStr, sizeof(timeStr), "%H:%M:%S", &now);
+    addLog("Time set from " + String(TimeService::syncSourceToString(timeService.getSyncSource())) +
+           ": " + String(timeStr));
 }
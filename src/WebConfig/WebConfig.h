@@ -10,6 +10,59 @@
 #include "../AlertManager/AlertManager.h"
 #include "../RegionMapper/RegionMapper.h"
 
+// The station link is a state machine stepped from the loop scheduler and
+// fed by WiFi events; nothing in it waits for the radio
+#define WIFI_SUPERVISE_MS       100
+
+// Reconnects try the access point of the last good link first (known
+// BSSID and channel, no scan) and fall back to a scan on failure
+#define WIFI_CACHE_VERSION      1
+#define WIFI_CACHE_APS          4           // Access points kept per SSID, strongest first
+#define WIFI_FAST_CONNECT_MS    3000        // Association on a known channel is ~100-300 ms
+#define WIFI_AP_CONNECT_MS      8000        // Per scanned access point while others are left
+#define WIFI_JOIN_TIMEOUT_MS    15000       // Last (or hidden) access point
+#define WIFI_RESCAN_MS          60000       // Failed fast attempts rescan at most this often
+#define WIFI_RETRY_MIN_MS       1000        // Back-off between attempts, doubling up to the max
+#define WIFI_RETRY_MAX_MS       60000
+
+// Station down this long (or no credentials): the setup AP comes up next
+// to the station, which keeps retrying; it goes away once the station is
+// back and no client is on it
+#define WIFI_AP_FALLBACK_MS     20000
+
+// A DHCP lease younger than this is reused on reconnect without asking
+// the server (well under the 12-24 h typical of home routers), then
+// renewed through DHCP once the link has been up for a while
+#define WIFI_LEASE_REUSE_S      3600
+#define WIFI_LEASE_HANDBACK_MS  (10UL * 60UL * 1000UL)
+
+enum WiFiLinkState {
+    WIFI_LINK_OFF = 0,          // No credentials
+    WIFI_LINK_SCANNING,         // Waiting for wifiScan to list the access points of the SSID
+    WIFI_LINK_JOINING,          // WiFi.begin() issued, waiting for an address
+    WIFI_LINK_UP,
+    WIFI_LINK_WAITING           // Backing off before the next attempt
+};
+
+struct WiFiAccessPoint {
+    uint8_t bssid[6];
+    uint8_t channel;
+    int8_t rssi;                // From the scan that found it
+};
+
+// Kept in StateStore ("wifi"), never holds the password
+struct WiFiLinkCache {
+    uint8_t version;
+    char ssid[32];
+    uint8_t apCount;
+    WiFiAccessPoint aps[WIFI_CACHE_APS];    // [0] = last good, the rest by RSSI
+    uint32_t ip;                // Last DHCP lease, 0 = none
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t leaseTime;         // Epoch when obtained, 0 = clock was not set
+};
+
 class WebConfigManager {
 public:
     WebConfigManager();
@@ -28,8 +81,22 @@ public:
     // Start AP mode
     void startAPMode();
 
-    // Try to connect to WiFi
-    bool connectToWiFi(unsigned long timeout_ms = 10000);
+    // Step the station link: events, timeouts, back-off and the AP
+    // fallback (loop scheduler, every WIFI_SUPERVISE_MS)
+    void checkWiFiStatus();
+
+    // WiFi.onEvent() handler - runs in the WiFi event task, only records
+    void handleWiFiEvent(arduino_event_id_t event, arduino_event_info_t info);
+
+    WiFiLinkState getLinkState();
+    static const char* linkStateToString(WiFiLinkState state);
+
+    // Log line when the clock gets set (TIME_EVENT_SYNCED)
+    void logTimeSynced(const struct tm& now);
+
+    // Network settings or the web port were saved; applied from
+    // handleClient() once the current response has gone out
+    void onConfigChanged(uint64_t changed);
 
 private:
     WebServer server;
@@ -37,11 +104,36 @@ private:
     bool apMode;
     bool wifiConnected;
     String apSSID;
-    unsigned long lastWiFiCheck;
-    unsigned long wifiCheckInterval;
     unsigned long lastScanAttempt;
-    unsigned long scanRetryInterval;
     String statusLog;
+    bool networkChangePending;
+    bool portChangePending;
+
+    // Station link state machine
+    WiFiLinkState linkState;
+    unsigned long stateSince;
+    unsigned long attemptDeadline;      // JOINING: give up on this access point
+    unsigned long retryAt;              // WAITING: next attempt
+    unsigned long retryDelayMs;
+    unsigned long downSince;            // Station without a link since (for the AP fallback)
+    unsigned long attemptStarted;       // First attempt of this connect, for lastConnectMs
+    bool attemptFast;                   // Current attempt is the cached access point
+    bool timeSyncStarted;
+    WiFiAccessPoint candidates[WIFI_CACHE_APS];
+    uint8_t candidateCount;             // 0 while joining = hidden SSID, no BSSID given
+    uint8_t candidateIndex;
+    uint32_t scanGeneration;            // wifiScan generation when the link asked for a scan
+    uint8_t pendingEvents;              // WIFI_EVENT_* bits, set from the event task
+    uint8_t lastDisconnectReason;
+    bool leaveExpected;                 // Our own disconnect(): its ASSOC_LEAVE is not a failure
+
+    WiFiLinkCache linkCache;
+    WiFiLinkCache savedLinkCache;   // Last written to StateStore
+    bool leaseBorrowed;             // Running on a reused lease, not yet confirmed by DHCP
+    bool leaseRenewPending;
+    unsigned long linkUpAt;
+    unsigned long lastConnectMs;
+    bool lastConnectFast;
 
     // Web page handlers
     void handleRoot();
@@ -55,6 +147,9 @@ private:
     void handleSaveLight();
     void handleSaveRGB();
     void handleRestart();
+    void handleBackup();
+    void handleExportConfig();
+    void handleImportConfig();
     void handleNotFound();
     void handleScan();
     void handleTestAlert();
@@ -68,8 +163,22 @@ private:
 
     // Helper functions
     void addLog(const String& message);
-    void checkWiFiStatus();
     void syncNTPTime();  // Synchronize time with NTP server
+    void applyIPConfig(bool reuseLease);  // Static IP, reused lease or DHCP
+    void stopAPMode();
+    void disconnectStation();           // WiFi.disconnect() we won't treat as a link failure
+    void setLinkState(WiFiLinkState state);
+    void startConnect();                // Cached access point first, else scan
+    void startScan();
+    void collectAccessPoints();
+    void joinCandidate(bool fast);
+    void attemptFailed(const char* why);
+    void scheduleRetry();
+    void linkUp();
+    void linkDown(const char* why);
+    void rememberLink();
+    bool leaseUsable();
+    void applyPendingChanges();
 
     // HTML generation helpers
     String generateHeader(const char* title);
@@ -0,0 +1,250 @@
+#include "WiFiScan.h"
+#include <ArduinoJson.h>
+
+// ~100 bytes per network (four members plus the copied BSSID) at the full 64
+#define WIFI_SCAN_JSON_SIZE     8192
+
+WiFiScanService wifiScan;
+
+WiFiScanService::WiFiScanService() {
+    count = 0;
+    memset(slots, 0, sizeof(slots));
+    targetSsid[0] = '\0';
+    targetCount = 0;
+    running = false;
+    pending = false;
+    paused = false;
+    ok = false;
+    generation = 0;
+    pendingMsPerChannel = 0;
+    pendingPassive = false;
+    startedAt = 0;
+    completedAt = 0;
+}
+
+void WiFiScanService::update() {
+    if (running) {
+        int16_t networks = WiFi.scanComplete();
+        if (networks == WIFI_SCAN_RUNNING) {
+            if (millis() - startedAt >= WIFI_SCAN_TIMEOUT_MS) {
+                printf("WiFi scan: timeout\n");
+                WiFi.scanDelete();
+                finish(false);
+            }
+            return;
+        }
+        if (networks < 0) {
+            printf("WiFi scan: failed\n");
+            finish(false);
+            return;
+        }
+        collect(networks);
+        WiFi.scanDelete();
+        finish(true);
+        return;
+    }
+
+    if (pending && !paused) {
+        start();
+    }
+}
+
+void WiFiScanService::request(uint32_t msPerChannel, bool passive) {
+    if (running) {
+        return;  // The scan under way answers this one too
+    }
+    if (!pending || msPerChannel > pendingMsPerChannel) {
+        pendingMsPerChannel = msPerChannel;  // The most thorough request wins
+    }
+    pendingPassive = pending ? (pendingPassive && passive) : passive;
+    pending = true;
+}
+
+void WiFiScanService::setPaused(bool value) {
+    paused = value;
+}
+
+void WiFiScanService::start() {
+    pending = false;
+    // async=true, show_hidden=true
+    int16_t result = WiFi.scanNetworks(true, true, pendingPassive, pendingMsPerChannel);
+    if (result == WIFI_SCAN_FAILED) {
+        printf("WiFi scan: failed to start\n");
+        finish(false);
+        return;
+    }
+    running = true;
+    startedAt = millis();
+}
+
+void WiFiScanService::finish(bool success) {
+    running = false;
+    ok = success;
+    generation++;
+}
+
+void WiFiScanService::collect(int networks) {
+    // A new set replaces the old one: access points gone since drop out
+    count = 0;
+    memset(slots, 0, sizeof(slots));
+    targetCount = 0;
+
+    for (int i = 0; i < networks; i++) {
+        WiFiScanEntry entry;
+        memcpy(entry.bssid, WiFi.BSSID(i), sizeof(entry.bssid));
+        String ssid = WiFi.SSID(i);
+        strncpy(entry.ssid, ssid.c_str(), sizeof(entry.ssid) - 1);
+        entry.ssid[sizeof(entry.ssid) - 1] = '\0';
+        entry.rssi = WiFi.RSSI(i);
+        entry.channel = WiFi.channel(i);
+        entry.auth = WiFi.encryptionType(i);
+        add(entry);
+        if (targetSsid[0] != '\0' && strcmp(entry.ssid, targetSsid) == 0) {
+            addTarget(entry);
+        }
+    }
+    completedAt = millis();
+    printf("WiFi scan: %d result(s), %u access point(s)\n", networks, count);
+}
+
+void WiFiScanService::add(const WiFiScanEntry& entry) {
+    uint32_t slot = hashBssid(entry.bssid) & (WIFI_SCAN_HASH_SLOTS - 1);
+    while (slots[slot] != 0) {
+        WiFiScanEntry& existing = entries[slots[slot] - 1];
+        if (memcmp(existing.bssid, entry.bssid, sizeof(entry.bssid)) == 0) {
+            // Same access point seen twice (e.g. hidden and named beacons):
+            // keep the name and the stronger reading
+            if (entry.rssi > existing.rssi || (entry.ssid[0] != '\0' && existing.ssid[0] == '\0')) {
+                if (entry.ssid[0] != '\0') {
+                    memcpy(existing.ssid, entry.ssid, sizeof(existing.ssid));
+                }
+                existing.rssi = entry.rssi;
+                existing.auth = entry.auth;
+            }
+            return;
+        }
+        slot = (slot + 1) & (WIFI_SCAN_HASH_SLOTS - 1);
+    }
+
+    if (count >= WIFI_SCAN_MAX_RESULTS) {
+        return;
+    }
+    entries[count] = entry;
+    slots[slot] = ++count;
+}
+
+void WiFiScanService::addTarget(const WiFiScanEntry& entry) {
+    // Seen before: drop the old reading if this one is stronger
+    for (uint8_t i = 0; i < targetCount; i++) {
+        if (memcmp(targets[i].bssid, entry.bssid, sizeof(entry.bssid)) == 0) {
+            if (entry.rssi <= targets[i].rssi) {
+                return;
+            }
+            memmove(&targets[i], &targets[i + 1], (targetCount - i - 1) * sizeof(WiFiScanEntry));
+            targetCount--;
+            break;
+        }
+    }
+
+    // Insertion sort; the weakest falls off when the list is full
+    uint8_t at = targetCount;
+    while (at > 0 && targets[at - 1].rssi < entry.rssi) {
+        at--;
+    }
+    if (at >= WIFI_SCAN_MAX_TARGETS) {
+        return;
+    }
+    uint8_t last = targetCount < WIFI_SCAN_MAX_TARGETS ? targetCount : WIFI_SCAN_MAX_TARGETS - 1;
+    memmove(&targets[at + 1], &targets[at], (last - at) * sizeof(WiFiScanEntry));
+    targets[at] = entry;
+    if (targetCount < WIFI_SCAN_MAX_TARGETS) {
+        targetCount++;
+    }
+}
+
+// FNV-1a over the six address bytes
+uint32_t WiFiScanService::hashBssid(const uint8_t* bssid) {
+    uint32_t hash = 2166136261UL;
+    for (uint8_t i = 0; i < 6; i++) {
+        hash ^= bssid[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+bool WiFiScanService::isScanning() {
+    return running || pending;
+}
+
+uint32_t WiFiScanService::getGeneration() {
+    return generation;
+}
+
+bool WiFiScanService::lastScanOk() {
+    return ok;
+}
+
+long WiFiScanService::getAgeMs() {
+    if (completedAt == 0) {
+        return -1;
+    }
+    return (long)(millis() - completedAt);
+}
+
+uint8_t WiFiScanService::getCount() {
+    return count;
+}
+
+const WiFiScanEntry& WiFiScanService::getEntry(uint8_t index) {
+    return entries[index < count ? index : 0];
+}
+
+void WiFiScanService::setTarget(const char* ssid) {
+    strncpy(targetSsid, ssid, sizeof(targetSsid) - 1);
+    targetSsid[sizeof(targetSsid) - 1] = '\0';
+}
+
+uint8_t WiFiScanService::getTargetCount() {
+    return targetCount;
+}
+
+const WiFiScanEntry& WiFiScanService::getTarget(uint8_t index) {
+    return targets[index < targetCount ? index : 0];
+}
+
+String WiFiScanService::toJson() {
+    DynamicJsonDocument doc(WIFI_SCAN_JSON_SIZE);
+    JsonArray networks = doc.createNestedArray("networks");
+
+    char bssid[18];
+    for (uint8_t i = 0; i < count; i++) {
+        const WiFiScanEntry& entry = entries[i];
+        snprintf(bssid, sizeof(bssid), "%02X:%02X:%02X:%02X:%02X:%02X", entry.bssid[0], entry.bssid[1],
+                 entry.bssid[2], entry.bssid[3], entry.bssid[4], entry.bssid[5]);
+
+        JsonObject network = networks.createNestedObject();
+        network["ssid"] = entry.ssid[0] != '\0' ? entry.ssid : "[Hidden Network]";
+        network["bssid"] = (char*)bssid;  // char* is copied into the document
+        network["rssi"] = entry.rssi;
+        network["encryption"] = authToString(entry.auth);
+    }
+    doc["count"] = count;
+    doc["age_ms"] = getAgeMs();
+    doc["scanning"] = isScanning();
+
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
+
+const char* WiFiScanService::authToString(uint8_t auth) {
+    switch (auth) {
+        case WIFI_AUTH_OPEN: return "Open";
+        case WIFI_AUTH_WEP: return "WEP";
+        case WIFI_AUTH_WPA_PSK: return "WPA";
+        case WIFI_AUTH_WPA2_PSK: return "WPA2";
+        case WIFI_AUTH_WPA_WPA2_PSK: return "WPA/WPA2";
+        case WIFI_AUTH_WPA2_ENTERPRISE: return "WPA2-Enterprise";
+        default: return "Unknown";
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef WIFISCAN_H
+#define WIFISCAN_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define WIFI_SCAN_MAX_RESULTS   64
+#define WIFI_SCAN_HASH_SLOTS    128         // Power of two, at least twice the results
+#define WIFI_SCAN_TIMEOUT_MS    60000
+#define WIFI_SCAN_MAX_AGE_MS    15000       // /scan refreshes older results in the background
+#define WIFI_SCAN_MAX_TARGETS   4           // Strongest access points of the target SSID kept
+
+// One access point; several may share an SSID
+struct WiFiScanEntry {
+    uint8_t bssid[6];
+    char ssid[33];              // Empty for a hidden network
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t auth;               // wifi_auth_mode_t
+};
+
+// Owns the radio's scans. Callers ask for a scan and read the cached
+// result set, which stays available until the next scan completes; no
+// caller waits for the radio. Results are deduplicated by BSSID through
+// a small open-addressing table keyed by a hash of the address.
+// The access points of one target SSID (the station's network) are
+// picked out of the raw results before the display set is capped, so
+// a crowded air never hides them from the link.
+class WiFiScanService {
+public:
+    WiFiScanService();
+
+    // Call from loop(); starts requested scans and collects finished ones
+    void update();
+
+    // Ask for a fresh scan. Coalesced with one already running or pending.
+    void request(uint32_t msPerChannel, bool passive);
+
+    // No new scan starts while paused (the station is associating)
+    void setPaused(bool paused);
+
+    bool isScanning();          // Running, or requested and not started yet
+    uint32_t getGeneration();   // Bumps on every finished scan, failed ones included
+    bool lastScanOk();
+    long getAgeMs();            // Age of the cached results, -1 if there are none
+
+    uint8_t getCount();
+    const WiFiScanEntry& getEntry(uint8_t index);
+
+    // SSID whose access points the next scans rank separately; "" = none
+    void setTarget(const char* ssid);
+
+    // Access points of the target SSID from the last scan, strongest first
+    uint8_t getTargetCount();
+    const WiFiScanEntry& getTarget(uint8_t index);
+
+    // {"networks": [...], "count": n, "age_ms": a, "scanning": bool}
+    String toJson();
+
+    static const char* authToString(uint8_t auth);
+
+private:
+    WiFiScanEntry entries[WIFI_SCAN_MAX_RESULTS];
+    uint8_t count;
+    uint8_t slots[WIFI_SCAN_HASH_SLOTS];    // Entry index + 1, 0 = empty
+    char targetSsid[33];
+    WiFiScanEntry targets[WIFI_SCAN_MAX_TARGETS];
+    uint8_t targetCount;
+
+    bool running;
+    bool pending;
+    bool paused;
+    bool ok;
+    uint32_t generation;
+    uint32_t pendingMsPerChannel;
+    bool pendingPassive;
+    unsigned long startedAt;
+    unsigned long completedAt;  // 0 = no results yet
+
+    void start();
+    void collect(int networks);
+    void finish(bool success);
+    void add(const WiFiScanEntry& entry);
+    void addTarget(const WiFiScanEntry& entry);
+
+    static uint32_t hashBssid(const uint8_t* bssid);
+};
+
+extern WiFiScanService wifiScan;
+
+#endif // WIFISCAN_H